@@ -0,0 +1,127 @@
+import argparse
+
+
+# Mirrors drawFunctionPatterns() in src/3rdParty/qrcode/qrcode.c. The format area is reserved
+# but left blank, since qrcode.c always draws the real format bits before they are used.
+def draw_function_patterns(version):
+    size = (version * 4) + 17
+    modules = [[False] * size for _ in range(size)]
+    is_function = [[False] * size for _ in range(size)]
+
+    def set_function_module(x, y, on):
+        modules[y][x] = on
+        is_function[y][x] = True
+
+    # Timing patterns
+    for i in range(size):
+        set_function_module(6, i, (i % 2) == 0)
+        set_function_module(i, 6, (i % 2) == 0)
+
+    # Finder patterns (with separators)
+    for (cx, cy) in [(3, 3), (size - 4, 3), (3, size - 4)]:
+        for i in range(-4, 5):
+            for j in range(-4, 5):
+                dist = max(abs(i), abs(j))
+                xx, yy = cx + j, cy + i
+                if 0 <= xx < size and 0 <= yy < size:
+                    set_function_module(xx, yy, dist != 2 and dist != 4)
+
+    # Alignment patterns
+    if version > 1:
+        align_count = (version // 7) + 2
+        if version != 32:
+            step = ((version * 4) + (align_count * 2) + 1) // ((2 * align_count) - 2) * 2
+        else:
+            step = 26
+
+        positions = [6] + sorted(((size - 7) - (i * step)) for i in range(align_count - 1))
+        for i in range(align_count):
+            for j in range(align_count):
+                if (i == 0 and j == 0) or (i == 0 and j == align_count - 1) or (i == align_count - 1 and j == 0):
+                    continue
+                for dy in range(-2, 3):
+                    for dx in range(-2, 3):
+                        set_function_module(positions[i] + dx, positions[j] + dy, max(abs(dx), abs(dy)) != 1)
+
+    # Format area
+    for i in range(9):
+        if i != 6:
+            set_function_module(8, i, False)
+            set_function_module(i, 8, False)
+    for i in range(8):
+        set_function_module(size - 1 - i, 8, False)
+    for i in range(7):
+        set_function_module(8, size - 7 + i, False)
+    set_function_module(8, size - 8, True)
+
+    # Version information
+    if version >= 7:
+        rem = version
+        for _ in range(12):
+            rem = (rem << 1) ^ ((rem >> 11) * 0x1F25)
+        data = (version << 12) | rem
+
+        for i in range(18):
+            bit = ((data >> i) & 1) != 0
+            a, b = size - 11 + (i % 3), i // 3
+            set_function_module(a, b, bit)
+            set_function_module(b, a, bit)
+
+    return size, modules, is_function
+
+
+def pack_grid(size, grid):
+    packed = bytearray(((size * size) + 7) // 8)
+    for y in range(size):
+        for x in range(size):
+            if grid[y][x]:
+                offset = (y * size) + x
+                packed[offset >> 3] |= (0x80 >> (offset & 7))
+    return packed
+
+
+def format_array(name, data):
+    lines = ["static const uint8_t %s[%d] = {" % (name, len(data))]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-v', '--max-version', type=int, default=11)
+parser.add_argument('-o', '--output', required=True)
+args = parser.parse_args()
+
+max_version = args.max_version
+
+output = [
+    "// Generated by qr_template_gen.py - do not edit",
+    "#ifndef _QRCODE_TEMPLATES_H_",
+    "#define _QRCODE_TEMPLATES_H_",
+    "",
+    "#include <stdint.h>",
+    "",
+    "#define QRCODE_TEMPLATE_MAX_VERSION     (%d)" % max_version,
+    "",
+]
+
+for version in range(1, max_version + 1):
+    size, modules, is_function = draw_function_patterns(version)
+    output.append(format_array("QRCODE_TEMPLATE_MODULES_V%d" % version, pack_grid(size, modules)))
+    output.append(format_array("QRCODE_TEMPLATE_FUNCTION_V%d" % version, pack_grid(size, is_function)))
+    output.append("")
+
+output.append("static const uint8_t* const QRCODE_TEMPLATE_MODULES[QRCODE_TEMPLATE_MAX_VERSION] = {")
+output += ["    QRCODE_TEMPLATE_MODULES_V%d," % v for v in range(1, max_version + 1)]
+output.append("};")
+output.append("")
+output.append("static const uint8_t* const QRCODE_TEMPLATE_FUNCTION[QRCODE_TEMPLATE_MAX_VERSION] = {")
+output += ["    QRCODE_TEMPLATE_FUNCTION_V%d," % v for v in range(1, max_version + 1)]
+output.append("};")
+output.append("")
+output.append("#endif      // _QRCODE_TEMPLATES_H_")
+output.append("")
+
+with open(args.output, "w") as f:
+    f.write("\n".join(output))
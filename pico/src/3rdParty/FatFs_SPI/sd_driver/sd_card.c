@@ -164,6 +164,7 @@ specific language governing permissions and limitations under the License.
 #include <string.h>
 //
 #include "pico/mutex.h"
+#include "hardware/clocks.h"
 //
 #include "hw_config.h"  // Hardware Configuration of the SPI and SD Card "objects"
 #include "my_debug.h"
@@ -1024,6 +1025,113 @@ int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     return status;
 }
 
+/* Clock calibration */
+#define SD_CALIBRATION_BLOCKS 4 /* Blocks per CMD18 read */
+#define SD_CALIBRATION_PASSES 8 /* Reads that must all pass at a rate */
+
+#if SD_CRC_ENABLED
+static uint8_t calibration_buffer[SD_CALIBRATION_BLOCKS * BLOCK_SIZE_HC];
+
+static int sd_calibration_read(sd_card_t *pSD, uint32_t blockCnt,
+                               uint16_t *crcs, bool compare) {
+    int status = in_sd_read_blocks(pSD, calibration_buffer, 0, blockCnt);
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) return status;
+
+    // The CRC16 of each block, against the reference read at the safe rate.
+    // With CRC on, the driver has also checked each block against the card's
+    for (uint32_t i = 0; i < blockCnt; i++) {
+        uint16_t crc = crc16((void *)&calibration_buffer[i * _block_size], _block_size);
+        if (compare && crc != crcs[i]) return SD_BLOCK_DEVICE_ERROR_CRC;
+        crcs[i] = crc;
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static bool sd_calibration_passes(sd_card_t *pSD, uint32_t blockCnt,
+                                  uint16_t *crcs) {
+    for (int pass = 0; pass < SD_CALIBRATION_PASSES; pass++) {
+        if (SD_BLOCK_DEVICE_ERROR_NONE !=
+            sd_calibration_read(pSD, blockCnt, crcs, true))
+            return false;
+    }
+    return true;
+}
+#endif
+
+int sd_calibrate_clock(sd_card_t *pSD, uint max_baud_rate) {
+    if (pSD->calibrated_baud_rate) return SD_BLOCK_DEVICE_ERROR_NONE;
+
+    sd_acquire(pSD);
+    if (pSD->m_Status & (STA_NOINIT | STA_NODISK)) {
+        sd_release(pSD);
+        return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    }
+    if (!pSD->base_baud_rate) pSD->base_baud_rate = pSD->spi->baud_rate;
+
+    spi_inst_t *hw_inst = pSD->spi->hw_inst;
+    uint good_rate = spi_set_baudrate(hw_inst, pSD->base_baud_rate);
+
+    // Without CRCs a corrupt read could still match by chance, and a corrupt
+    // command could read the wrong blocks, so stay at the configured rate
+#if SD_CRC_ENABLED
+    if (crc_on) {
+        uint32_t blockCnt = SD_CALIBRATION_BLOCKS;
+        if (pSD->sectors < blockCnt) blockCnt = (uint32_t)pSD->sectors;
+        uint16_t crcs[SD_CALIBRATION_BLOCKS];
+
+        int status = sd_calibration_read(pSD, blockCnt, crcs, false);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+            DBG_PRINTF("%s: read failed at %u Hz\r\n", __FUNCTION__, good_rate);
+            sd_release(pSD);
+            return status;
+        }
+
+        // SCK is clk_peri divided by an even number (the PL022's prescale
+        // times 1 + SCR), so each step down in the divider is the next rate up
+        uint clk = clock_get_hz(clk_peri);
+        uint divisor = (clk + good_rate - 1) / good_rate;
+        divisor += divisor & 1;
+
+        for (divisor -= 2; divisor >= 2; divisor -= 2) {
+            uint rate = clk / divisor;
+            if (rate > max_baud_rate) break;
+            uint actual = spi_set_baudrate(hw_inst, rate);
+            if (actual <= good_rate) continue;
+            if (!sd_calibration_passes(pSD, blockCnt, crcs)) {
+                DBG_PRINTF("%s: failed at %u Hz\r\n", __FUNCTION__, actual);
+                break;
+            }
+            good_rate = actual;
+        }
+
+        // Fall back, and make sure the card came through the failed reads
+        spi_set_baudrate(hw_inst, good_rate);
+        if (!sd_calibration_passes(pSD, blockCnt, crcs)) {
+            spi_set_baudrate(hw_inst, pSD->base_baud_rate);
+            sd_release(pSD);
+            return SD_BLOCK_DEVICE_ERROR_CRC;
+        }
+    }
+#endif
+
+    pSD->spi->baud_rate = good_rate;
+    pSD->calibrated_baud_rate = good_rate;
+    DBG_PRINTF("%s: %u Hz\r\n", __FUNCTION__, good_rate);
+    sd_release(pSD);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+void sd_reset_clock_calibration(sd_card_t *pSD) {
+    sd_acquire(pSD);
+    if (pSD->base_baud_rate) {
+        pSD->spi->baud_rate = pSD->base_baud_rate;
+        if (!(pSD->m_Status & STA_NOINIT))
+            spi_set_baudrate(pSD->spi->hw_inst, pSD->base_baud_rate);
+    }
+    pSD->calibrated_baud_rate = 0;
+    sd_release(pSD);
+}
+
 static int sd_init_medium(sd_card_t *pSD) {
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response, arg;
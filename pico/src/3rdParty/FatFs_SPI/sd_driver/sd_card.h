@@ -54,6 +54,8 @@ struct sd_card_t {
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    uint base_baud_rate;        // spi->baud_rate as configured, where calibration starts
+    uint calibrated_baud_rate;  // Cached result of sd_calibrate_clock(), 0 until it has run
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
@@ -93,6 +95,19 @@ uint64_t sd_sectors(sd_card_t *pSD);
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
 
+/* Step SCK up from the configured rate, one peripheral clock divider at a time,
+and keep the fastest rate at which repeated CRC checked multi-block reads of the
+first blocks of the card all match. The card must be initialized. The result is
+cached in calibrated_baud_rate (and spi->baud_rate, so a re-init uses it) and
+later calls return straight away, until sd_reset_clock_calibration().
+Returns SD_BLOCK_DEVICE_ERROR_NONE, or the error from reading at the fallback
+rate, in which case the card is left at the configured rate. */
+int sd_calibrate_clock(sd_card_t *pSD, uint max_baud_rate);
+
+/* Go back to the configured rate and forget the calibration, e.g. after the
+card has been swapped or an error at the calibrated rate */
+void sd_reset_clock_calibration(sd_card_t *pSD);
+
 #ifdef __cplusplus
 }
 #endif
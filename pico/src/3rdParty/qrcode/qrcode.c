@@ -38,6 +38,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Precomputed function patterns, generated at build time by qr_template_gen.py
+#ifdef QRCODE_USE_TEMPLATES
+#include "qrcode_templates.h"
+#endif
+
 #pragma mark - Error Correction Lookup tables
 
 #if LOCK_VERSION == 0
@@ -253,6 +258,21 @@ static bool bb_getBit(BitBucket *bitGrid, uint8_t x, uint8_t y) {
 
 #pragma mark - Drawing Patterns
 
+// Returns true if the given mask pattern inverts the module at (x, y)
+static bool getMaskBit(uint8_t mask, uint8_t x, uint8_t y) {
+    switch (mask) {
+        case 0:  return (x + y) % 2 == 0;
+        case 1:  return y % 2 == 0;
+        case 2:  return x % 3 == 0;
+        case 3:  return (x + y) % 3 == 0;
+        case 4:  return (x / 3 + y / 2) % 2 == 0;
+        case 5:  return x * y % 2 + x * y % 3 == 0;
+        case 6:  return (x * y % 2 + x * y % 3) % 2 == 0;
+        case 7:  return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+    return false;
+}
+
 // XORs the data modules in this QR Code with the given mask pattern. Due to XOR's mathematical
 // properties, calling applyMask(m) twice with the same value is equivalent to no change at all.
 // This means it is possible to apply a mask, undo it, and try another mask. Note that a final
@@ -263,19 +283,7 @@ static void applyMask(BitBucket *modules, BitBucket *isFunction, uint8_t mask) {
     for (uint8_t y = 0; y < size; y++) {
         for (uint8_t x = 0; x < size; x++) {
             if (bb_getBit(isFunction, x, y)) { continue; }
-            
-            bool invert = 0;
-            switch (mask) {
-                case 0:  invert = (x + y) % 2 == 0;                    break;
-                case 1:  invert = y % 2 == 0;                          break;
-                case 2:  invert = x % 3 == 0;                          break;
-                case 3:  invert = (x + y) % 3 == 0;                    break;
-                case 4:  invert = (x / 3 + y / 2) % 2 == 0;            break;
-                case 5:  invert = x * y % 2 + x * y % 3 == 0;          break;
-                case 6:  invert = (x * y % 2 + x * y % 3) % 2 == 0;    break;
-                case 7:  invert = ((x + y) % 2 + x * y % 3) % 2 == 0;  break;
-            }
-            bb_invertBit(modules, x, y, invert);
+            bb_invertBit(modules, x, y, getMaskBit(mask, x, y));
         }
     }
 }
@@ -574,6 +582,190 @@ static uint32_t getPenaltyScore(BitBucket *modules) {
 }
 
 
+#pragma mark - Row bitboard masking and penalty calculation
+
+// Each row of the grid packed into a single word (bit x holds the module at column x), so that
+// masking and every penalty rule can be evaluated a whole row at a time with shifts, bitwise
+// operations and popcounts instead of module by module. Grids wider than a word (version 12 and
+// up) fall back to the BitBucket implementation above.
+typedef uint64_t bw_row_t;
+
+#define BW_MAX_SIZE         (sizeof(bw_row_t) * 8)
+#define BW_MASK_PERIOD      12      // Every mask pattern repeats every 12 rows (lcm of 2, 3 and 4)
+#define BW_FINDER_A         0x05D   // 11 module finder-like patterns, first module in the MSB
+#define BW_FINDER_B         0x5D0
+
+static uint8_t bw_popcount(bw_row_t row) {
+    return __builtin_popcountll(row);
+}
+
+static bw_row_t bw_fullRow(uint8_t size) {
+    return (size == BW_MAX_SIZE) ? ~(bw_row_t)0 : (((bw_row_t)1 << size) - 1);
+}
+
+static void bw_loadRows(BitBucket *grid, bw_row_t *rows) {
+    uint8_t size = grid->bitOffsetOrWidth;
+    uint32_t offset = 0;
+    
+    for (uint8_t y = 0; y < size; y++) {
+        bw_row_t row = 0;
+        for (uint8_t x = 0; x < size; x++, offset++) {
+            if (grid->data[offset >> 3] & (0x80 >> (offset & 7))) {
+                row |= ((bw_row_t)1 << x);
+            }
+        }
+        rows[y] = row;
+    }
+}
+
+static void bw_storeRows(BitBucket *grid, const bw_row_t *rows) {
+    uint8_t size = grid->bitOffsetOrWidth;
+    uint32_t offset = 0;
+    
+    memset(grid->data, 0, grid->capacityBytes);
+    for (uint8_t y = 0; y < size; y++) {
+        bw_row_t row = rows[y];
+        for (uint8_t x = 0; x < size; x++, offset++, row >>= 1) {
+            if (row & 1) {
+                grid->data[offset >> 3] |= (0x80 >> (offset & 7));
+            }
+        }
+    }
+}
+
+// drawFormatBits() only touches row 8 and column 8, so only those need reloading after it runs
+static void bw_loadFormatModules(BitBucket *modules, bw_row_t *rows) {
+    uint8_t size = modules->bitOffsetOrWidth;
+
+    for (uint8_t y = 0; y < size; y++) {
+        rows[y] &= ~((bw_row_t)1 << 8);
+        rows[y] |= ((bw_row_t)bb_getBit(modules, 8, y) << 8);
+    }
+
+    for (uint8_t x = 0; x < size; x++) {
+        rows[8] &= ~((bw_row_t)1 << x);
+        rows[8] |= ((bw_row_t)bb_getBit(modules, x, 8) << x);
+    }
+}
+
+static void bw_getMaskPattern(uint8_t mask, uint8_t size, bw_row_t *pattern) {
+    for (uint8_t y = 0; y < BW_MASK_PERIOD; y++) {
+        bw_row_t row = 0;
+        for (uint8_t x = 0; x < size; x++) {
+            if (getMaskBit(mask, x, y)) {
+                row |= ((bw_row_t)1 << x);
+            }
+        }
+        pattern[y] = row;
+    }
+}
+
+static void bw_applyMask(const bw_row_t *rows, const bw_row_t *isFunction, uint8_t size, uint8_t mask, bw_row_t *dest) {
+    bw_row_t pattern[BW_MASK_PERIOD];
+    bw_getMaskPattern(mask, size, pattern);
+
+    for (uint8_t y = 0, p = 0; y < size; y++, p = (p + 1) % BW_MASK_PERIOD) {
+        dest[y] = rows[y] ^ (pattern[p] & ~isFunction[y]);
+    }
+}
+
+// Returns a word with bit x set wherever the 11 modules starting at column x match the pattern
+static bw_row_t bw_matchRowFinder(bw_row_t row, uint16_t pattern) {
+    bw_row_t match = ~(bw_row_t)0;
+    for (uint8_t k = 0; k < 11; k++) {
+        match &= ((pattern >> (10 - k)) & 1) ? (row >> k) : ~(row >> k);
+    }
+    return match;
+}
+
+// Returns a word with bit x set wherever the 11 modules of column x starting at rows[0] match the pattern
+static bw_row_t bw_matchColumnFinder(const bw_row_t *rows, uint16_t pattern) {
+    bw_row_t match = ~(bw_row_t)0;
+    for (uint8_t k = 0; k < 11; k++) {
+        match &= ((pattern >> (10 - k)) & 1) ? rows[k] : ~rows[k];
+    }
+    return match;
+}
+
+// Same score as getPenaltyScore(). A run of L >= 5 same coloured modules scores L - 2, which is
+// 3 for every 5-module window inside it, less 2 for every 6-module window.
+static uint32_t bw_getPenaltyScore(const bw_row_t *rows, uint8_t size) {
+    uint32_t result = 0;
+    uint16_t black = 0;
+    
+    bw_row_t full = bw_fullRow(size);
+    bw_row_t finderWindows = full >> 10;       // Columns at which an 11 module window starts
+    bw_row_t sameAsAbove[5] = { 0 };           // History of "same colour as the row above" words
+    
+    for (uint8_t y = 0; y < size; y++) {
+        bw_row_t row = rows[y];
+        
+        // Adjacent modules in row having same color
+        bw_row_t sameAsRight = ~(row ^ (row >> 1)) & (full >> 1);
+        bw_row_t runs5 = sameAsRight & (sameAsRight >> 1) & (sameAsRight >> 2) & (sameAsRight >> 3);
+        bw_row_t runs6 = runs5 & (sameAsRight >> 4);
+        result += (PENALTY_N1 * bw_popcount(runs5)) - ((PENALTY_N1 - 1) * bw_popcount(runs6));
+        
+        // Finder-like pattern in rows
+        result += PENALTY_N3 * bw_popcount((bw_matchRowFinder(row, BW_FINDER_A) | bw_matchRowFinder(row, BW_FINDER_B)) & finderWindows);
+        
+        if (y > 0) {
+            memmove(&sameAsAbove[1], &sameAsAbove[0], 4 * sizeof(bw_row_t));
+            sameAsAbove[0] = ~(row ^ rows[y - 1]) & full;
+            
+            // 2*2 blocks of modules having same color
+            result += PENALTY_N2 * bw_popcount(sameAsAbove[0] & (sameAsAbove[0] >> 1) & sameAsRight);
+            
+            // Adjacent modules in column having same color
+            if (y >= 4) {
+                bw_row_t colRuns5 = sameAsAbove[0] & sameAsAbove[1] & sameAsAbove[2] & sameAsAbove[3];
+                bw_row_t colRuns6 = (y >= 5) ? (colRuns5 & sameAsAbove[4]) : 0;
+                result += (PENALTY_N1 * bw_popcount(colRuns5)) - ((PENALTY_N1 - 1) * bw_popcount(colRuns6));
+            }
+        }
+        
+        // Finder-like pattern in columns
+        if (y >= 10) {
+            const bw_row_t *window = &rows[y - 10];
+            result += PENALTY_N3 * bw_popcount((bw_matchColumnFinder(window, BW_FINDER_A) | bw_matchColumnFinder(window, BW_FINDER_B)) & full);
+        }
+        
+        // Balance of black and white modules
+        black += bw_popcount(row);
+    }
+    
+    // Find smallest k such that (45-5k)% <= dark/total <= (55+5k)%
+    uint16_t total = size * size;
+    for (uint16_t k = 0; black * 20 < (9 - k) * total || black * 20 > (11 + k) * total; k++) {
+        result += PENALTY_N4;
+    }
+    
+    return result;
+}
+
+// Scores every mask against the rows and returns the one with the lowest penalty. The format
+// bits in modules and rows are left set for the last mask tried.
+static uint8_t bw_findBestMask(BitBucket *modules, BitBucket *isFunction, bw_row_t *rows, const bw_row_t *isFunctionRows, uint8_t ecc) {
+    uint8_t size = modules->bitOffsetOrWidth;
+    bw_row_t masked[size];
+    
+    uint8_t mask = 0;
+    uint32_t minPenalty = UINT32_MAX;
+    for (uint8_t i = 0; i < 8; i++) {
+        drawFormatBits(modules, isFunction, ecc, i);
+        bw_loadFormatModules(modules, rows);
+        bw_applyMask(rows, isFunctionRows, size, i, masked);
+        uint32_t penalty = bw_getPenaltyScore(masked, size);
+        if (penalty < minPenalty) {
+            mask = i;
+            minPenalty = penalty;
+        }
+    }
+    
+    return mask;
+}
+
+
 #pragma mark - Reed-Solomon Generator
 
 static uint8_t rs_multiply(uint8_t x, uint8_t y) {
@@ -776,7 +968,9 @@ uint16_t qrcode_getBufferSize(uint8_t version) {
 }
 
 // @TODO: Return error if data is too big.
-int8_t qrcode_initBytes(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, uint8_t *data, uint16_t length) {
+int8_t qrcode_initBytesWithMask(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, uint8_t *data, uint16_t length, int8_t mask) {
+    if (mask != QRCODE_MASK_AUTO && (mask < 0 || mask > 7)) { return -1; }
+
     uint8_t size = version * 4 + 17;
     qrcode->version = version;
     qrcode->size = size;
@@ -822,40 +1016,78 @@ int8_t qrcode_initBytes(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8
     uint8_t isFunctionGridBytes[bb_getGridSizeBytes(size)];
     bb_initGrid(&isFunctionGrid, isFunctionGridBytes, size);
     
-    // Draw function patterns, draw all codewords, do masking
-    drawFunctionPatterns(&modulesGrid, &isFunctionGrid, version, eccFormatBits);
+    // Draw function patterns (or copy them in from the matching template), draw all codewords, do masking
+#ifdef QRCODE_USE_TEMPLATES
+    if (version <= QRCODE_TEMPLATE_MAX_VERSION) {
+        memcpy(modulesGrid.data, QRCODE_TEMPLATE_MODULES[version - 1], modulesGrid.capacityBytes);
+        memcpy(isFunctionGrid.data, QRCODE_TEMPLATE_FUNCTION[version - 1], isFunctionGrid.capacityBytes);
+    } else
+#endif
+    {
+        drawFunctionPatterns(&modulesGrid, &isFunctionGrid, version, eccFormatBits);
+    }
     performErrorCorrection(version, eccFormatBits, &codewords);
     drawCodewords(&modulesGrid, &isFunctionGrid, &codewords);
     
-    // Find the best (lowest penalty) mask
-    uint8_t mask = 0;
-    int32_t minPenalty = INT32_MAX;
-    for (uint8_t i = 0; i < 8; i++) {
-        drawFormatBits(&modulesGrid, &isFunctionGrid, eccFormatBits, i);
-        applyMask(&modulesGrid, &isFunctionGrid, i);
-        int penalty = getPenaltyScore(&modulesGrid);
-        if (penalty < minPenalty) {
-            mask = i;
-            minPenalty = penalty;
+    if (size <= BW_MAX_SIZE) {
+        bw_row_t moduleRows[size];
+        bw_row_t isFunctionRows[size];
+        bw_loadRows(&modulesGrid, moduleRows);
+        bw_loadRows(&isFunctionGrid, isFunctionRows);
+
+        // Find the best (lowest penalty) mask, unless the caller pinned one
+        if (mask == QRCODE_MASK_AUTO) {
+            mask = bw_findBestMask(&modulesGrid, &isFunctionGrid, moduleRows, isFunctionRows, eccFormatBits);
+        }
+
+        // Overwrite old format bits
+        drawFormatBits(&modulesGrid, &isFunctionGrid, eccFormatBits, mask);
+        bw_loadFormatModules(&modulesGrid, moduleRows);
+
+        // Apply the final choice of mask
+        bw_applyMask(moduleRows, isFunctionRows, size, mask, moduleRows);
+        bw_storeRows(&modulesGrid, moduleRows);
+
+    } else {
+        // Find the best (lowest penalty) mask, unless the caller pinned one
+        if (mask == QRCODE_MASK_AUTO) {
+            int32_t minPenalty = INT32_MAX;
+            for (uint8_t i = 0; i < 8; i++) {
+                drawFormatBits(&modulesGrid, &isFunctionGrid, eccFormatBits, i);
+                applyMask(&modulesGrid, &isFunctionGrid, i);
+                int penalty = getPenaltyScore(&modulesGrid);
+                if (penalty < minPenalty) {
+                    mask = i;
+                    minPenalty = penalty;
+                }
+                applyMask(&modulesGrid, &isFunctionGrid, i);  // Undoes the mask due to XOR
+            }
         }
-        applyMask(&modulesGrid, &isFunctionGrid, i);  // Undoes the mask due to XOR
+
+        // Overwrite old format bits
+        drawFormatBits(&modulesGrid, &isFunctionGrid, eccFormatBits, mask);
+
+        // Apply the final choice of mask
+        applyMask(&modulesGrid, &isFunctionGrid, mask);
     }
-    
+
     qrcode->mask = mask;
-    
-    // Overwrite old format bits
-    drawFormatBits(&modulesGrid, &isFunctionGrid, eccFormatBits, mask);
-    
-    // Apply the final choice of mask
-    applyMask(&modulesGrid, &isFunctionGrid, mask);
 
     return 0;
 }
 
+int8_t qrcode_initBytes(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, uint8_t *data, uint16_t length) {
+    return qrcode_initBytesWithMask(qrcode, modules, version, ecc, data, length, QRCODE_MASK_AUTO);
+}
+
 int8_t qrcode_initText(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, const char *data) {
     return qrcode_initBytes(qrcode, modules, version, ecc, (uint8_t*)data, strlen(data));
 }
 
+int8_t qrcode_initTextWithMask(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, const char *data, int8_t mask) {
+    return qrcode_initBytesWithMask(qrcode, modules, version, ecc, (uint8_t*)data, strlen(data), mask);
+}
+
 bool qrcode_getModule(QRCode *qrcode, uint8_t x, uint8_t y) {
     if (x < 0 || x >= qrcode->size || y < 0 || y >= qrcode->size) {
         return false;
@@ -61,6 +61,10 @@
 #define ECC_QUARTILE       2
 #define ECC_HIGH           3
 
+// Pass as the mask to the *WithMask functions to pick the lowest penalty mask automatically.
+// Pinning a mask (0-7) skips the mask search, trading scan robustness for generation time.
+#define QRCODE_MASK_AUTO   -1
+
 
 // If set to non-zero, this library can ONLY produce QR codes at that version
 // This saves a lot of dynamic memory, as the codeword tables are skipped
@@ -90,6 +94,9 @@ uint16_t qrcode_getBufferSize(uint8_t version);
 int8_t qrcode_initText(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, const char *data);
 int8_t qrcode_initBytes(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, uint8_t *data, uint16_t length);
 
+int8_t qrcode_initTextWithMask(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, const char *data, int8_t mask);
+int8_t qrcode_initBytesWithMask(QRCode *qrcode, uint8_t *modules, uint8_t version, uint8_t ecc, uint8_t *data, uint16_t length, int8_t mask);
+
 bool qrcode_getModule(QRCode *qrcode, uint8_t x, uint8_t y);
 
 
@@ -31,12 +31,35 @@
 #define SPI_PORT spi1
 #define I2C_PORT spi1
 
+// Interrupt line for LCD DMA completion. The SD card driver defaults to DMA_IRQ_0, and its channels
+// are claimed from the same pool, so the two only ever share an IRQ if the SD driver is moved over
+#define LCD_DMA_IRQ DMA_IRQ_1
+
 uint slice_num;
+
+static int lcdDmaChannel = -1;
+static volatile bool lcdDmaBusy = false;
+static volatile bool lcdSpiFinishPending = false;    // DMA done, SPI may still be shifting, CS still low
+static const uint8_t *lcdDmaNextRow;
+static uint32_t lcdDmaRowLen;
+static uint32_t lcdDmaStride;
+static uint32_t lcdDmaRowsLeft;
+
+// Generated rows are ping-ponged between two buffers: one being sent while the other is filled
+static DEV_SPI_FillRow lcdDmaFillRow;
+static uint32_t lcdDmaRowCount;
+static uint32_t lcdDmaNextFill;
+static uint8_t lcdDmaRowBuffers[2][DEV_SPI_DMA_MAX_ROW_LEN] __attribute__((aligned(4)));
 /**
  * GPIO read and write
 **/
 void DEV_Digital_Write(UWORD Pin, UBYTE Value)
 {
+    // DC and CS belong to the DMA transfer until it finishes, flipping either mid-frame would turn
+    // the rest of the pixels into commands or cut them off
+    if (Pin == LCD_DC_PIN || Pin == LCD_CS_PIN) {
+        DEV_SPI_DMA_Wait();
+    }
     gpio_put(Pin, Value);
 }
 
@@ -50,14 +73,157 @@ UBYTE DEV_Digital_Read(UWORD Pin)
 **/
 void DEV_SPI_WriteByte(uint8_t Value)
 {
+    DEV_SPI_DMA_Wait();
     spi_write_blocking(SPI_PORT, &Value, 1);
 }
 
 void DEV_SPI_Write_nByte(uint8_t pData[], uint32_t Len)
 {
+    DEV_SPI_DMA_Wait();
     spi_write_blocking(SPI_PORT, pData, Len);
 }
 
+/**
+ * SPI DMA
+**/
+static void DEV_SPI_DMA_Handler(void)
+{
+    // Shared handler, only acknowledge our own channel
+    if (lcdDmaChannel < 0 || !(dma_hw->ints1 & (1u << lcdDmaChannel))) {
+        return;
+    }
+    dma_hw->ints1 = (1u << lcdDmaChannel);
+
+    if (--lcdDmaRowsLeft > 0) {
+        if (lcdDmaFillRow) {
+            uint8_t *sent = (uint8_t *)lcdDmaNextRow;
+            lcdDmaNextRow = (sent == lcdDmaRowBuffers[0]) ? lcdDmaRowBuffers[1] : lcdDmaRowBuffers[0];
+            dma_channel_transfer_from_buffer_now(lcdDmaChannel, lcdDmaNextRow, lcdDmaRowLen);
+
+            // The row just sent is done with its buffer, generate the one after the row now going out
+            if (lcdDmaNextFill < lcdDmaRowCount) {
+                lcdDmaFillRow(lcdDmaNextFill++, sent);
+            }
+        } else {
+            lcdDmaNextRow += lcdDmaStride;
+            dma_channel_transfer_from_buffer_now(lcdDmaChannel, lcdDmaNextRow, lcdDmaRowLen);
+        }
+        return;
+    }
+
+    // The DMA is done once the last byte is in the TX FIFO. Waiting here for it to be shifted out
+    // would hold off other interrupts, so that (and releasing CS) is left to DEV_SPI_Finish()
+    lcdSpiFinishPending = true;
+    lcdDmaBusy = false;
+}
+
+// Completes a transfer the DMA has finished feeding: waits out the bytes still in the SPI, then
+// releases CS. Called outside the interrupt, before anything else touches the bus
+static void DEV_SPI_Finish(void)
+{
+    if (!lcdSpiFinishPending) {
+        return;
+    }
+
+    while (spi_is_busy(SPI_PORT)) {
+        tight_loop_contents();
+    }
+
+    // Nothing reads the RX side during TX-only DMA, discard it the same way spi_write_blocking does
+    while (spi_is_readable(SPI_PORT)) {
+        (void)spi_get_hw(SPI_PORT)->dr;
+    }
+    spi_get_hw(SPI_PORT)->icr = SPI_SSPICR_RORIC_BITS;
+
+    // Not DEV_Digital_Write(), which waits on transfers and so comes back here
+    gpio_put(LCD_CS_PIN, 1);
+    lcdSpiFinishPending = false;
+}
+
+static void DEV_SPI_DMA_Init(void)
+{
+    lcdDmaChannel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(lcdDmaChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, spi_get_dreq(SPI_PORT, true));
+    dma_channel_configure(lcdDmaChannel, &config, &spi_get_hw(SPI_PORT)->dr, NULL, 0, false);
+
+    dma_channel_set_irq1_enabled(lcdDmaChannel, true);
+    irq_add_shared_handler(LCD_DMA_IRQ, DEV_SPI_DMA_Handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(LCD_DMA_IRQ, true);
+}
+
+void DEV_SPI_Write_Rows_DMA(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows)
+{
+    DEV_SPI_DMA_Wait();
+    if (RowLen == 0 || Rows == 0) {
+        DEV_Digital_Write(LCD_CS_PIN, 1);
+        return;
+    }
+
+    // Contiguous rows go out as a single transfer
+    if (Stride == RowLen) {
+        RowLen *= Rows;
+        Rows = 1;
+    }
+
+    lcdDmaFillRow = NULL;
+    lcdDmaNextRow = pData;
+    lcdDmaRowLen = RowLen;
+    lcdDmaStride = Stride;
+    lcdDmaRowsLeft = Rows;
+    lcdDmaBusy = true;
+
+    dma_channel_transfer_from_buffer_now(lcdDmaChannel, pData, RowLen);
+}
+
+void DEV_SPI_Write_Rows_DMA_Fill(uint32_t RowLen, uint32_t Rows, DEV_SPI_FillRow FillRow)
+{
+    DEV_SPI_DMA_Wait();
+    if (RowLen == 0 || Rows == 0 || RowLen > DEV_SPI_DMA_MAX_ROW_LEN) {
+        DEV_Digital_Write(LCD_CS_PIN, 1);
+        return;
+    }
+
+    // Both buffers start full, so the interrupt only ever refills the buffer that was just sent
+    FillRow(0, lcdDmaRowBuffers[0]);
+    lcdDmaNextFill = 1;
+    if (Rows > 1) {
+        FillRow(lcdDmaNextFill++, lcdDmaRowBuffers[1]);
+    }
+
+    lcdDmaFillRow = FillRow;
+    lcdDmaRowCount = Rows;
+    lcdDmaNextRow = lcdDmaRowBuffers[0];
+    lcdDmaRowLen = RowLen;
+    lcdDmaRowsLeft = Rows;
+    lcdDmaBusy = true;
+
+    dma_channel_transfer_from_buffer_now(lcdDmaChannel, lcdDmaRowBuffers[0], RowLen);
+}
+
+bool DEV_SPI_DMA_Busy(void)
+{
+    if (lcdDmaBusy || (lcdSpiFinishPending && spi_is_busy(SPI_PORT))) {
+        return true;
+    }
+
+    // Only the last few bytes' worth of shifting could have been left, and that has now finished
+    DEV_SPI_Finish();
+    return false;
+}
+
+void DEV_SPI_DMA_Wait(void)
+{
+    while (lcdDmaBusy) {
+        tight_loop_contents();
+    }
+    DEV_SPI_Finish();
+}
+
 /**
  * GPIO Mode
 **/
@@ -124,6 +290,7 @@ UBYTE DEV_Module_Init(void)
     spi_init(SPI_PORT, 10000 * 1000);
     gpio_set_function(LCD_CLK_PIN, GPIO_FUNC_SPI);
     gpio_set_function(LCD_MOSI_PIN, GPIO_FUNC_SPI);
+    DEV_SPI_DMA_Init();
     
     // GPIO Config
     DEV_GPIO_Init();
@@ -167,5 +334,6 @@ Info:
 ******************************************************************************/
 void DEV_Module_Exit(void)
 {
+    DEV_SPI_DMA_Wait();
 
 }
@@ -32,6 +32,8 @@
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
 #include "hardware/pwm.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "stdio.h"
 // #include "hardware/i2c.h"
 
@@ -68,6 +70,26 @@ UBYTE DEV_Digital_Read(UWORD Pin);
 void DEV_SPI_WriteByte(UBYTE Value);
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len);
 
+/**
+ * Non-blocking SPI writes. Rows bytes long rows, Stride bytes apart, are streamed out by DMA.
+ * A Stride of 0 sends the same row Rows times.
+ * The caller asserts CS/DC before starting. CS is released once the last byte has left the SPI,
+ * by the DEV_SPI_DMA_Busy() or DEV_SPI_DMA_Wait() call that first sees the transfer complete.
+ * DEV_Digital_Write() on LCD_DC_PIN or LCD_CS_PIN waits for any transfer in flight, so a command
+ * can't be started (nor CS dropped) while pixel data is still going out
+**/
+void DEV_SPI_Write_Rows_DMA(const uint8_t *pData, uint32_t RowLen, uint32_t Stride, uint32_t Rows);
+
+/**
+ * As DEV_SPI_Write_Rows_DMA, but each row is generated by FillRow(row, buffer) just before it is
+ * needed, so the image never has to exist in full. FillRow is called from the DMA interrupt
+**/
+#define DEV_SPI_DMA_MAX_ROW_LEN 256
+typedef void (*DEV_SPI_FillRow)(uint32_t Row, uint8_t *pData);
+void DEV_SPI_Write_Rows_DMA_Fill(uint32_t RowLen, uint32_t Rows, DEV_SPI_FillRow FillRow);
+bool DEV_SPI_DMA_Busy(void);
+void DEV_SPI_DMA_Wait(void);
+
 void DEV_Delay_ms(UDOUBLE xms);
 void DEV_Delay_us(UDOUBLE xus);
 
@@ -247,30 +247,32 @@ void LCD_1IN44_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
     // printf("%d %d\r\n",x,y);
 }
 
+// Only one row is held: a zero stride streams it out for every row of the window. Static, as the
+// DMA is still reading it after LCD_1IN44_Clear() returns
+static UWORD LCD_1IN44_ClearRow[(LCD_1IN44_WIDTH > LCD_1IN44_HEIGHT) ? LCD_1IN44_WIDTH : LCD_1IN44_HEIGHT];
+
 /******************************************************************************
-function :	Clear screen
+function :	Clear screen. Returns once the transfer has started, the next
+            command waits for it to finish
 parameter:
 ******************************************************************************/
 void LCD_1IN44_Clear(UWORD Color)
 {
-    UWORD j,i;
-    UWORD Image[LCD_1IN44.WIDTH*LCD_1IN44.HEIGHT];
-    
+    UWORD j;
+
+    // A previous clear may still be sending the row
+    DEV_SPI_DMA_Wait();
+
     Color = ((Color<<8)&0xff00)|(Color>>8);
-   
-    for (j = 0; j < LCD_1IN44.HEIGHT*LCD_1IN44.WIDTH; j++) {
-        Image[j] = Color;
+
+    for (j = 0; j < LCD_1IN44.WIDTH; j++) {
+        LCD_1IN44_ClearRow[j] = Color;
     }
-    
+
     LCD_1IN44_SetWindows(0, 0, LCD_1IN44.WIDTH, LCD_1IN44.HEIGHT);
     DEV_Digital_Write(LCD_DC_PIN, 1);
     DEV_Digital_Write(LCD_CS_PIN, 0);
-    // printf("HEIGHT %d, WIDTH %d\r\n",LCD_1IN44.HEIGHT,LCD_1IN44.WIDTH);
-    for(j = 0; j < LCD_1IN44.HEIGHT; j++){
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN44.WIDTH], LCD_1IN44.WIDTH*2);
-        
-    }
-    DEV_Digital_Write(LCD_CS_PIN, 1);
+    DEV_SPI_Write_Rows_DMA((const uint8_t *)LCD_1IN44_ClearRow, LCD_1IN44.WIDTH*2, 0, LCD_1IN44.HEIGHT);
 }
 
 /******************************************************************************
@@ -299,13 +301,37 @@ void LCD_1IN44_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend
     LCD_1IN44_SetWindows(Xstart, Ystart, Xend , Yend);
     DEV_Digital_Write(LCD_DC_PIN, 1);
     DEV_Digital_Write(LCD_CS_PIN, 0);
-    for (j = Ystart; j < Yend - 1; j++) {
+    for (j = Ystart; j < Yend; j++) {
         Addr = Xstart + j * LCD_1IN44.WIDTH ;
         DEV_SPI_Write_nByte((uint8_t *)&Image[Addr], (Xend-Xstart)*2);
     }
     DEV_Digital_Write(LCD_CS_PIN, 1);
 }
 
+/******************************************************************************
+function :	Starts sending a window to the display and returns straight away.
+            Each row is generated by FillRow(row - Ystart, buffer) as the
+            transfer reaches it, as (Xend - Xstart) RGB565 pixels, high byte first
+parameter:
+******************************************************************************/
+void LCD_1IN44_DisplayWindowsFill(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, DEV_SPI_FillRow FillRow)
+{
+    LCD_1IN44_SetWindows(Xstart, Ystart, Xend , Yend);
+    DEV_Digital_Write(LCD_DC_PIN, 1);
+    DEV_Digital_Write(LCD_CS_PIN, 0);
+    DEV_SPI_Write_Rows_DMA_Fill((Xend-Xstart)*2, Yend-Ystart, FillRow);
+}
+
+bool LCD_1IN44_IsBusy(void)
+{
+    return DEV_SPI_DMA_Busy();
+}
+
+void LCD_1IN44_WaitIdle(void)
+{
+    DEV_SPI_DMA_Wait();
+}
+
 void LCD_1IN44_DisplayPoint(UWORD X, UWORD Y, UWORD Color)
 {
     LCD_1IN44_SetWindows(X,Y,X,Y);
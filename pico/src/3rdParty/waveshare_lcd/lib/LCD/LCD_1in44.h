@@ -46,6 +46,9 @@ void LCD_1IN44_Init(UBYTE Scan_dir);
 void LCD_1IN44_Clear(UWORD Color);
 void LCD_1IN44_Display(UWORD *Image);
 void LCD_1IN44_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD *Image);
+void LCD_1IN44_DisplayWindowsFill(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, DEV_SPI_FillRow FillRow);
+bool LCD_1IN44_IsBusy(void);
+void LCD_1IN44_WaitIdle(void);
 void LCD_1IN44_DisplayPoint(UWORD X, UWORD Y, UWORD Color);
 void Handler_1IN44_LCD(int signo);
 #endif
@@ -17,6 +17,13 @@ typedef struct {
     uint16_t displayHeight;
 } WalletDisplayInfo;
 
+typedef struct {
+    uint32_t lastFlushBytes;        // Pixel bytes sent to the panel by the most recent paint
+    uint32_t totalFlushBytes;       // Pixel bytes sent to the panel since startup
+    uint32_t framesPainted;
+    uint32_t lastPixelWrites;       // Framebuffer pixels written while drawing the most recent paint
+} WalletDisplayStats;
+
 typedef struct {
     const uint8_t charWidth;        // Width of a single character glyph, in bits
     const uint8_t charHeight;       // Height of a single character glyph, in bits
@@ -28,14 +35,22 @@ typedef struct {
 // Setup functions
 int init_display();
 const WalletDisplayInfo* get_display_info();
+const WalletDisplayStats* get_display_stats();
 void update_display(WalletScreen* screen);
+bool is_display_flush_complete();           // True once the last painted frame has reached the panel
+void wait_for_display_flush();
 void shutdown_display();
 
+// Times GUI_Paint against the raster layer on representative screens and prints the results
+void run_display_benchmark(uint32_t iterations);
+
 
 // Drawing interface functions
 void wallet_gfx_clear_display(WalletPaintColor color);
 void wallet_gfx_draw_char(uint16_t xPos, uint16_t yPos, char c, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor);
 void wallet_gfx_draw_string(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor);
+// Same as wallet_gfx_draw_string(), but nothing is kept in the text caches. For secrets such as seed words
+void wallet_gfx_draw_string_uncached(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor);
 void wallet_gfx_draw_bitmap(const uint8_t* bitmap, uint16_t xPos, uint16_t yPos, uint16_t bitmapWidth, uint16_t bitmapHeight);
 void wallet_gfx_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t lineWidth, WalletPaintColor color);
 void wallet_gfx_draw_circle(uint16_t centerX, uint16_t centerY, uint16_t radius, uint8_t lineWidth, bool filled, WalletPaintColor color);
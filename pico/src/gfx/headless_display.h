@@ -0,0 +1,57 @@
+#ifndef _HEADLESS_DISPLAY_H_
+#define _HEADLESS_DISPLAY_H_
+
+#include "gfx_utils.h"
+
+// Host only. headless_gfx_interface.c implements gfx_utils.h without a panel, so screens can be
+// rendered, inspected and benchmarked on a desktop. Link it in place of waveshare_gfx_interface.c,
+// as the HostDisplay target does
+
+#define HEADLESS_DISPLAY_WIDTH      (128)
+#define HEADLESS_DISPLAY_HEIGHT     (128)
+
+
+typedef struct {
+    uint32_t frameNumber;           // Frames painted so far, the most recent being this one
+    uint32_t drawTimeUs;            // Time from the start of painting until the RGB565 frame was ready
+    uint32_t pixelWrites;           // Framebuffer pixels written while drawing
+    uint32_t frameHash;             // FNV-1a over the RGB565 frame, for spotting rendering changes
+    uint64_t totalDrawTimeUs;
+    uint64_t totalPixelWrites;
+} HeadlessFrameStats;
+
+
+/**
+ * The most recently painted frame, as HEADLESS_DISPLAY_WIDTH x HEADLESS_DISPLAY_HEIGHT RGB565
+ * pixels in screen orientation, row-major
+ */
+const uint16_t* headless_display_frame();
+
+const HeadlessFrameStats* headless_display_frame_stats();
+
+/**
+ * Write the most recently painted frame as a binary PPM (P6) image
+ *
+ * path                 in      File to be written
+ *
+ * Returns false if the file could not be written
+ */
+bool headless_display_save_ppm(const char* path);
+
+/**
+ * Save every frame painted from now on to <directory>/frame_<frame number>.ppm. NULL stops saving
+ */
+void headless_display_set_snapshot_dir(const char* directory);
+
+/**
+ * Paint a screen repeatedly and print the average draw time and pixel writes per frame
+ *
+ * name                 in      Label for the printed results
+ * screen               in      The screen to be painted, drawn as it currently is
+ * iterations           in      Number of times to paint it
+ * ppmPath              in      If not NULL, the final frame is saved here
+ */
+void headless_benchmark_screen(const char* name, WalletScreen* screen, uint32_t iterations, const char* ppmPath);
+
+
+#endif      // _HEADLESS_DISPLAY_H_
@@ -0,0 +1,260 @@
+// clock_gettime() is POSIX, not part of strict C11
+#define _POSIX_C_SOURCE 199309L
+
+#include "gfx_utils.h"
+#include "headless_display.h"
+#include "text_cache.h"
+#include "wallet_fonts.h"
+#include "wallet_raster.h"
+
+#include <stdio.h>
+#include <time.h>
+
+// Draws through the same raster layer and text caches as the panel backend, in screen orientation,
+// then expands each painted frame to RGB565 in place of sending it to a panel
+static uint8_t imageBuffer[(HEADLESS_DISPLAY_WIDTH * HEADLESS_DISPLAY_HEIGHT) / 2];
+static uint16_t frameBuffer[HEADLESS_DISPLAY_WIDTH * HEADLESS_DISPLAY_HEIGHT];
+static RasterPalette displayPalette;
+static RasterSurface drawSurface;
+static WalletDisplayInfo headlessDisplay;
+static WalletDisplayStats displayStats;
+static HeadlessFrameStats frameStats;
+static const char* snapshotDir;
+
+// Revision of the screen currently in frameBuffer
+static uint32_t paintedRevision;
+static bool displayPainted = false;
+
+
+static uint64_t get_time_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000u) + (now.tv_nsec / 1000);
+}
+
+// Same set of fonts, and pen sizes, as the panel backend accepts
+static bool is_known_font(const WalletFont* font) {
+    return (font == &PW_FONT_SMALL) || (font == &PW_FONT_MED) || (font == &PW_FONT_LARGE);
+}
+
+static uint8_t to_pen_size(uint8_t lineWidth) {
+    if(lineWidth < 1) {
+        return 1;
+    }
+
+    return (lineWidth > 8) ? 8 : lineWidth;
+}
+
+// Follows the same wrapping rules as the panel backend
+static void draw_string(uint16_t xPos, uint16_t yPos, const char* string, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor, bool useCache) {
+    if(!is_known_font(font)) {
+        return;
+    }
+
+    text_draw_string(&drawSurface, xPos, yPos, string, font, foregroundColor, backgroundColor, useCache, NULL);
+}
+
+// FNV-1a over the frame
+static uint32_t hash_frame() {
+    const uint8_t* bytes = (const uint8_t*) frameBuffer;
+    uint32_t hash = 2166136261u;
+
+    for(int i = 0; i < sizeof(frameBuffer); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static void paint_screen(WalletScreen* screen) {
+    uint64_t startTime = get_time_us();
+    uint32_t pixelWrites = drawSurface.pixelWrites;
+
+    raster_clear(&drawSurface, PW_BLACK);
+    if(screen->drawFunction) {
+        screen->drawFunction(screen);
+    }
+
+    // Expanded rows come out high byte first, as a panel takes them
+    for(int y = 0; y < HEADLESS_DISPLAY_HEIGHT; ++y) {
+        uint16_t* row = &frameBuffer[y * HEADLESS_DISPLAY_WIDTH];
+        raster_expand_row(&drawSurface, y, 0, HEADLESS_DISPLAY_WIDTH, (uint8_t*) row);
+
+        for(int x = 0; x < HEADLESS_DISPLAY_WIDTH; ++x) {
+            row[x] = (uint16_t) ((row[x] << 8) | (row[x] >> 8));
+        }
+    }
+
+    ++frameStats.frameNumber;
+    frameStats.drawTimeUs = (uint32_t) (get_time_us() - startTime);
+    frameStats.pixelWrites = (drawSurface.pixelWrites - pixelWrites);
+    frameStats.frameHash = hash_frame();
+    frameStats.totalDrawTimeUs += frameStats.drawTimeUs;
+    frameStats.totalPixelWrites += frameStats.pixelWrites;
+
+    ++displayStats.framesPainted;
+    displayStats.lastPixelWrites = frameStats.pixelWrites;
+    displayStats.lastFlushBytes = sizeof(frameBuffer);
+    displayStats.totalFlushBytes += sizeof(frameBuffer);
+
+    if(snapshotDir) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/frame_%05lu.ppm", snapshotDir, (unsigned long) frameStats.frameNumber);
+        headless_display_save_ppm(path);
+    }
+}
+
+int init_display() {
+    // Index 0 is black, which is what a zeroed buffer holds
+    raster_palette_index(&displayPalette, PW_BLACK);
+    raster_init(&drawSurface, imageBuffer, HEADLESS_DISPLAY_WIDTH, HEADLESS_DISPLAY_HEIGHT, RASTER_ROTATE_0, &displayPalette);
+
+    headlessDisplay.displayWidth = drawSurface.width;
+    headlessDisplay.displayHeight = drawSurface.height;
+
+    return 0;
+}
+
+const WalletDisplayInfo* get_display_info() {
+    return &headlessDisplay;
+}
+
+const WalletDisplayStats* get_display_stats() {
+    return &displayStats;
+}
+
+void update_display(WalletScreen* screen) {
+    // Nothing to do unless the screen has changed since it was last painted
+    if(!screen || (displayPainted && (screen->revision == paintedRevision))) {
+        return;
+    }
+
+    paint_screen(screen);
+
+    paintedRevision = screen->revision;
+    displayPainted = true;
+}
+
+// There is no GUI_Paint to compare against here, screens are benchmarked individually instead
+void run_display_benchmark(uint32_t iterations) {
+    printf("Headless display: use headless_benchmark_screen() to time individual screens\n");
+}
+
+bool is_display_flush_complete() {
+    return true;
+}
+
+void wait_for_display_flush() {
+}
+
+void shutdown_display() {
+}
+
+const uint16_t* headless_display_frame() {
+    return frameBuffer;
+}
+
+const HeadlessFrameStats* headless_display_frame_stats() {
+    return &frameStats;
+}
+
+bool headless_display_save_ppm(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if(!file) {
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", HEADLESS_DISPLAY_WIDTH, HEADLESS_DISPLAY_HEIGHT);
+
+    uint8_t row[HEADLESS_DISPLAY_WIDTH * 3];
+    for(int y = 0; y < HEADLESS_DISPLAY_HEIGHT; ++y) {
+        for(int x = 0; x < HEADLESS_DISPLAY_WIDTH; ++x) {
+            uint16_t pixel = frameBuffer[(y * HEADLESS_DISPLAY_WIDTH) + x];
+            uint8_t red = ((pixel >> 11) & 0x1F);
+            uint8_t green = ((pixel >> 5) & 0x3F);
+            uint8_t blue = (pixel & 0x1F);
+
+            // Replicate the top bits into the bottom ones, so full intensity maps to 255
+            row[(x * 3) + 0] = (red << 3) | (red >> 2);
+            row[(x * 3) + 1] = (green << 2) | (green >> 4);
+            row[(x * 3) + 2] = (blue << 3) | (blue >> 2);
+        }
+
+        fwrite(row, 1, sizeof(row), file);
+    }
+
+    bool written = !ferror(file);
+    return (fclose(file) == 0) && written;
+}
+
+void headless_display_set_snapshot_dir(const char* directory) {
+    snapshotDir = directory;
+}
+
+void headless_benchmark_screen(const char* name, WalletScreen* screen, uint32_t iterations, const char* ppmPath) {
+    if(!screen || (iterations == 0)) {
+        return;
+    }
+
+    // Snapshots would be timed along with the drawing
+    const char* savedSnapshotDir = snapshotDir;
+    snapshotDir = NULL;
+
+    uint64_t totalTime = 0;
+    uint64_t totalPixelWrites = 0;
+    for(uint32_t i = 0; i < iterations; ++i) {
+        paint_screen(screen);
+        totalTime += frameStats.drawTimeUs;
+        totalPixelWrites += frameStats.pixelWrites;
+    }
+
+    snapshotDir = savedSnapshotDir;
+
+    // What's in frameBuffer no longer matches the revision update_display() last painted
+    displayPainted = false;
+
+    printf("%-24s %6lu us/frame, %6lu pixel writes/frame, hash %08lx\n", name, (unsigned long) (totalTime / iterations),
+        (unsigned long) (totalPixelWrites / iterations), (unsigned long) frameStats.frameHash);
+
+    if(ppmPath && !headless_display_save_ppm(ppmPath)) {
+        printf("Failed to write %s\n", ppmPath);
+    }
+}
+
+// Drawing interface functions
+void wallet_gfx_clear_display(WalletPaintColor color) {
+    raster_clear(&drawSurface, color);
+}
+
+void wallet_gfx_draw_char(uint16_t xPos, uint16_t yPos, char c, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
+    if(!is_known_font(font)) {
+        return;
+    }
+
+    text_draw_glyph(&drawSurface, xPos, yPos, c, font, foregroundColor, backgroundColor, true);
+}
+
+void wallet_gfx_draw_string(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
+    draw_string(xPos, yPos, string, font, foregroundColor, backgroundColor, true);
+}
+
+void wallet_gfx_draw_string_uncached(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
+    draw_string(xPos, yPos, string, font, foregroundColor, backgroundColor, false);
+}
+
+void wallet_gfx_draw_bitmap(const uint8_t* bitmap, uint16_t xPos, uint16_t yPos, uint16_t bitmapWidth, uint16_t bitmapHeight) {
+    raster_draw_image(&drawSurface, bitmap, xPos, yPos, bitmapWidth, bitmapHeight);
+}
+
+void wallet_gfx_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t lineWidth, WalletPaintColor color) {
+    raster_draw_line(&drawSurface, x1, y1, x2, y2, to_pen_size(lineWidth), color);
+}
+
+void wallet_gfx_draw_circle(uint16_t centerX, uint16_t centerY, uint16_t radius, uint8_t lineWidth, bool filled, WalletPaintColor color) {
+    raster_draw_circle(&drawSurface, centerX, centerY, radius, to_pen_size(lineWidth), filled, color);
+}
+
+void wallet_gfx_draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t lineWidth, bool filled, WalletPaintColor color) {
+    raster_draw_rectangle(&drawSurface, x1, y1, x2, y2, to_pen_size(lineWidth), filled, color);
+}
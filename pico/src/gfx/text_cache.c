@@ -0,0 +1,242 @@
+#include "text_cache.h"
+#include "utils/secure_zero.h"
+
+#include <string.h>
+
+
+typedef struct {
+    const WalletFont* font;
+    uint16_t foregroundColor;
+    uint16_t backgroundColor;
+    uint16_t rotation;
+    char c;
+    uint32_t lastUsed;                          // 0 if the slot is empty
+    uint8_t pixels[RASTER_BLOCK_MAX_BYTES(GLYPH_ATLAS_MAX_GLYPH_WIDTH, GLYPH_ATLAS_MAX_GLYPH_HEIGHT)];
+} GlyphAtlasEntry;
+
+typedef struct {
+    const WalletFont* font;
+    uint16_t foregroundColor;
+    uint16_t backgroundColor;
+    uint16_t rotation;
+    uint8_t length;
+    char text[STRING_CACHE_MAX_TEXT_LENGTH];
+    uint16_t poolOffset;                        // Start of the rendered text in stringPool, in bytes
+    uint16_t byteCount;
+    uint32_t lastUsed;                          // 0 if the slot is empty
+} StringCacheEntry;
+
+#define GLYPH_ATLAS_NUM_ENTRIES             (GLYPH_ATLAS_RAM_BUDGET / sizeof(GlyphAtlasEntry))
+#define STRING_POOL_BYTES                   (STRING_CACHE_RAM_BUDGET)
+
+
+static GlyphAtlasEntry glyphAtlas[GLYPH_ATLAS_NUM_ENTRIES];
+static StringCacheEntry stringCache[STRING_CACHE_MAX_ENTRIES];
+static uint8_t stringPool[STRING_POOL_BYTES];
+static uint16_t stringPoolHead;
+static uint32_t textCacheUseCounter;
+
+
+const uint8_t* get_glyph_bits(const WalletFont* font, char c) {
+    int bytesPerRow = ((font->charWidth + 7) / 8);
+    return &font->glyphs[(c - ' ') * font->charHeight * bytesPerRow];
+}
+
+// Render text into block, laid out as the surface would hold it
+static void render_text(const RasterSurface* surface, uint8_t* block, const char* text, int length, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor) {
+    uint16_t nativeWidth, nativeHeight;
+    raster_native_size(surface, (length * font->charWidth), font->charHeight, &nativeWidth, &nativeHeight);
+
+    RasterSurface blockSurface;
+    raster_init(&blockSurface, block, nativeWidth, nativeHeight, surface->rotation, surface->palette);
+
+    for(int i = 0; i < length; ++i) {
+        raster_draw_glyph(&blockSurface, (i * font->charWidth), 0, get_glyph_bits(font, text[i]), font->charWidth, font->charHeight, foregroundColor, backgroundColor);
+    }
+}
+
+static GlyphAtlasEntry* get_free_glyph_entry() {
+    GlyphAtlasEntry* oldest = &glyphAtlas[0];
+
+    for(int i = 0; i < GLYPH_ATLAS_NUM_ENTRIES; ++i) {
+        if(!glyphAtlas[i].lastUsed) {
+            return &glyphAtlas[i];
+        }
+
+        if(glyphAtlas[i].lastUsed < oldest->lastUsed) {
+            oldest = &glyphAtlas[i];
+        }
+    }
+
+    return oldest;
+}
+
+static StringCacheEntry* get_free_string_entry() {
+    StringCacheEntry* oldest = &stringCache[0];
+
+    for(int i = 0; i < STRING_CACHE_MAX_ENTRIES; ++i) {
+        if(!stringCache[i].lastUsed) {
+            return &stringCache[i];
+        }
+
+        if(stringCache[i].lastUsed < oldest->lastUsed) {
+            oldest = &stringCache[i];
+        }
+    }
+
+    oldest->lastUsed = 0;
+    return oldest;
+}
+
+// Rendered strings are allocated from stringPool as a ring. Anything the new allocation overlaps is
+// evicted, which keeps allocation trivial at the cost of evicting in roughly first in, first out order
+static uint16_t allocate_string_bytes(uint16_t byteCount) {
+    if((stringPoolHead + byteCount) > STRING_POOL_BYTES) {
+        stringPoolHead = 0;
+    }
+
+    uint16_t start = stringPoolHead;
+    uint16_t end = (start + byteCount);
+
+    for(int i = 0; i < STRING_CACHE_MAX_ENTRIES; ++i) {
+        StringCacheEntry* entry = &stringCache[i];
+        if(entry->lastUsed && (entry->poolOffset < end) && (start < (entry->poolOffset + entry->byteCount))) {
+            entry->lastUsed = 0;
+        }
+    }
+
+    stringPoolHead = end;
+    return start;
+}
+
+
+const uint8_t* get_cached_glyph(const RasterSurface* surface, const WalletFont* font, char c, uint16_t foregroundColor, uint16_t backgroundColor) {
+    if((font->charWidth > GLYPH_ATLAS_MAX_GLYPH_WIDTH) || (font->charHeight > GLYPH_ATLAS_MAX_GLYPH_HEIGHT)) {
+        return NULL;
+    }
+
+    GlyphAtlasEntry* entry = NULL;
+    for(int i = 0; i < GLYPH_ATLAS_NUM_ENTRIES; ++i) {
+        GlyphAtlasEntry* candidate = &glyphAtlas[i];
+        if(
+            candidate->lastUsed &&
+            (candidate->c == c) &&
+            (candidate->font == font) &&
+            (candidate->foregroundColor == foregroundColor) &&
+            (candidate->backgroundColor == backgroundColor) &&
+            (candidate->rotation == surface->rotation)
+        ) {
+            entry = candidate;
+            break;
+        }
+    }
+
+    if(!entry) {
+        entry = get_free_glyph_entry();
+        render_text(surface, entry->pixels, &c, 1, font, foregroundColor, backgroundColor);
+
+        entry->font = font;
+        entry->c = c;
+        entry->foregroundColor = foregroundColor;
+        entry->backgroundColor = backgroundColor;
+        entry->rotation = surface->rotation;
+    }
+
+    entry->lastUsed = ++textCacheUseCounter;
+    return entry->pixels;
+}
+
+const uint8_t* get_cached_string(const RasterSurface* surface, const char* text, int length, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor) {
+    uint32_t byteCount = raster_block_bytes(surface, (length * font->charWidth), font->charHeight);
+
+    // Strings that would take more than half the pool would keep evicting everything else
+    if((length <= 0) || (length > STRING_CACHE_MAX_TEXT_LENGTH) || (byteCount > (STRING_POOL_BYTES / 2))) {
+        return NULL;
+    }
+
+    for(int i = 0; i < STRING_CACHE_MAX_ENTRIES; ++i) {
+        StringCacheEntry* entry = &stringCache[i];
+        if(
+            entry->lastUsed &&
+            (entry->length == length) &&
+            (entry->font == font) &&
+            (entry->foregroundColor == foregroundColor) &&
+            (entry->backgroundColor == backgroundColor) &&
+            (entry->rotation == surface->rotation) &&
+            (memcmp(entry->text, text, length) == 0)
+        ) {
+            entry->lastUsed = ++textCacheUseCounter;
+            return &stringPool[entry->poolOffset];
+        }
+    }
+
+    StringCacheEntry* entry = get_free_string_entry();
+    entry->poolOffset = allocate_string_bytes(byteCount);
+    entry->byteCount = byteCount;
+    render_text(surface, &stringPool[entry->poolOffset], text, length, font, foregroundColor, backgroundColor);
+
+    entry->font = font;
+    entry->foregroundColor = foregroundColor;
+    entry->backgroundColor = backgroundColor;
+    entry->rotation = surface->rotation;
+    entry->length = length;
+    memcpy(entry->text, text, length);
+
+    // Counter wrap would take ~4 billion lookups, so it is not worth handling
+    entry->lastUsed = ++textCacheUseCounter;
+    return &stringPool[entry->poolOffset];
+}
+
+void text_draw_glyph(RasterSurface* surface, int xPos, int yPos, char c, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor, bool useCache) {
+    bool onScreen = ((xPos >= 0) && (yPos >= 0) && ((xPos + font->charWidth) <= surface->width) && ((yPos + font->charHeight) <= surface->height));
+    const uint8_t* block = (useCache && onScreen) ? get_cached_glyph(surface, font, c, foregroundColor, backgroundColor) : NULL;
+
+    if(!block || !raster_blit(surface, xPos, yPos, block, font->charWidth, font->charHeight)) {
+        raster_draw_glyph(surface, xPos, yPos, get_glyph_bits(font, c), font->charWidth, font->charHeight, foregroundColor, backgroundColor);
+    }
+}
+
+void text_draw_string(RasterSurface* surface, int xPos, int yPos, const char* string, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor, bool useCache, TextDamageFunction onDrawn) {
+    int length = strlen(string);
+    bool singleLine = ((xPos + (length * font->charWidth)) <= surface->width) && ((yPos + font->charHeight) <= surface->height) && !strchr(string, '\n');
+    if(useCache && singleLine) {
+        const uint8_t* block = get_cached_string(surface, string, length, font, foregroundColor, backgroundColor);
+        if(block && raster_blit(surface, xPos, yPos, block, (length * font->charWidth), font->charHeight)) {
+            if(onDrawn) {
+                onDrawn(xPos, yPos, (xPos + (length * font->charWidth)), (yPos + font->charHeight));
+            }
+            return;
+        }
+    }
+
+    int x = xPos;
+    int y = yPos;
+
+    for(; *string; ++string) {
+        if(((x + font->charWidth) > surface->width) || (*string == '\n')) {
+            x = xPos;
+            y += font->charHeight;
+        }
+
+        if((y + font->charHeight) > surface->height) {
+            x = xPos;
+            y = yPos;
+        }
+
+        if(*string != '\n') {
+            text_draw_glyph(surface, x, y, *string, font, foregroundColor, backgroundColor, useCache);
+            if(onDrawn) {
+                onDrawn(x, y, (x + font->charWidth), (y + font->charHeight));
+            }
+            x += font->charWidth;
+        }
+    }
+}
+
+void text_cache_clear() {
+    secure_zero(stringCache, sizeof(stringCache));
+    secure_zero(stringPool, sizeof(stringPool));
+    memset(glyphAtlas, 0, sizeof(glyphAtlas));
+    stringPoolHead = 0;
+    textCacheUseCounter = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef _TEXT_CACHE_H_
+#define _TEXT_CACHE_H_
+
+#include "gfx_utils.h"
+#include "wallet_raster.h"
+
+
+#define GLYPH_ATLAS_RAM_BUDGET              (4 * 1024)      // Bytes of RAM set aside for rendered glyphs
+#define GLYPH_ATLAS_MAX_GLYPH_WIDTH         (10)            // Largest glyph held (PW_FONT_LARGE)
+#define GLYPH_ATLAS_MAX_GLYPH_HEIGHT        (20)
+
+#define STRING_CACHE_RAM_BUDGET             (4 * 1024)      // Bytes of RAM set aside for rendered strings
+#define STRING_CACHE_MAX_ENTRIES            (16)
+#define STRING_CACHE_MAX_TEXT_LENGTH        (24)            // Longer strings are drawn a glyph at a time
+
+
+// Told about each area text_draw_string() has drawn over, in screen coordinates. Bounds are half-open
+typedef void (*TextDamageFunction)(int x1, int y1, int x2, int y2);
+
+
+/**
+ * Fetch a glyph rendered in the supplied colours, in the surface's native orientation and ready to
+ * pass to raster_blit(). Glyphs that are not cached are rendered and stored, evicting the least
+ * recently used glyph if needed
+ *
+ * surface              in      The surface the glyph will be drawn to
+ * font                 in      Font of the glyph
+ * c                    in      Character to be drawn
+ * foregroundColor      in      Colour of set glyph bits
+ * backgroundColor      in      Colour of clear glyph bits
+ *
+ * Returns NULL if the glyph is too large for the atlas
+ */
+const uint8_t* get_cached_glyph(const RasterSurface* surface, const WalletFont* font, char c, uint16_t foregroundColor, uint16_t backgroundColor);
+
+/**
+ * Fetch a single line of text rendered in the supplied colours, in the surface's native orientation
+ * and ready to pass to raster_blit() as a (length * charWidth) x charHeight block
+ *
+ * surface              in      The surface the text will be drawn to
+ * text                 in      Text to be drawn, without line breaks
+ * length               in      Number of characters in text
+ * font                 in      Font of the text
+ * foregroundColor      in      Colour of set glyph bits
+ * backgroundColor      in      Colour of clear glyph bits
+ *
+ * Returns NULL if the text is too long to be cached
+ */
+const uint8_t* get_cached_string(const RasterSurface* surface, const char* text, int length, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor);
+
+/**
+ * The font's bitmap for a character, as raster_draw_glyph() takes it
+ */
+const uint8_t* get_glyph_bits(const WalletFont* font, char c);
+
+/**
+ * Draw a character. Glyphs that fit on the surface are copied from the atlas, anything clipped (or
+ * uncached) is drawn from the font bits
+ *
+ * surface              in/out  The surface to draw to
+ * xPos, yPos           in      Screen position of the glyph's top left corner
+ * c                    in      Character to be drawn
+ * font                 in      Font of the glyph
+ * foregroundColor      in      Colour of set glyph bits
+ * backgroundColor      in      Colour of clear glyph bits
+ * useCache             in      false to keep the glyph out of the atlas
+ */
+void text_draw_glyph(RasterSurface* surface, int xPos, int yPos, char c, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor, bool useCache);
+
+/**
+ * Draw a string, following the same wrapping rules as Paint_DrawString_EN(). A string that fits on
+ * one line comes straight from the string cache
+ *
+ * surface              in/out  The surface to draw to
+ * xPos, yPos           in      Screen position of the string's top left corner
+ * string               in      Text to be drawn, may contain line breaks
+ * font                 in      Font of the text
+ * foregroundColor      in      Colour of set glyph bits
+ * backgroundColor      in      Colour of clear glyph bits
+ * useCache             in      false to keep the text out of the caches
+ * onDrawn              in      Told about each area drawn, may be NULL
+ */
+void text_draw_string(RasterSurface* surface, int xPos, int yPos, const char* string, const WalletFont* font, uint16_t foregroundColor, uint16_t backgroundColor, bool useCache, TextDamageFunction onDrawn);
+
+/**
+ * Drop (and zeroise) every cached glyph and string
+ */
+void text_cache_clear();
+
+
+#endif      // _TEXT_CACHE_H_
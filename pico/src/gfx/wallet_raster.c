@@ -0,0 +1,507 @@
+#include "wallet_raster.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+// The panel takes pixels high byte first
+static inline uint16_t to_panel_color(uint16_t color) {
+    return (uint16_t) ((color << 8) | (color >> 8));
+}
+
+static inline int clamp_min(int value, int min) {
+    return (value < min) ? min : value;
+}
+
+static inline int clamp_max(int value, int max) {
+    return (value > max) ? max : value;
+}
+
+// Two pixels per byte, the even pixel in the high nibble
+static inline uint8_t get_pixel(const uint8_t* pixels, int32_t index) {
+    uint8_t pair = pixels[index >> 1];
+    return (index & 1) ? (pair & 0x0F) : (pair >> 4);
+}
+
+static inline void set_pixel(uint8_t* pixels, int32_t index, uint8_t value) {
+    uint8_t* pair = &pixels[index >> 1];
+    *pair = (index & 1) ? ((*pair & 0xF0) | value) : ((*pair & 0x0F) | (value << 4));
+}
+
+// Fill length pixels from index, whole bytes at a time once byte aligned
+static void fill_span(uint8_t* pixels, int32_t index, int length, uint8_t value) {
+    if((length > 0) && (index & 1)) {
+        set_pixel(pixels, index++, value);
+        --length;
+    }
+
+    memset(&pixels[index >> 1], (value * 0x11), (length >> 1));
+
+    if(length & 1) {
+        set_pixel(pixels, (index + length - 1), value);
+    }
+}
+
+static void to_native(const RasterSurface* surface, int x, int y, int* nativeX, int* nativeY) {
+    int32_t index = surface->originOffset + (x * surface->xStep) + (y * surface->yStep);
+
+    *nativeX = (index % surface->stride);
+    *nativeY = (index / surface->stride);
+}
+
+static void to_screen(const RasterSurface* surface, int nativeX, int nativeY, int* x, int* y) {
+    switch(surface->rotation) {
+        case RASTER_ROTATE_90:
+            *x = nativeY;
+            *y = (surface->nativeWidth - 1) - nativeX;
+            break;
+        case RASTER_ROTATE_180:
+            *x = (surface->nativeWidth - 1) - nativeX;
+            *y = (surface->nativeHeight - 1) - nativeY;
+            break;
+        case RASTER_ROTATE_270:
+            *x = (surface->nativeHeight - 1) - nativeY;
+            *y = nativeX;
+            break;
+        default:
+            *x = nativeX;
+            *y = nativeY;
+            break;
+    }
+}
+
+// Native rectangle covered by the (non-empty, on surface) screen rectangle [x1, x2) x [y1, y2)
+static void to_native_rect(const RasterSurface* surface, int x1, int y1, int x2, int y2, int* nativeX, int* nativeY, int* nativeWidth, int* nativeHeight) {
+    int cornerX1, cornerY1, cornerX2, cornerY2;
+    to_native(surface, x1, y1, &cornerX1, &cornerY1);
+    to_native(surface, (x2 - 1), (y2 - 1), &cornerX2, &cornerY2);
+
+    *nativeX = (cornerX1 < cornerX2) ? cornerX1 : cornerX2;
+    *nativeY = (cornerY1 < cornerY2) ? cornerY1 : cornerY2;
+    *nativeWidth = ((cornerX1 < cornerX2) ? (cornerX2 - cornerX1) : (cornerX1 - cornerX2)) + 1;
+    *nativeHeight = ((cornerY1 < cornerY2) ? (cornerY2 - cornerY1) : (cornerY1 - cornerY2)) + 1;
+}
+
+void raster_init(RasterSurface* surface, uint8_t* pixels, uint16_t nativeWidth, uint16_t nativeHeight, uint16_t rotation, RasterPalette* palette) {
+    // Rows start on a byte boundary
+    int32_t stride = ((nativeWidth + 1) & ~1);
+
+    surface->pixels = pixels;
+    surface->palette = palette;
+    surface->nativeWidth = nativeWidth;
+    surface->nativeHeight = nativeHeight;
+    surface->stride = stride;
+    surface->imageCount = 0;
+    surface->pixelWrites = 0;
+
+    switch(rotation) {
+        case RASTER_ROTATE_90:
+            // Native X = (width - 1) - screen Y, native Y = screen X
+            surface->width = nativeHeight;
+            surface->height = nativeWidth;
+            surface->originOffset = (nativeWidth - 1);
+            surface->xStep = stride;
+            surface->yStep = -1;
+            break;
+        case RASTER_ROTATE_180:
+            surface->width = nativeWidth;
+            surface->height = nativeHeight;
+            surface->originOffset = ((nativeHeight - 1) * stride) + (nativeWidth - 1);
+            surface->xStep = -1;
+            surface->yStep = -stride;
+            break;
+        case RASTER_ROTATE_270:
+            // Native X = screen Y, native Y = (height - 1) - screen X
+            surface->width = nativeHeight;
+            surface->height = nativeWidth;
+            surface->originOffset = ((nativeHeight - 1) * stride);
+            surface->xStep = -stride;
+            surface->yStep = 1;
+            break;
+        case RASTER_ROTATE_0:
+        default:
+            rotation = RASTER_ROTATE_0;
+            surface->width = nativeWidth;
+            surface->height = nativeHeight;
+            surface->originOffset = 0;
+            surface->xStep = 1;
+            surface->yStep = stride;
+            break;
+    }
+
+    surface->rotation = rotation;
+}
+
+uint8_t raster_palette_index(RasterPalette* palette, uint16_t color) {
+    for(uint8_t i = 0; i < palette->count; ++i) {
+        if(palette->colors[i] == color) {
+            return i;
+        }
+    }
+
+    // The last index is reserved for image pixels
+    if(palette->count < RASTER_IMAGE_INDEX) {
+        palette->colors[palette->count] = color;
+        palette->panelColors[palette->count] = to_panel_color(color);
+        return palette->count++;
+    }
+
+    // Full, so settle for the nearest colour (5 bit red and blue are doubled to weigh like 6 bit green)
+    uint8_t nearest = 0;
+    uint32_t nearestDistance = UINT32_MAX;
+    for(uint8_t i = 0; i < palette->count; ++i) {
+        int red = (((color >> 11) & 0x1F) - ((palette->colors[i] >> 11) & 0x1F)) * 2;
+        int green = ((color >> 5) & 0x3F) - ((palette->colors[i] >> 5) & 0x3F);
+        int blue = ((color & 0x1F) - (palette->colors[i] & 0x1F)) * 2;
+        uint32_t distance = (red * red) + (green * green) + (blue * blue);
+
+        if(distance < nearestDistance) {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
+}
+
+static void fill_rect_index(RasterSurface* surface, int x1, int y1, int x2, int y2, uint8_t index) {
+    x1 = clamp_min(x1, 0);
+    y1 = clamp_min(y1, 0);
+    x2 = clamp_max(x2, surface->width);
+    y2 = clamp_max(y2, surface->height);
+    if((x1 >= x2) || (y1 >= y2)) {
+        return;
+    }
+
+    // Rotate the rectangle once, then fill it as contiguous native rows
+    int nativeX, nativeY, spanLength, rows;
+    to_native_rect(surface, x1, y1, x2, y2, &nativeX, &nativeY, &spanLength, &rows);
+
+    surface->pixelWrites += (spanLength * rows);
+
+    int32_t row = (nativeY * surface->stride) + nativeX;
+    for(; rows > 0; --rows, row += surface->stride) {
+        fill_span(surface->pixels, row, spanLength, index);
+    }
+}
+
+void raster_clear(RasterSurface* surface, uint16_t color) {
+    uint8_t index = raster_palette_index(surface->palette, color);
+
+    memset(surface->pixels, (index * 0x11), ((surface->stride / 2) * surface->nativeHeight));
+    surface->imageCount = 0;
+    surface->pixelWrites += (surface->nativeWidth * surface->nativeHeight);
+}
+
+void raster_fill_rect(RasterSurface* surface, int x1, int y1, int x2, int y2, uint16_t color) {
+    fill_rect_index(surface, x1, y1, x2, y2, raster_palette_index(surface->palette, color));
+}
+
+void raster_fill_hspan(RasterSurface* surface, int x, int y, int length, uint16_t color) {
+    raster_fill_rect(surface, x, y, (x + length), (y + 1), color);
+}
+
+void raster_native_size(const RasterSurface* surface, uint16_t width, uint16_t height, uint16_t* nativeWidth, uint16_t* nativeHeight) {
+    bool swapped = ((surface->rotation == RASTER_ROTATE_90) || (surface->rotation == RASTER_ROTATE_270));
+
+    *nativeWidth = swapped ? height : width;
+    *nativeHeight = swapped ? width : height;
+}
+
+uint32_t raster_block_bytes(const RasterSurface* surface, uint16_t width, uint16_t height) {
+    uint16_t nativeWidth, nativeHeight;
+    raster_native_size(surface, width, height, &nativeWidth, &nativeHeight);
+
+    return (((nativeWidth + 1) / 2) * nativeHeight);
+}
+
+bool raster_blit(RasterSurface* surface, int xPos, int yPos, const uint8_t* block, uint16_t width, uint16_t height) {
+    if((xPos < 0) || (yPos < 0) || ((xPos + width) > surface->width) || ((yPos + height) > surface->height) || !width || !height) {
+        return false;
+    }
+
+    int nativeX, nativeY, rowLength, rows;
+    to_native_rect(surface, xPos, yPos, (xPos + width), (yPos + height), &nativeX, &nativeY, &rowLength, &rows);
+
+    surface->pixelWrites += (rowLength * rows);
+
+    int blockRowBytes = ((rowLength + 1) / 2);
+    int32_t row = (nativeY * surface->stride) + nativeX;
+    for(; rows > 0; --rows, row += surface->stride, block += blockRowBytes) {
+        if(!(row & 1)) {
+            memcpy(&surface->pixels[row >> 1], block, (rowLength >> 1));
+            if(rowLength & 1) {
+                set_pixel(surface->pixels, (row + rowLength - 1), get_pixel(block, (rowLength - 1)));
+            }
+            continue;
+        }
+
+        // Starting on an odd pixel, so each destination byte takes the halves of two source bytes
+        set_pixel(surface->pixels, row, get_pixel(block, 0));
+
+        int i = 1;
+        uint8_t* dest = &surface->pixels[(row + 1) >> 1];
+        for(; (i + 1) < rowLength; i += 2) {
+            *dest++ = (uint8_t) ((block[i >> 1] << 4) | (block[(i + 1) >> 1] >> 4));
+        }
+
+        if(i < rowLength) {
+            set_pixel(surface->pixels, (row + i), get_pixel(block, i));
+        }
+    }
+
+    return true;
+}
+
+void raster_draw_glyph(RasterSurface* surface, int xPos, int yPos, const uint8_t* glyph, uint8_t width, uint8_t height, uint16_t foregroundColor, uint16_t backgroundColor) {
+    int firstColumn = clamp_min(-xPos, 0);
+    int lastColumn = clamp_max(width, (surface->width - xPos));
+    int firstRow = clamp_min(-yPos, 0);
+    int lastRow = clamp_max(height, (surface->height - yPos));
+    if((firstColumn >= lastColumn) || (firstRow >= lastRow)) {
+        return;
+    }
+
+    uint8_t foreground = raster_palette_index(surface->palette, foregroundColor);
+    uint8_t background = raster_palette_index(surface->palette, backgroundColor);
+    int bytesPerRow = ((width + 7) / 8);
+    int32_t xStep = surface->xStep;
+    surface->pixelWrites += ((lastColumn - firstColumn) * (lastRow - firstRow));
+
+    const uint8_t* glyphRow = &glyph[firstRow * bytesPerRow];
+    int32_t rowStart = surface->originOffset + ((xPos + firstColumn) * xStep) + ((yPos + firstRow) * surface->yStep);
+
+    for(int row = firstRow; row < lastRow; ++row, glyphRow += bytesPerRow, rowStart += surface->yStep) {
+        int32_t pixel = rowStart;
+        for(int column = firstColumn; column < lastColumn; ++column, pixel += xStep) {
+            bool set = (glyphRow[column / 8] & (0x80 >> (column % 8)));
+            set_pixel(surface->pixels, pixel, (set ? foreground : background));
+        }
+    }
+}
+
+bool raster_draw_image(RasterSurface* surface, const uint8_t* image, int xPos, int yPos, uint16_t imageWidth, uint16_t imageHeight) {
+    if(surface->imageCount >= RASTER_MAX_IMAGES) {
+        return false;
+    }
+
+    RasterImage* placed = &surface->images[surface->imageCount++];
+    placed->image = image;
+    placed->xPos = xPos;
+    placed->yPos = yPos;
+    placed->width = imageWidth;
+    placed->height = imageHeight;
+
+    // The pixels themselves are only looked up when a row is expanded
+    fill_rect_index(surface, xPos, yPos, (xPos + imageWidth), (yPos + imageHeight), RASTER_IMAGE_INDEX);
+    return true;
+}
+
+bool raster_image_native_rect(const RasterSurface* surface, const RasterImage* image, int* x1, int* y1, int* x2, int* y2) {
+    int left = clamp_min(image->xPos, 0);
+    int top = clamp_min(image->yPos, 0);
+    int right = clamp_max((image->xPos + image->width), surface->width);
+    int bottom = clamp_max((image->yPos + image->height), surface->height);
+    if((left >= right) || (top >= bottom)) {
+        return false;
+    }
+
+    int width, height;
+    to_native_rect(surface, left, top, right, bottom, x1, y1, &width, &height);
+    *x2 = (*x1 + width);
+    *y2 = (*y1 + height);
+    return true;
+}
+
+void raster_expand_row(const RasterSurface* surface, int nativeY, int nativeX1, int nativeX2, uint8_t* dest) {
+    const uint16_t* panelColors = surface->palette->panelColors;
+    const uint8_t* row = &surface->pixels[(nativeY * surface->stride) >> 1];
+    uint16_t* out = (uint16_t*) dest;
+    bool imagePixels = false;
+
+    for(int x = nativeX1; x < nativeX2; ++x) {
+        uint8_t index = get_pixel(row, x);
+        imagePixels |= (index == RASTER_IMAGE_INDEX);
+        out[x - nativeX1] = panelColors[index];
+    }
+
+    if(!imagePixels) {
+        return;
+    }
+
+    // Later images were drawn over earlier ones, so they are applied last
+    for(int i = 0; i < surface->imageCount; ++i) {
+        const RasterImage* image = &surface->images[i];
+
+        int x1, y1, x2, y2;
+        if(!raster_image_native_rect(surface, image, &x1, &y1, &x2, &y2) || (nativeY < y1) || (nativeY >= y2)) {
+            continue;
+        }
+
+        x1 = clamp_min(x1, nativeX1);
+        x2 = clamp_max(x2, nativeX2);
+        if(x1 >= x2) {
+            continue;
+        }
+
+        // Walking along a native row is a fixed step in screen space
+        int screenX, screenY, nextX, nextY;
+        to_screen(surface, x1, nativeY, &screenX, &screenY);
+        to_screen(surface, (x1 + 1), nativeY, &nextX, &nextY);
+        int32_t sourceStep = ((nextY - screenY) * image->width) + (nextX - screenX);
+        int32_t source = ((screenY - image->yPos) * image->width) + (screenX - image->xPos);
+
+        for(int x = x1; x < x2; ++x, source += sourceStep) {
+            if(get_pixel(row, x) == RASTER_IMAGE_INDEX) {
+                // Low byte first in the image, high byte first on the panel
+                const uint8_t* pixel = &image->image[source * 2];
+                out[x - nativeX1] = (uint16_t) ((pixel[0] << 8) | pixel[1]);
+            }
+        }
+    }
+}
+
+// Paint_DrawPoint() stamps a (2 * pen - 1) square whose top left is (x - pen, y - pen), clipped to the
+// screen, and skips points beyond the screen. The union of those squares over a horizontal or vertical
+// run of points is a single rectangle
+static void pen_hrun(RasterSurface* surface, int x1, int x2, int y, int pen, uint16_t color) {
+    if((y < 0) || (y > surface->height)) {
+        return;
+    }
+
+    x1 = clamp_min(x1, 0);
+    x2 = clamp_max(x2, surface->width);
+    if(x1 > x2) {
+        return;
+    }
+
+    raster_fill_rect(surface, (x1 - pen), (y - pen), (x2 + pen - 1), (y + pen - 1), color);
+}
+
+static void pen_vrun(RasterSurface* surface, int x, int y1, int y2, int pen, uint16_t color) {
+    if((x < 0) || (x > surface->width)) {
+        return;
+    }
+
+    y1 = clamp_min(y1, 0);
+    y2 = clamp_max(y2, surface->height);
+    if(y1 > y2) {
+        return;
+    }
+
+    raster_fill_rect(surface, (x - pen), (y1 - pen), (x + pen - 1), (y2 + pen - 1), color);
+}
+
+static inline void pen_point(RasterSurface* surface, int x, int y, int pen, uint16_t color) {
+    pen_hrun(surface, x, x, y, pen, color);
+}
+
+void raster_draw_line(RasterSurface* surface, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t penSize, uint16_t color) {
+    if((x1 > surface->width) || (y1 > surface->height) || (x2 > surface->width) || (y2 > surface->height)) {
+        return;
+    }
+
+    if(y1 == y2) {
+        pen_hrun(surface, ((x1 < x2) ? x1 : x2), ((x1 < x2) ? x2 : x1), y1, penSize, color);
+        return;
+    }
+
+    if(x1 == x2) {
+        pen_vrun(surface, x1, ((y1 < y2) ? y1 : y2), ((y1 < y2) ? y2 : y1), penSize, color);
+        return;
+    }
+
+    // Same Bresenham walk as Paint_DrawLine()
+    int x = x1;
+    int y = y1;
+    int dx = (x2 >= x1) ? (x2 - x1) : (x1 - x2);
+    int dy = (y2 <= y1) ? (y2 - y1) : (y1 - y2);
+    int xStep = (x1 < x2) ? 1 : -1;
+    int yStep = (y1 < y2) ? 1 : -1;
+    int error = dx + dy;
+
+    for(;;) {
+        pen_point(surface, x, y, penSize, color);
+
+        if((2 * error) >= dy) {
+            if(x == x2) {
+                break;
+            }
+            error += dy;
+            x += xStep;
+        }
+        if((2 * error) <= dx) {
+            if(y == y2) {
+                break;
+            }
+            error += dx;
+            y += yStep;
+        }
+    }
+}
+
+void raster_draw_rectangle(RasterSurface* surface, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t penSize, bool filled, uint16_t color) {
+    if((x1 > surface->width) || (y1 > surface->height) || (x2 > surface->width) || (y2 > surface->height)) {
+        return;
+    }
+
+    if(filled) {
+        // One line per row in [y1, y2)
+        if(y1 >= y2) {
+            return;
+        }
+
+        int left = (x1 < x2) ? x1 : x2;
+        int right = (x1 < x2) ? x2 : x1;
+        raster_fill_rect(surface, (left - penSize), (y1 - penSize), (right + penSize - 1), (y2 + penSize - 2), color);
+    } else {
+        raster_draw_line(surface, x1, y1, x2, y1, penSize, color);
+        raster_draw_line(surface, x1, y1, x1, y2, penSize, color);
+        raster_draw_line(surface, x2, y2, x2, y1, penSize, color);
+        raster_draw_line(surface, x2, y2, x1, y2, penSize, color);
+    }
+}
+
+void raster_draw_circle(RasterSurface* surface, uint16_t centerX, uint16_t centerY, uint16_t radius, uint8_t penSize, bool filled, uint16_t color) {
+    if((centerX > surface->width) || (centerY >= surface->height)) {
+        return;
+    }
+
+    // Same midpoint walk as Paint_DrawCircle(), one octant at a time
+    int16_t x = 0;
+    int16_t y = radius;
+    int16_t error = 3 - (radius << 1);
+    int cx = centerX;
+    int cy = centerY;
+
+    while(x <= y) {
+        if(filled) {
+            // Each octant's points for this step form a single run (filled circles use a 1 pixel pen)
+            pen_vrun(surface, (cx + x), (cy + x), (cy + y), 1, color);
+            pen_vrun(surface, (cx - x), (cy + x), (cy + y), 1, color);
+            pen_hrun(surface, (cx - y), (cx - x), (cy + x), 1, color);
+            pen_hrun(surface, (cx - y), (cx - x), (cy - x), 1, color);
+            pen_vrun(surface, (cx - x), (cy - y), (cy - x), 1, color);
+            pen_vrun(surface, (cx + x), (cy - y), (cy - x), 1, color);
+            pen_hrun(surface, (cx + x), (cx + y), (cy - x), 1, color);
+            pen_hrun(surface, (cx + x), (cx + y), (cy + x), 1, color);
+        } else {
+            pen_point(surface, (cx + x), (cy + y), penSize, color);
+            pen_point(surface, (cx - x), (cy + y), penSize, color);
+            pen_point(surface, (cx - y), (cy + x), penSize, color);
+            pen_point(surface, (cx - y), (cy - x), penSize, color);
+            pen_point(surface, (cx - x), (cy - y), penSize, color);
+            pen_point(surface, (cx + x), (cy - y), penSize, color);
+            pen_point(surface, (cx + y), (cy - x), penSize, color);
+            pen_point(surface, (cx + y), (cy + x), penSize, color);
+        }
+
+        if(error < 0) {
+            error += (4 * x) + 6;
+        } else {
+            error += 10 + (4 * (x - y));
+            --y;
+        }
+        ++x;
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef _WALLET_RASTER_H_
+#define _WALLET_RASTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define RASTER_ROTATE_0         (0)
+#define RASTER_ROTATE_90        (90)
+#define RASTER_ROTATE_180       (180)
+#define RASTER_ROTATE_270       (270)
+
+#define RASTER_PALETTE_SIZE     (16)                            // 4 bits per pixel
+#define RASTER_IMAGE_INDEX      (RASTER_PALETTE_SIZE - 1)       // Marks pixels that show a RasterImage
+#define RASTER_MAX_IMAGES       (8)                             // Images placed between clears
+
+// Upper bound on raster_block_bytes() for a width x height block, in any rotation
+#define RASTER_BLOCK_MAX_BYTES(width, height)   ((((width) + 1) * ((height) + 1)) / 2)
+
+
+// Colours in use, in the order they were first drawn. Entries never change once added, so indices
+// held in any framebuffer stay valid for as long as the palette does
+typedef struct {
+    uint16_t colors[RASTER_PALETTE_SIZE];               // RGB565
+    uint16_t panelColors[RASTER_PALETTE_SIZE];          // Same colours, high byte first as the panel expects
+    uint8_t count;
+} RasterPalette;
+
+// Full colour images don't fit in the palette. Their pixels are marked with RASTER_IMAGE_INDEX and
+// the image itself is read (from flash) wherever the mark survives when the row is expanded
+typedef struct {
+    const uint8_t* image;               // RGB565, low byte first
+    int16_t xPos;                       // Screen position of the image's top left corner
+    int16_t yPos;
+    uint16_t width;
+    uint16_t height;
+} RasterImage;
+
+// A 4 bits per pixel, palette indexed framebuffer in the panel's native orientation, with the even
+// pixel of each pair in the high nibble (as GUI_Paint's scale 16 mode). Drawing functions take screen
+// (rotated) coordinates, the rotation is resolved once per call into a start pixel and two pixel
+// steps rather than once per pixel
+typedef struct {
+    uint8_t* pixels;
+    RasterPalette* palette;
+    uint16_t nativeWidth;               // Native (panel) dimensions, in pixels
+    uint16_t nativeHeight;
+    uint16_t stride;                    // Pixels between the starts of consecutive native rows, always even
+    uint16_t width;                     // Screen dimensions, in pixels
+    uint16_t height;
+    uint16_t rotation;
+    int32_t originOffset;               // Pixel index of screen (0, 0)
+    int32_t xStep;                      // Pixel index change for a step of +1 in screen X
+    int32_t yStep;                      // Pixel index change for a step of +1 in screen Y
+    RasterImage images[RASTER_MAX_IMAGES];
+    uint8_t imageCount;
+    uint32_t pixelWrites;               // Pixels written since raster_init(), for profiling
+} RasterSurface;
+
+
+/**
+ * Set up a surface over the supplied pixels
+ *
+ * surface              out     The surface to be configured
+ * pixels               in      Framebuffer, at least ((nativeWidth + 1) / 2) * nativeHeight bytes
+ * nativeWidth          in      Width of the framebuffer, in pixels
+ * nativeHeight         in      Height of the framebuffer, in pixels
+ * rotation             in      One of the RASTER_ROTATE_* values
+ * palette              in      Palette the pixels index into, may be shared between surfaces
+ */
+void raster_init(RasterSurface* surface, uint8_t* pixels, uint16_t nativeWidth, uint16_t nativeHeight, uint16_t rotation, RasterPalette* palette);
+
+/**
+ * Returns the palette index of an RGB565 colour, adding the colour if it is new. Once the palette
+ * is full, new colours map to the nearest colour already in it
+ */
+uint8_t raster_palette_index(RasterPalette* palette, uint16_t color);
+
+// Primitives. Coordinates are in screen space and clipped to the surface, rectangles are half-open
+void raster_clear(RasterSurface* surface, uint16_t color);
+void raster_fill_rect(RasterSurface* surface, int x1, int y1, int x2, int y2, uint16_t color);
+void raster_fill_hspan(RasterSurface* surface, int x, int y, int length, uint16_t color);
+
+// Native dimensions of a width x height screen rectangle, i.e. the layout raster_blit() expects
+void raster_native_size(const RasterSurface* surface, uint16_t width, uint16_t height, uint16_t* nativeWidth, uint16_t* nativeHeight);
+
+// Bytes taken by a width x height screen rectangle held as a block (native rows, each starting on a byte)
+uint32_t raster_block_bytes(const RasterSurface* surface, uint16_t width, uint16_t height);
+
+/**
+ * Copy a block of pixels that is already in the surface's native orientation and pixel format, one
+ * native row at a time. Blocks are typically rendered once, by drawing into a RasterSurface of
+ * raster_native_size() over the block with the same rotation and palette, and blitted many times
+ *
+ * surface              in/out  The surface to be drawn to
+ * xPos, yPos           in      Screen position of the block's top left corner
+ * block                in      Native pixels, row-major, raster_block_bytes() long
+ * width, height        in      Screen dimensions of the block, in pixels
+ *
+ * Returns false (and draws nothing) if the block does not lie entirely within the surface
+ */
+bool raster_blit(RasterSurface* surface, int xPos, int yPos, const uint8_t* block, uint16_t width, uint16_t height);
+
+/**
+ * Blit a 1-bpp glyph. Glyph rows are (width + 7) / 8 bytes, most significant bit leftmost
+ *
+ * surface              in/out  The surface to be drawn to
+ * xPos, yPos           in      Screen position of the glyph's top left corner
+ * glyph                in      Glyph bits
+ * width, height        in      Glyph dimensions, in pixels
+ * foregroundColor      in      Colour of set bits
+ * backgroundColor      in      Colour of clear bits
+ */
+void raster_draw_glyph(RasterSurface* surface, int xPos, int yPos, const uint8_t* glyph, uint8_t width, uint8_t height, uint16_t foregroundColor, uint16_t backgroundColor);
+
+/**
+ * Place an RGB565 image stored low byte first (the format of the images in wallet_app/screens/images).
+ * The image is referenced rather than copied, so it must stay valid until it has been sent to the panel
+ *
+ * Returns false (and draws nothing) once RASTER_MAX_IMAGES images have been placed since the last clear
+ */
+bool raster_draw_image(RasterSurface* surface, const uint8_t* image, int xPos, int yPos, uint16_t imageWidth, uint16_t imageHeight);
+
+// Pen drawn shapes. These reproduce GUI_Paint's output pixel for pixel (including its square pen
+// being offset up and left of the point), so screens look the same whichever renderer draws them
+void raster_draw_line(RasterSurface* surface, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t penSize, uint16_t color);
+void raster_draw_rectangle(RasterSurface* surface, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t penSize, bool filled, uint16_t color);
+void raster_draw_circle(RasterSurface* surface, uint16_t centerX, uint16_t centerY, uint16_t radius, uint8_t penSize, bool filled, uint16_t color);
+
+/**
+ * Native rectangle [x1, x2) x [y1, y2) covered by the on-surface part of a placed image
+ *
+ * Returns false if no part of the image is on the surface
+ */
+bool raster_image_native_rect(const RasterSurface* surface, const RasterImage* image, int* x1, int* y1, int* x2, int* y2);
+
+/**
+ * Expand part of a native row to RGB565, high byte first, ready to be sent to the panel. Pixels marked
+ * as image pixels are read from the surface's placed images
+ *
+ * surface              in      The surface to be read
+ * nativeY              in      Native row
+ * nativeX1, nativeX2   in      Native columns [nativeX1, nativeX2) to expand
+ * dest                 out     Space for (nativeX2 - nativeX1) pixels, 2 byte aligned
+ */
+void raster_expand_row(const RasterSurface* surface, int nativeY, int nativeX1, int nativeX2, uint8_t* dest);
+
+
+#endif      // _WALLET_RASTER_H_
@@ -1,5 +1,7 @@
 #include "gfx_utils.h"
+#include "text_cache.h"
 #include "wallet_fonts.h"
+#include "wallet_raster.h"
 
 #include "waveshare_lcd/lib/Config/DEV_Config.h"
 #include "waveshare_lcd/lib/LCD/LCD_1in44.h"
@@ -7,8 +9,31 @@
 
 #include <string.h>
 
-static UWORD imageBuffer[LCD_1IN44_HEIGHT * LCD_1IN44_WIDTH * 2];
+// Double buffered: screens draw into imageBuffer while the previous frame is streamed to the panel
+// from panelBuffer by DMA. panelBuffer is only written once the transfer reading it has completed.
+// Both hold 4 bit palette indices, expanded to RGB565 a row at a time as the transfer reaches them
+static uint8_t imageBuffer[(LCD_1IN44_HEIGHT * LCD_1IN44_WIDTH) / 2];
+static uint8_t panelBuffer[(LCD_1IN44_HEIGHT * LCD_1IN44_WIDTH) / 2];   // What the panel is currently showing
+static RasterPalette displayPalette;
+static RasterSurface drawSurface;                               // imageBuffer, in screen orientation
+static RasterSurface panelSurface;                              // panelBuffer, read by fill_flush_row()
 static WalletDisplayInfo waveshareDisplay;
+static WalletDisplayStats displayStats;
+
+// Damaged areas, in screen (drawing) coordinates. Bounds are half-open: [x1, x2) x [y1, y2)
+typedef struct {
+    int16_t x1, y1;
+    int16_t x2, y2;
+} DamageRect;
+
+static const DamageRect NO_DAMAGE = { INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN };
+static DamageRect frameDamage;
+static DamageRect previousFrameDamage;
+static DamageRect flushingRect;                                 // Buffer rectangle of the transfer in flight
+
+// Revision of the screen currently shown on the panel
+static uint32_t paintedRevision;
+static bool displayPainted = false;
 
 // Font maps
 static sFONT WAVESHARE_FONT_MED = {
@@ -67,6 +92,113 @@ DOT_PIXEL to_waveshare_line_width(uint8_t lineWidth) {
 void start_paint();
 void end_paint();
 
+
+static bool damage_is_empty(const DamageRect* rect) {
+    return (rect->x1 >= rect->x2) || (rect->y1 >= rect->y2);
+}
+
+static void damage_union(DamageRect* dest, const DamageRect* rect) {
+    if(damage_is_empty(rect)) {
+        return;
+    }
+
+    dest->x1 = MIN(dest->x1, rect->x1);
+    dest->y1 = MIN(dest->y1, rect->y1);
+    dest->x2 = MAX(dest->x2, rect->x2);
+    dest->y2 = MAX(dest->y2, rect->y2);
+}
+
+static void add_damage(int x1, int y1, int x2, int y2) {
+    DamageRect rect = {
+        .x1 = MAX(x1, 0),
+        .y1 = MAX(y1, 0),
+        .x2 = MIN(x2, (int) waveshareDisplay.displayWidth),
+        .y2 = MIN(y2, (int) waveshareDisplay.displayHeight)
+    };
+
+    damage_union(&frameDamage, &rect);
+}
+
+// Follows the same wrapping rules as Paint_DrawString_EN()
+static void draw_string(uint16_t xPos, uint16_t yPos, const char* string, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor, bool useCache) {
+    if(!to_waveshare_font(font)) {
+        return;
+    }
+
+    text_draw_string(&drawSurface, xPos, yPos, string, font, foregroundColor, backgroundColor, useCache, add_damage);
+}
+
+// Convert a rectangle in screen coordinates to image buffer coordinates. Must match the rotation
+// set up in start_paint() (ROTATE_270: buffer X = screen Y, buffer Y = (height - 1) - screen X)
+static DamageRect to_buffer_rect(const DamageRect* rect) {
+    DamageRect bufferRect = {
+        .x1 = rect->y1,
+        .y1 = (LCD_1IN44.HEIGHT - rect->x2),
+        .x2 = rect->y2,
+        .y2 = (LCD_1IN44.HEIGHT - rect->x1)
+    };
+
+    return bufferRect;
+}
+
+// Widen a buffer rectangle to whole bytes (pixel pairs), so rows can be compared and copied bytewise
+static void align_to_bytes(DamageRect* rect) {
+    rect->x1 &= ~1;
+    rect->x2 = ((rect->x2 + 1) & ~1);
+}
+
+// Shrink the supplied (byte aligned) buffer rectangle down to the pixel pairs that differ from what
+// the panel shows
+static void trim_to_changes(DamageRect* rect) {
+    DamageRect changed = NO_DAMAGE;
+    int rowBytes = (LCD_1IN44.WIDTH / 2);
+
+    for(int y = rect->y1; y < rect->y2; ++y) {
+        const uint8_t* imageRow = &imageBuffer[y * rowBytes];
+        const uint8_t* panelRow = &panelBuffer[y * rowBytes];
+
+        if(memcmp(&imageRow[rect->x1 / 2], &panelRow[rect->x1 / 2], ((rect->x2 - rect->x1) / 2)) == 0) {
+            continue;
+        }
+
+        for(int x = (rect->x1 / 2); x < (rect->x2 / 2); ++x) {
+            if(imageRow[x] != panelRow[x]) {
+                changed.x1 = MIN(changed.x1, (x * 2));
+                changed.x2 = MAX(changed.x2, ((x + 1) * 2));
+            }
+        }
+        changed.y1 = MIN(changed.y1, y);
+        changed.y2 = (y + 1);
+    }
+
+    *rect = changed;
+}
+
+// Image pixels only hold a marker, so a change of image (or position) has to be flushed explicitly
+static void add_image_changes(DamageRect* rect) {
+    if((drawSurface.imageCount == panelSurface.imageCount) &&
+        (memcmp(drawSurface.images, panelSurface.images, (drawSurface.imageCount * sizeof(RasterImage))) == 0)) {
+        return;
+    }
+
+    const RasterSurface* surfaces[] = { &drawSurface, &panelSurface };
+    for(int s = 0; s < 2; ++s) {
+        for(int i = 0; i < surfaces[s]->imageCount; ++i) {
+            DamageRect imageRect;
+            int x1, y1, x2, y2;
+            if(raster_image_native_rect(surfaces[s], &surfaces[s]->images[i], &x1, &y1, &x2, &y2)) {
+                imageRect = (DamageRect) { .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2 };
+                damage_union(rect, &imageRect);
+            }
+        }
+    }
+}
+
+// Called from the DMA interrupt as the transfer reaches each row of flushingRect
+static void fill_flush_row(uint32_t row, uint8_t* pixels) {
+    raster_expand_row(&panelSurface, (flushingRect.y1 + row), flushingRect.x1, flushingRect.x2, pixels);
+}
+
 int init_display() {
     if(DEV_Module_Init()!=0){
         return -1;
@@ -79,8 +211,19 @@ int init_display() {
         return -1;
     }
 
-    waveshareDisplay.displayWidth = LCD_1IN44.WIDTH;
-    waveshareDisplay.displayHeight = LCD_1IN44.HEIGHT;
+    // Index 0 is black, which is what a zeroed buffer holds
+    raster_palette_index(&displayPalette, PW_BLACK);
+
+    // Match the ROTATE_270 orientation the screens were laid out with under GUI_Paint
+    raster_init(&drawSurface, imageBuffer, LCD_1IN44.WIDTH, LCD_1IN44.HEIGHT, RASTER_ROTATE_270, &displayPalette);
+    raster_init(&panelSurface, panelBuffer, LCD_1IN44.WIDTH, LCD_1IN44.HEIGHT, RASTER_ROTATE_270, &displayPalette);
+
+    waveshareDisplay.displayWidth = drawSurface.width;
+    waveshareDisplay.displayHeight = drawSurface.height;
+
+    // The panel was just cleared to black, which is what a zeroed panelBuffer holds
+    frameDamage = NO_DAMAGE;
+    previousFrameDamage = NO_DAMAGE;
 
     return 0;
 }
@@ -89,69 +232,254 @@ const WalletDisplayInfo* get_display_info() {
     return &waveshareDisplay;
 }
 
+const WalletDisplayStats* get_display_stats() {
+    return &displayStats;
+}
+
 void update_display(WalletScreen* screen) {
+    // Nothing to do unless the screen has changed since it was last painted
+    if(!screen || (displayPainted && (screen->revision == paintedRevision))) {
+        return;
+    }
+
+    uint32_t pixelWrites = drawSurface.pixelWrites;
     start_paint();
 
-    if(screen && screen->drawFunction) {
+    if(screen->drawFunction) {
         screen->drawFunction(screen);
     }
 
+    displayStats.lastPixelWrites = (drawSurface.pixelWrites - pixelWrites);
     end_paint();
+
+    paintedRevision = screen->revision;
+    displayPainted = true;
 }
 
 void start_paint() {
-    Paint_NewImage((UBYTE*)imageBuffer, LCD_1IN44.WIDTH, LCD_1IN44.HEIGHT, 0, BLACK);
-    Paint_SetScale(65);
-    Paint_SetRotate(ROTATE_270);
-    Paint_Clear(BLACK);
+    raster_clear(&drawSurface, PW_BLACK);
 }
 
+// Only pixels inside something drawn this frame or last frame (which start_paint() has since cleared)
+// can have changed, so only that area is compared against the panel and flushed
 void end_paint() {
-    LCD_1IN44_Display(imageBuffer);             
+    DamageRect flushRect = frameDamage;
+    damage_union(&flushRect, &previousFrameDamage);
+    previousFrameDamage = frameDamage;
+    frameDamage = NO_DAMAGE;
+
+    displayStats.lastFlushBytes = 0;
+    ++displayStats.framesPainted;
+
+    if(!damage_is_empty(&flushRect)) {
+        flushRect = to_buffer_rect(&flushRect);
+        align_to_bytes(&flushRect);
+        trim_to_changes(&flushRect);
+    }
+
+    add_image_changes(&flushRect);
+    if(damage_is_empty(&flushRect)) {
+        return;
+    }
+    align_to_bytes(&flushRect);
+
+    // Fence: the previous frame may still be streaming out of panelBuffer
+    LCD_1IN44_WaitIdle();
+
+    int rowBytes = ((flushRect.x2 - flushRect.x1) / 2);
+    for(int y = flushRect.y1; y < flushRect.y2; ++y) {
+        int offset = ((y * LCD_1IN44.WIDTH) + flushRect.x1) / 2;
+        memcpy(&panelBuffer[offset], &imageBuffer[offset], rowBytes);
+    }
+
+    memcpy(panelSurface.images, drawSurface.images, sizeof(panelSurface.images));
+    panelSurface.imageCount = drawSurface.imageCount;
+
+    flushingRect = flushRect;
+    LCD_1IN44_DisplayWindowsFill(flushRect.x1, flushRect.y1, flushRect.x2, flushRect.y2, fill_flush_row);
+
+    displayStats.lastFlushBytes = ((flushRect.x2 - flushRect.x1) * sizeof(UWORD) * (flushRect.y2 - flushRect.y1));
+    displayStats.totalFlushBytes += displayStats.lastFlushBytes;
+}
+
+// Frame time benchmark: the same scenes drawn through GUI_Paint (in its 4 bit mode, with the display
+// palette's indices) and through the raster layer
+#define BENCHMARK_QR_SIZE       (37)
+#define BENCHMARK_QR_MODULE     (3)
+
+static const char* const BENCHMARK_TEXT[] = {
+    "m/44'/0'/0'/0/12",
+    "bc1qar0srrr7xfkvy5",
+    "l643lydnw9re59gtzz",
+    "wf5mdq",
+    "Balance unknown",
+    "Press A for QR",
+    "Press B to go back",
+    "0123456789abcdefgh"
+};
+
+static void benchmark_gui_paint(int scene) {
+    UWORD black = raster_palette_index(&displayPalette, PW_BLACK);
+    UWORD white = raster_palette_index(&displayPalette, PW_WHITE);
+    UWORD green = raster_palette_index(&displayPalette, PW_GREEN);
+
+    Paint_NewImage(imageBuffer, LCD_1IN44.WIDTH, LCD_1IN44.HEIGHT, 0, black);
+    Paint_SetScale(16);
+    Paint_SetRotate(ROTATE_270);
+
+    switch(scene) {
+        case 0:
+        case 1:
+            Paint_Clear(black);
+            for(int i = 0; i < (sizeof(BENCHMARK_TEXT) / sizeof(BENCHMARK_TEXT[0])); ++i) {
+                Paint_DrawString_EN(0, (i * PW_FONT_MED.charHeight), BENCHMARK_TEXT[i], &WAVESHARE_FONT_MED, white, black);
+            }
+            Paint_DrawLine(0, 100, 127, 100, green, DOT_PIXEL_1X1, LINE_STYLE_SOLID);
+            break;
+        case 2:
+            Paint_Clear(white);
+            for(int y = 0; y < BENCHMARK_QR_SIZE; ++y) {
+                for(int x = 0; x < BENCHMARK_QR_SIZE; ++x) {
+                    int xPos = 8 + (x * BENCHMARK_QR_MODULE);
+                    int yPos = 8 + (y * BENCHMARK_QR_MODULE);
+                    UWORD color = (((x * y) + x) % 3) ? white : black;
+                    Paint_DrawRectangle(xPos, yPos, (xPos + BENCHMARK_QR_MODULE), (yPos + BENCHMARK_QR_MODULE), color, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+                }
+            }
+            break;
+    }
+}
+
+static void benchmark_raster(int scene) {
+    switch(scene) {
+        case 0:
+            raster_clear(&drawSurface, PW_BLACK);
+            for(int i = 0; i < (sizeof(BENCHMARK_TEXT) / sizeof(BENCHMARK_TEXT[0])); ++i) {
+                const char* c = BENCHMARK_TEXT[i];
+                for(int x = 0; *c; ++c, x += PW_FONT_MED.charWidth) {
+                    raster_draw_glyph(&drawSurface, x, (i * PW_FONT_MED.charHeight), get_glyph_bits(&PW_FONT_MED, *c),
+                        PW_FONT_MED.charWidth, PW_FONT_MED.charHeight, PW_WHITE, PW_BLACK);
+                }
+            }
+            raster_draw_line(&drawSurface, 0, 100, 127, 100, 1, PW_GREEN);
+            break;
+        case 1:
+            raster_clear(&drawSurface, PW_BLACK);
+            for(int i = 0; i < (sizeof(BENCHMARK_TEXT) / sizeof(BENCHMARK_TEXT[0])); ++i) {
+                draw_string(0, (i * PW_FONT_MED.charHeight), BENCHMARK_TEXT[i], &PW_FONT_MED, PW_WHITE, PW_BLACK, true);
+            }
+            raster_draw_line(&drawSurface, 0, 100, 127, 100, 1, PW_GREEN);
+            break;
+        case 2:
+            raster_clear(&drawSurface, PW_WHITE);
+            for(int y = 0; y < BENCHMARK_QR_SIZE; ++y) {
+                for(int x = 0; x < BENCHMARK_QR_SIZE; ++x) {
+                    int xPos = 8 + (x * BENCHMARK_QR_MODULE);
+                    int yPos = 8 + (y * BENCHMARK_QR_MODULE);
+                    WalletPaintColor color = (((x * y) + x) % 3) ? PW_WHITE : PW_BLACK;
+                    raster_draw_rectangle(&drawSurface, xPos, yPos, (xPos + BENCHMARK_QR_MODULE), (yPos + BENCHMARK_QR_MODULE), 1, true, color);
+                }
+            }
+            break;
+    }
+}
+
+// FNV-1a over the frame, to check both renderers produced the same pixels
+static uint32_t hash_image_buffer() {
+    const uint8_t* bytes = (const uint8_t*) imageBuffer;
+    uint32_t hash = 2166136261u;
+
+    for(int i = 0; i < sizeof(imageBuffer); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+void run_display_benchmark(uint32_t iterations) {
+    static const char* const SCENE_NAMES[] = { "text", "cached text", "qr" };
+
+    if(iterations == 0) {
+        return;
+    }
+
+    // Only imageBuffer is drawn to, the next start_paint() clears it again
+    DamageRect savedDamage = frameDamage;
+
+    for(int scene = 0; scene < (sizeof(SCENE_NAMES) / sizeof(SCENE_NAMES[0])); ++scene) {
+        uint64_t startTime = time_us_64();
+        for(uint32_t i = 0; i < iterations; ++i) {
+            benchmark_gui_paint(scene);
+        }
+        uint32_t paintTime = (uint32_t) ((time_us_64() - startTime) / iterations);
+        uint32_t paintHash = hash_image_buffer();
+
+        startTime = time_us_64();
+        for(uint32_t i = 0; i < iterations; ++i) {
+            benchmark_raster(scene);
+        }
+        uint32_t rasterTime = (uint32_t) ((time_us_64() - startTime) / iterations);
+        uint32_t rasterHash = hash_image_buffer();
+
+        printf("%-11s GUI_Paint %6lu us/frame, raster %6lu us/frame (%s)\n", SCENE_NAMES[scene],
+            (unsigned long) paintTime, (unsigned long) rasterTime, (paintHash == rasterHash) ? "identical" : "MISMATCH");
+    }
+
+    frameDamage = savedDamage;
+}
+
+bool is_display_flush_complete() {
+    return !LCD_1IN44_IsBusy();
+}
+
+void wait_for_display_flush() {
+    LCD_1IN44_WaitIdle();
 }
 
 void shutdown_display() {
+    LCD_1IN44_WaitIdle();
     DEV_Module_Exit();
 }
 
 // Drawing interface functions
 void wallet_gfx_clear_display(WalletPaintColor color) {
-    Paint_Clear(color);
+    raster_clear(&drawSurface, color);
+    add_damage(0, 0, waveshareDisplay.displayWidth, waveshareDisplay.displayHeight);
 }
 
 void wallet_gfx_draw_char(uint16_t xPos, uint16_t yPos, char c, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
-    sFONT* drawFont = to_waveshare_font(font);
-    if(!drawFont) {
+    if(!to_waveshare_font(font)) {
         return;
     }
 
-    Paint_DrawChar(xPos, yPos, c, drawFont, backgroundColor, foregroundColor);
+    text_draw_glyph(&drawSurface, xPos, yPos, c, font, foregroundColor, backgroundColor, true);
+    add_damage(xPos, yPos, (xPos + font->charWidth), (yPos + font->charHeight));
 }
 
 void wallet_gfx_draw_string(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
-    sFONT* drawFont = to_waveshare_font(font);
-    if(!drawFont) {
-        return;
-    }
+    draw_string(xPos, yPos, string, font, foregroundColor, backgroundColor, true);
+}
 
-    Paint_DrawString_EN(xPos, yPos, string, drawFont, foregroundColor, backgroundColor);
+void wallet_gfx_draw_string_uncached(uint16_t xPos, uint16_t yPos, const char* string, uint16_t stringLen, const WalletFont* font, WalletPaintColor foregroundColor, WalletPaintColor backgroundColor) {
+    draw_string(xPos, yPos, string, font, foregroundColor, backgroundColor, false);
 }
 
 void wallet_gfx_draw_bitmap(const uint8_t* bitmap, uint16_t xPos, uint16_t yPos, uint16_t bitmapWidth, uint16_t bitmapHeight) {
-    Paint_DrawImage(bitmap, xPos, yPos, bitmapWidth, bitmapHeight);
+    raster_draw_image(&drawSurface, bitmap, xPos, yPos, bitmapWidth, bitmapHeight);
+    add_damage(xPos, yPos, (xPos + bitmapWidth), (yPos + bitmapHeight));
 }
 
 void wallet_gfx_draw_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t lineWidth, WalletPaintColor color) {
-    Paint_DrawLine(x1, y1, x2, y2, color, to_waveshare_line_width(lineWidth), LINE_STYLE_SOLID);
+    raster_draw_line(&drawSurface, x1, y1, x2, y2, to_waveshare_line_width(lineWidth), color);
+    add_damage((MIN(x1, x2) - lineWidth), (MIN(y1, y2) - lineWidth), (MAX(x1, x2) + lineWidth + 1), (MAX(y1, y2) + lineWidth + 1));
 }
 
 void wallet_gfx_draw_circle(uint16_t centerX, uint16_t centerY, uint16_t radius, uint8_t lineWidth, bool filled, WalletPaintColor color) {
-    DRAW_FILL fill = filled ? DRAW_FILL_FULL : DRAW_FILL_EMPTY;
-    Paint_DrawCircle(centerX, centerY, radius, color, to_waveshare_line_width(lineWidth), fill);
+    raster_draw_circle(&drawSurface, centerX, centerY, radius, to_waveshare_line_width(lineWidth), filled, color);
+    add_damage((centerX - radius - lineWidth), (centerY - radius - lineWidth), (centerX + radius + lineWidth + 1), (centerY + radius + lineWidth + 1));
 }
 
 void wallet_gfx_draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t lineWidth, bool filled, WalletPaintColor color) {
-    DRAW_FILL fill = filled ? DRAW_FILL_FULL : DRAW_FILL_EMPTY;
-
-    Paint_DrawRectangle(x1, y1, x2, y2, color, to_waveshare_line_width(lineWidth), fill);
+    raster_draw_rectangle(&drawSurface, x1, y1, x2, y2, to_waveshare_line_width(lineWidth), filled, color);
+    add_damage((x1 - lineWidth), (y1 - lineWidth), (x2 + lineWidth + 1), (y2 + lineWidth + 1));
 }
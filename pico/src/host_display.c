@@ -0,0 +1,175 @@
+#include "gfx/gfx_utils.h"
+#include "gfx/headless_display.h"
+#include "utils/qr_cache.h"
+#include "utils/secure_zero.h"
+#include "utils/ur_encoder.h"
+#include "wallet_app/hd_wallet.h"
+#include "wallet_app/screens/icon_message_screen.h"
+#include "wallet_app/screens/info_message_screen.h"
+#include "wallet_app/screens/mnemonic_display_screen.h"
+#include "wallet_app/screens/password_entry_screen.h"
+#include "wallet_app/screens/progress_screen.h"
+#include "wallet_app/screens/qr_code_screen.h"
+#include "wallet_app/screens/splash_screen.h"
+#include "wallet_app/screens/timed_info_message_screen.h"
+#include "wallet_app/screens/wallet_navigate_screen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Host only. Renders each of the wallet's screens through the headless display backend and prints
+// how long a frame took to draw, e.g.
+//
+//   host_display 1000 /tmp/screens
+//
+// times each screen over 1000 frames and saves its final frame to /tmp/screens/<screen>.ppm
+
+#define DEFAULT_ITERATIONS      (200)
+#define HOST_MAX_SCREENS        (12)
+
+typedef struct {
+    const char* name;
+    WalletScreen screen;
+} HostScreen;
+
+// The BIP39 test vector mnemonic, keys from it are public knowledge
+static const char* const TEST_MNEMONIC[MNEMONIC_LENGTH] = {
+    "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "abandon",
+    "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "abandon",
+    "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "abandon", "art"
+};
+
+// Keys for the browse and QR code screens, from TEST_MNEMONIC
+static ExtendedKey masterKey;
+static ExtendedKey baseKey44;
+static ExtendedKey pathKeys[NUM_DERIVATION_PATHS];
+static uint16_t pathIndices[NUM_DERIVATION_PATHS];
+
+// Read by the animated QR code screen for as long as it exists
+static uint8_t urMessage[UR_MAX_HDKEY_CBOR_LENGTH];
+
+
+// Derive m/44'/0'/0'/0/0, as the browse screen would with its default selection
+static void init_test_keys() {
+    char mnemonic[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1];
+
+    for(int i = 0; i < MNEMONIC_LENGTH; ++i) {
+        strcpy(mnemonic[i], TEST_MNEMONIC[i]);
+    }
+
+    generate_master_key_from_mnemonic(mnemonic, &masterKey);
+    secure_zero(mnemonic, sizeof(mnemonic));
+
+    derive_child_key(&masterKey, BASE_KEY_INDEX, true, &baseKey44);
+
+    uint32_t path[NUM_DERIVATION_PATHS];
+    get_derivation_path(pathIndices, ADDRESS_INDEX, path);
+    for(int i = 0; i < NUM_DERIVATION_PATHS; ++i) {
+        const ExtendedKey* parentKey = (i == 0) ? &baseKey44 : &pathKeys[i - 1];
+        bool hardened = (path[i] & HARDENED_CHILD_INDEX_OFFSET);
+        derive_child_key(parentKey, (path[i] & ~HARDENED_CHILD_INDEX_OFFSET), hardened, &pathKeys[i]);
+    }
+}
+
+static void init_screens(HostScreen* screens, int* numScreens) {
+    int count = 0;
+
+    screens[count].name = "splash";
+    init_splash_screen(&screens[count++].screen);
+
+    screens[count].name = "password_entry";
+    init_password_entry_screen(&screens[count++].screen);
+
+    screens[count].name = "info_message";
+    init_info_message_screen(&screens[count++].screen, (InfoMessageScreenData) {
+        .message = "Insert an SD card\nto continue"
+    });
+
+    screens[count].name = "timed_info_message";
+    init_timed_info_message_screen(&screens[count++].screen, (TimedInfoMessageScreenData) {
+        .timeoutMS = 2000,
+        .message = "Wallet saved"
+    });
+
+    screens[count].name = "icon_message";
+    init_icon_message_screen(&screens[count++].screen, (IconMessageScreenData) {
+        .iconType = SUCCESS,
+        .message = "Wallet created",
+        .buttonKeys = { NO_KEY, NO_KEY, NO_KEY, OK_KEY }
+    });
+
+    screens[count].name = "progress";
+    init_progress_screen(&screens[count++].screen, (ProgressScreenData) {
+        .message = "Exporting",
+        .cancellable = true,
+        .percent = 40                   // Part way through, so the bar is drawn as well as its frame
+    });
+
+    MnemonicMessageScreenData mnemonicData;
+    memcpy(mnemonicData.mnemonicSentence, TEST_MNEMONIC, sizeof(TEST_MNEMONIC));
+    screens[count].name = "mnemonic_display";
+    init_mnemonic_display_screen(&screens[count++].screen, mnemonicData);
+
+    screens[count].name = "wallet_navigate";
+    init_wallet_navigate_screen(&screens[count++].screen, &baseKey44, ADDRESS_INDEX, pathIndices);
+
+    // The QR code is generated here, as on the device, so only its drawing is timed
+    uint32_t path[NUM_DERIVATION_PATHS];
+    QRCacheKey cacheKey;
+    uint8_t pathDepth = get_derivation_path(pathIndices, ADDRESS_INDEX, path);
+    qr_cache_make_key(&cacheKey, path, pathDepth, QR_KEY_TYPE_P2PKH, BTC_MAIN_NET);
+    screens[count].name = "qr_code";
+    init_qr_code_screen(&screens[count++].screen, &pathKeys[ADDRESS_INDEX], &cacheKey);
+
+    uint32_t originPath[NUM_DERIVATION_PATHS + 1] = { (BASE_KEY_INDEX + HARDENED_CHILD_INDEX_OFFSET) };
+    memcpy(&originPath[1], path, (pathDepth * sizeof(uint32_t)));
+    int messageLength = ur_encode_crypto_hdkey(&pathKeys[ADDRESS_INDEX], originPath, (pathDepth + 1), masterKey.fingerprint, urMessage);
+    screens[count].name = "qr_code_animated";
+    if(init_animated_qr_code_screen(&screens[count].screen, "crypto-hdkey", urMessage, messageLength,
+        UR_DEFAULT_MAX_FRAGMENT_LENGTH, ANIMATED_QR_FRAME_INTERVAL_MS)) {
+        ++count;
+    } else {
+        printf("Failed to set up the animated QR code screen\n");
+    }
+
+    for(int i = 0; i < count; ++i) {
+        enter_screen(&screens[i].screen);
+    }
+
+    *numScreens = count;
+}
+
+int main(int argc, char** argv) {
+    HostScreen screens[HOST_MAX_SCREENS] = { 0 };
+    int numScreens;
+    char ppmPath[256];
+
+    uint32_t iterations = (argc > 1) ? (uint32_t) atoi(argv[1]) : DEFAULT_ITERATIONS;
+    const char* outputDir = (argc > 2) ? argv[2] : NULL;
+
+    if(iterations == 0) {
+        printf("Usage: %s [iterations] [output directory]\n", argv[0]);
+        return 1;
+    }
+
+    init_test_keys();
+    init_display();
+    init_screens(screens, &numScreens);
+
+    printf("%u iterations per screen\n", (unsigned) iterations);
+    for(int i = 0; i < numScreens; ++i) {
+        if(outputDir) {
+            snprintf(ppmPath, sizeof(ppmPath), "%s/%s.ppm", outputDir, screens[i].name);
+        }
+
+        headless_benchmark_screen(screens[i].name, &screens[i].screen, iterations, (outputDir ? ppmPath : NULL));
+    }
+
+    qr_cache_clear();
+    secure_zero(&masterKey, sizeof(masterKey));
+    secure_zero(&baseKey44, sizeof(baseKey44));
+    secure_zero(pathKeys, sizeof(pathKeys));
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "utils/platform/host_disk.h"
+#include "utils/wallet_file.h"
+#include "wallet_app/hd_wallet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Host only. Runs the wallet file operations against a FAT disk image and prints what each one cost
+// in mounts, opens and sector I/O. Arguments are run in order, so a sequence shows how the mount
+// session carries over between operations, e.g.
+//
+//   host_wallet_file card.img create 1024 save load load mnemonic 0 unmount load
+//   host_wallet_file card.img create 4096 save 5 load 5 ctbench 1000
+
+typedef struct {
+    HostDiskStats disk;
+    WalletStorageStats storage;
+    uint64_t startUs;
+} OperationStart;
+
+
+static uint64_t get_time_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+static void fill_test_wallet_data(uint8_t* data) {
+    for(int i = 0; i < SERIALIZED_WALLET_SIZE; ++i) {
+        data[i] = (uint8_t) ((i * 7) + 3);
+    }
+}
+
+static void start_operation(OperationStart* start) {
+    start->disk = *host_disk_stats();
+    start->storage = *get_wallet_storage_stats();
+    start->startUs = get_time_us();
+}
+
+static void print_operation(const char* name, wallet_error result, const OperationStart* start) {
+    uint64_t timeUs = get_time_us() - start->startUs;
+    const HostDiskStats* disk = host_disk_stats();
+    const WalletStorageStats* storage = get_wallet_storage_stats();
+
+    printf("%-12s %3d/%-3d %8llu %6lu %6lu %6lu %6lu %8llu %6lu %8llu %6lu\n", name, GET_WF_RESULT(result), GET_FR_RESULT(result),
+        (unsigned long long) timeUs,
+        (unsigned long) (storage->mounts - start->storage.mounts),
+        (unsigned long) (storage->directoryChanges - start->storage.directoryChanges),
+        (unsigned long) (storage->opens - start->storage.opens),
+        (unsigned long) (disk->readCalls - start->disk.readCalls),
+        (unsigned long long) (disk->sectorsRead - start->disk.sectorsRead),
+        (unsigned long) (disk->writeCalls - start->disk.writeCalls),
+        (unsigned long long) (disk->sectorsWritten - start->disk.sectorsWritten),
+        (unsigned long) (disk->syncCalls - start->disk.syncCalls));
+}
+
+// An optional numeric parameter, e.g. the slot for save and load
+static uint32_t take_number(int argc, char** argv, int* argIndex, uint32_t defaultValue) {
+    if((*argIndex < argc) && (argv[*argIndex][0] >= '0') && (argv[*argIndex][0] <= '9')) {
+        return (uint32_t) atoi(argv[(*argIndex)++]);
+    }
+
+    return defaultValue;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s <image> <operation>...\n", program);
+    printf("  create <kb>         Make a new image of this size and format it\n");
+    printf("  format              Format the image\n");
+    printf("  save [slot]         Save a test pattern as the wallet data\n");
+    printf("  load [slot]         Load the wallet data, checking it against the test pattern\n");
+    printf("  mnemonic <index>    Read a mnemonic from mnemonic.txt\n");
+    printf("  unmount             End the mount session\n");
+    printf("  bench <kb>          Write and read back a file of this size\n");
+    printf("  ctbench <slots>     Fill, load, replace and search a scratch wallet container\n");
+}
+
+
+int main(int argc, char** argv) {
+    uint8_t data[SERIALIZED_WALLET_SIZE];
+    uint8_t expected[SERIALIZED_WALLET_SIZE];
+    char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1];
+    OperationStart start;
+    int argIndex = 2;
+
+
+    if(argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* imagePath = argv[1];
+    bool created = ((strcmp(argv[2], "create") == 0) && (argc > 3));
+    if(!host_disk_open(imagePath, (created ? (uint32_t) atoi(argv[3]) : 0))) {
+        return 1;
+    }
+
+    fill_test_wallet_data(expected);
+    printf("%-12s %7s %8s %6s %6s %6s %6s %8s %6s %8s %6s\n", "Operation", "Result", "Time us", "Mounts", "Chdirs", "Opens",
+        "Reads", "Sectors", "Writes", "Sectors", "Syncs");
+
+    while(argIndex < argc) {
+        const char* operation = argv[argIndex++];
+        const char* parameter = (argIndex < argc) ? argv[argIndex] : NULL;
+        wallet_error result = NO_ERROR;
+
+        start_operation(&start);
+
+        if((strcmp(operation, "create") == 0) || (strcmp(operation, "format") == 0)) {
+            if(strcmp(operation, "create") == 0) {
+                ++argIndex;
+            }
+
+            // Formatting underneath a mounted volume would leave FatFs with stale state
+            unmount_wallet_storage();
+            int fr = host_disk_format();
+            result = (fr == FR_OK) ? NO_ERROR : WALLET_ERROR(WF_FILESYSTEM_INIT_FAILED, fr);
+        } else if(strcmp(operation, "save") == 0) {
+            result = save_wallet_data_to_disk(take_number(argc, argv, &argIndex, DEFAULT_WALLET_SLOT), "host", expected);
+        } else if(strcmp(operation, "load") == 0) {
+            memset(data, 0, sizeof(data));
+            result = load_wallet_data_from_disk(take_number(argc, argv, &argIndex, DEFAULT_WALLET_SLOT), data);
+            if((result == NO_ERROR) && memcmp(data, expected, sizeof(data))) {
+                printf("Loaded wallet data doesn't match the test pattern\n");
+            }
+        } else if((strcmp(operation, "mnemonic") == 0) && parameter) {
+            uint32_t mnemonicCount = 0;
+            ++argIndex;
+            result = read_mnemonics_from_disk_at((uint32_t) atoi(parameter), mnemonics, &mnemonicCount);
+            if(result == NO_ERROR) {
+                printf("Mnemonic %s of %lu: %s %s ... %s\n", parameter, (unsigned long) mnemonicCount, mnemonics[0],
+                    mnemonics[1], mnemonics[MNEMONIC_LENGTH - 1]);
+            }
+        } else if(strcmp(operation, "unmount") == 0) {
+            unmount_wallet_storage();
+        } else if((strcmp(operation, "bench") == 0) && parameter) {
+            ++argIndex;
+            run_sd_benchmark((uint32_t) atoi(parameter));
+        } else if((strcmp(operation, "ctbench") == 0) && parameter) {
+            ++argIndex;
+            run_wallet_container_benchmark((uint32_t) atoi(parameter));
+        } else {
+            print_usage(argv[0]);
+            break;
+        }
+
+        print_operation(operation, result, &start);
+    }
+
+    unmount_wallet_storage();
+    host_disk_close();
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "pico/stdlib.h"
 
+#include "gfx/gfx_utils.h"
+#include "utils/hash_utils.h"
+#include "utils/wallet_file.h"
 #include "wallet_app/wallet_app.h"
 
 
@@ -8,7 +11,24 @@ void main() {
 
     init_application();
 
+#if DISPLAY_BENCHMARK
+    run_display_benchmark(DISPLAY_BENCHMARK);
+#endif
+
+#if PBKDF2_BENCHMARK
+    run_pbkdf2_benchmark();
+#endif
+
+#if SD_BENCHMARK
+    run_sd_benchmark(SD_BENCHMARK);
+#endif
+
+#if WALLET_CONTAINER_BENCHMARK
+    run_wallet_container_benchmark(WALLET_CONTAINER_BENCHMARK);
+#endif
+
     while(true) {
         update_application();
+        wait_for_application_event();
     }
 }
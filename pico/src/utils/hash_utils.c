@@ -1,7 +1,12 @@
 #include "hash_utils.h"
+#include "secure_zero.h"
+#include <stdio.h>
 #include <string.h>
 #include "hashing/ripemd160.h"
 #include "cryptography/cifra/sha2.h"
+#include "pico/time.h"
+
+#define PBKDF2_BENCHMARK_ITERATIONS     (2048)
 
 ripemd160_context ripemd160_ctx;
 
@@ -27,3 +32,119 @@ void hash_160(const uint8_t *input, int buffer_size, uint8_t *output) {
 void do_ripemd160(const uint8_t *input, int inputSize, uint8_t *output) {
     ripemd160_hash(input, inputSize, output, &ripemd160_ctx);
 }
+
+void pbkdf2_init(Pbkdf2State* state, const cf_chash* hash, const uint8_t* password, size_t passwordLength, const uint8_t* salt, size_t saltLength, uint32_t iterations, uint8_t* out, size_t outLength) {
+    cf_hmac_init(&state->startContext, hash, password, passwordLength);
+    state->hashSize = hash->hashsz;
+    state->salt = salt;
+    state->saltLength = saltLength;
+    state->iterations = iterations;
+    state->out = out;
+    state->outLength = outLength;
+    state->outWritten = 0;
+    state->blockNumber = 1;
+    state->blockIteration = 0;
+}
+
+bool pbkdf2_step(Pbkdf2State* state, uint32_t maxIterations) {
+    size_t hashSize = state->hashSize;
+    cf_hmac_ctx context;
+
+    for(; maxIterations && (state->outWritten < state->outLength); --maxIterations) {
+        context = state->startContext;
+
+        if(state->blockIteration == 0) {
+            // U_1 = PRF(P, S || INT_32_BE(i))
+            uint8_t blockNumber[4] = {
+                (state->blockNumber >> 24), (state->blockNumber >> 16), (state->blockNumber >> 8), state->blockNumber
+            };
+
+            cf_hmac_update(&context, state->salt, state->saltLength);
+            cf_hmac_update(&context, blockNumber, sizeof(blockNumber));
+            cf_hmac_finish(&context, state->U);
+            memcpy(state->block, state->U, hashSize);
+        } else {
+            // U_c = PRF(P, U_{c-1})
+            cf_hmac_update(&context, state->U, hashSize);
+            cf_hmac_finish(&context, state->U);
+            for(size_t i = 0; i < hashSize; ++i) {
+                state->block[i] ^= state->U[i];
+            }
+        }
+
+        if(++state->blockIteration == state->iterations) {
+            size_t taken = state->outLength - state->outWritten;
+            if(taken > hashSize) {
+                taken = hashSize;
+            }
+
+            memcpy((state->out + state->outWritten), state->block, taken);
+            state->outWritten += taken;
+            ++state->blockNumber;
+            state->blockIteration = 0;
+        }
+    }
+
+    // The working copy is keyed with the password, so is wiped after every step
+    secure_zero(&context, sizeof(context));
+
+    if(state->outWritten < state->outLength) {
+        return false;
+    }
+
+    // Don't leave anything derived from the password lying around
+    secure_zero(&state->startContext, sizeof(state->startContext));
+    secure_zero(state->U, sizeof(state->U));
+    secure_zero(state->block, sizeof(state->block));
+    return true;
+}
+
+uint8_t pbkdf2_percent(const Pbkdf2State* state) {
+    if((state->outWritten >= state->outLength) || (state->iterations == 0)) {
+        return 100;
+    }
+
+    uint32_t numBlocks = ((state->outLength + state->hashSize - 1) / state->hashSize);
+    uint64_t done = ((uint64_t) (state->blockNumber - 1) * state->iterations) + state->blockIteration;
+
+    return (uint8_t) ((done * 100) / ((uint64_t) numBlocks * state->iterations));
+}
+
+static void benchmark_pbkdf2(const char* name, const cf_chash* hash, size_t outLength) {
+    static const uint32_t STEP_ITERATIONS[] = { 1, 8, 32, 128, 512 };
+    static const uint8_t PASSWORD[] = "benchmark password";
+    static const uint8_t SALT[] = "benchmark salt";
+    uint8_t out[CF_MAXHASH];
+    Pbkdf2State state;
+
+    for(int i = 0; i < (sizeof(STEP_ITERATIONS) / sizeof(STEP_ITERATIONS[0])); ++i) {
+        uint32_t steps = 0;
+        uint32_t maxStepTime = 0;
+        uint64_t startTime = time_us_64();
+
+        pbkdf2_init(&state, hash, PASSWORD, (sizeof(PASSWORD) - 1), SALT, (sizeof(SALT) - 1), PBKDF2_BENCHMARK_ITERATIONS, out, outLength);
+
+        bool complete = false;
+        while(!complete) {
+            uint64_t stepStart = time_us_64();
+            complete = pbkdf2_step(&state, STEP_ITERATIONS[i]);
+            uint32_t stepTime = (uint32_t) (time_us_64() - stepStart);
+
+            ++steps;
+            if(stepTime > maxStepTime) {
+                maxStepTime = stepTime;
+            }
+        }
+
+        uint32_t totalTime = (uint32_t) (time_us_64() - startTime);
+        printf("%-8s %4lu it/step: %5lu steps, %7lu us/step avg, %7lu us/step max, %8lu us total\n", name,
+            (unsigned long) STEP_ITERATIONS[i], (unsigned long) steps, (unsigned long) (totalTime / steps),
+            (unsigned long) maxStepTime, (unsigned long) totalTime);
+    }
+}
+
+void run_pbkdf2_benchmark() {
+    printf("PBKDF2 step latency, %d iterations\n", PBKDF2_BENCHMARK_ITERATIONS);
+    benchmark_pbkdf2("SHA-256", &cf_sha256, PBKDF2_HMAC_SHA256_SIZE);
+    benchmark_pbkdf2("SHA-512", &cf_sha512, SHA512_DIGEST_SIZE);
+}
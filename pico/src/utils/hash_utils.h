@@ -2,12 +2,30 @@
 #define HASH_UTILS_H
 
 #include "pico/types.h"
+#include "cryptography/cifra/hmac.h"
 
 #define SHA256_DIGEST_SIZE          (32)
 #define SHA512_DIGEST_SIZE          (64)
 #define RIPEMD_160_DIGEST_SIZE      (20)
 #define PBKDF2_HMAC_SHA256_SIZE     (32)
 
+// PBKDF2-HMAC that can be run a few iterations at a time, so a caller with a frame time budget can
+// spread it across several updates. The output matches cf_pbkdf2_hmac()
+typedef struct {
+    cf_hmac_ctx startContext;               // HMAC keyed with the password, where every iteration starts
+    size_t hashSize;
+    const uint8_t* salt;
+    size_t saltLength;
+    uint32_t iterations;                    // Per output block
+    uint8_t* out;
+    size_t outLength;
+    size_t outWritten;
+    uint32_t blockNumber;                   // Output block being worked on, from 1
+    uint32_t blockIteration;                // Iterations of it done so far
+    uint8_t U[CF_MAXHASH];                  // Latest iteration's HMAC
+    uint8_t block[CF_MAXHASH];              // XOR of the block's iterations so far
+} Pbkdf2State;
+
 void do_sha256(const uint8_t *input, int buffer_size, uint8_t *output);
 void do_sha512(const uint8_t *input, int buffer_size, uint8_t *output);
 
@@ -17,5 +35,35 @@ void do_ripemd160(const uint8_t *input, int inputSize, uint8_t *output);
 
 void hash_160(const uint8_t *input, int buffer_size, uint8_t *output);
 
+/**
+ * Start a PBKDF2-HMAC derivation. The password is consumed here, but the salt is read again at the
+ * start of each output block so must stay valid until the derivation is complete
+ *
+ * state                out     Derivation state
+ * hash                 in      Hash for the HMAC, e.g. &cf_sha256
+ * password             in      Password, and its length
+ * salt                 in      Salt, and its length
+ * iterations           in      Iterations per output block
+ * out                  out     Derived key, written as each block completes
+ * outLength            in      Length of the derived key
+ */
+void pbkdf2_init(Pbkdf2State* state, const cf_chash* hash, const uint8_t* password, size_t passwordLength, const uint8_t* salt, size_t saltLength, uint32_t iterations, uint8_t* out, size_t outLength);
+
+/**
+ * Run up to maxIterations more iterations. Intermediate values are wiped once the key is complete
+ *
+ * Returns true once the whole key has been written
+ */
+bool pbkdf2_step(Pbkdf2State* state, uint32_t maxIterations);
+
+// Share of the iterations done so far, 0-100
+uint8_t pbkdf2_percent(const Pbkdf2State* state);
+
+/**
+ * Time pbkdf2_step() at a range of iterations per step, for the wallet password (SHA-256) and BIP39
+ * seed (SHA-512) derivations, and print the per-step latency over stdio
+ */
+void run_pbkdf2_benchmark();
+
 
 #endif
@@ -1,5 +1,19 @@
 #include "key_print_utils.h"
+#include "secure_zero.h"
 #include <stdio.h>
+#include <string.h>
+
+
+#define PRINT_LINE_BUFFER_SIZE              (256)
+
+// Terminal glyphs. Each character covers two vertically stacked QR modules
+#define GLYPH_FULL_BLOCK                    "█"
+#define GLYPH_UPPER_HALF_BLOCK              "▀"
+#define GLYPH_LOWER_HALF_BLOCK              "▄"
+#define GLYPH_EMPTY                         " "
+
+#define QR_FRAME_SIZE                       (QR_CODE_SIZE + 4)      // QR code plus a padding and border ring
+#define QR_DIVIDER                          "  "
 
 
 uint8_t PRIVATE_KEY_QR_BUFFER[QR_CODE_BYTES];
@@ -8,180 +22,185 @@ uint8_t PUBLIC_ADDRESS_QR_BUFFER[QR_CODE_BYTES];
 uint8_t PRIVATE_KEY_PRINT_BUFFER[128];
 uint8_t PUBLIC_ADDRESS_PRINT_BUFFER[64];
 
+// Output is assembled a line at a time and written in one go, rather than in tiny (and, over USB
+// CDC, very slow) per-character writes
+static char printLineBuffer[PRINT_LINE_BUFFER_SIZE];
+static int printLineLength;
 
-void print_key_qr_codes(const ExtendedKey* key) {
-    uint16_t currentPrivateBit = 0;
-    uint16_t currentPublicBit = 0;
 
-    get_private_key_wif_qr(key, BTC_MAIN_NET, PRIVATE_KEY_QR_BUFFER);
-    get_p2pkh_qr(key, PUBLIC_ADDRESS_QR_BUFFER);
+static void line_append(const char* str) {
+    int len = strlen(str);
 
-
-    // Top border row
-    printf("\u2588\u2588\u2588\u2588");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("\u2588\u2588");
-    }
-    printf("\u2588\u2588\u2588\u2588    \u2588\u2588\u2588\u2588");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("\u2588\u2588");
+    if((printLineLength + len) > PRINT_LINE_BUFFER_SIZE) {
+        len = (PRINT_LINE_BUFFER_SIZE - printLineLength);
     }
-    printf("\u2588\u2588\u2588\u2588\n");
 
-    // Top padding row
-    printf("\u2588\u2588  ");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("  ");
-    }
-
-    printf("  \u2588\u2588    \u2588\u2588  ");     // Divider
+    memcpy(&printLineBuffer[printLineLength], str, len);
+    printLineLength += len;
+}
 
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("  ");
+static void line_append_chars(const uint8_t* chars, int len) {
+    if((printLineLength + len) > PRINT_LINE_BUFFER_SIZE) {
+        len = (PRINT_LINE_BUFFER_SIZE - printLineLength);
     }
-    printf("  \u2588\u2588\n");
-
-    // QR code rows
-    for (uint8_t y = 0; y < QR_CODE_SIZE; y++) {
-        printf("\u2588\u2588  ");
-        
-        // Private key
-        for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-            uint8_t cByte = currentPrivateBit / 8;
-            uint8_t cBit = currentPrivateBit % 8;
-
-            uint8_t set = (PRIVATE_KEY_QR_BUFFER[cByte] & (1 << (7 - cBit)));
-            if(set != 0) {
-                printf("\u2588\u2588");
-            } else {
-                printf("  ");
-            }
 
-            ++currentPrivateBit;
-        }
+    memcpy(&printLineBuffer[printLineLength], chars, len);
+    printLineLength += len;
+}
 
-        printf("  \u2588\u2588    \u2588\u2588  ");
+static void line_append_hex(const uint8_t* bytes, int len) {
+    static const char HEX_CHARS[] = "0123456789ABCDEF";
 
-        // Public
-        for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-            uint8_t cByte = currentPublicBit / 8;
-            uint8_t cBit = currentPublicBit % 8;
+    for(int i = 0; (i < len) && ((printLineLength + 2) <= PRINT_LINE_BUFFER_SIZE); ++i) {
+        printLineBuffer[printLineLength++] = HEX_CHARS[bytes[i] >> 4];
+        printLineBuffer[printLineLength++] = HEX_CHARS[bytes[i] & 0x0F];
+    }
+}
 
-            uint8_t set = (PUBLIC_ADDRESS_QR_BUFFER[cByte] & (1 << (7 - cBit)));
+static void line_flush() {
+    if(printLineLength < PRINT_LINE_BUFFER_SIZE) {
+        printLineBuffer[printLineLength++] = '\n';
+    } else {
+        printLineBuffer[PRINT_LINE_BUFFER_SIZE - 1] = '\n';
+    }
 
-            if(set != 0) {
-                printf("\u2588\u2588");
-            } else {
-                printf("  ");
-            }
+    fwrite(printLineBuffer, 1, printLineLength, stdout);
+    printLineLength = 0;
+}
 
-            ++currentPublicBit;
-        }
 
-        printf("  \u2588\u2588");
-        printf("\n");
+// Returns the module at (x, y) of the QR code surrounded by a one module padding ring and a 
+// one module border ring, matching the frame drawn around printed QR codes
+static bool get_framed_module(const uint8_t* qrcode, int x, int y) {
+    if((x < 0) || (y < 0) || (x >= QR_FRAME_SIZE) || (y >= QR_FRAME_SIZE)) {
+        return false;
     }
 
-    // Bottom padding row
-    printf("\u2588\u2588  ");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("  ");
+    if((x == 0) || (y == 0) || (x == (QR_FRAME_SIZE - 1)) || (y == (QR_FRAME_SIZE - 1))) {
+        return true;
     }
 
-    printf("  \u2588\u2588    \u2588\u2588  ");         // Divider
-    
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("  ");
+    if((x == 1) || (y == 1) || (x == (QR_FRAME_SIZE - 2)) || (y == (QR_FRAME_SIZE - 2))) {
+        return false;
     }
-    printf("  \u2588\u2588\n");
 
-    // Bottom border row
-    printf("\u2588\u2588\u2588\u2588");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("\u2588\u2588");
+    uint16_t bit = ((y - 2) * QR_CODE_SIZE) + (x - 2);
+    return (qrcode[bit / 8] & (1 << (7 - (bit % 8)))) != 0;
+}
+
+static void line_append_qr_row_pair(const uint8_t* qrcode, int y) {
+    for(int x = 0; x < QR_FRAME_SIZE; ++x) {
+        bool top = get_framed_module(qrcode, x, y);
+        bool bottom = get_framed_module(qrcode, x, (y + 1));
+
+        if(top && bottom) {
+            line_append(GLYPH_FULL_BLOCK);
+        } else if(top) {
+            line_append(GLYPH_UPPER_HALF_BLOCK);
+        } else if(bottom) {
+            line_append(GLYPH_LOWER_HALF_BLOCK);
+        } else {
+            line_append(GLYPH_EMPTY);
+        }
     }
-    printf("\u2588\u2588\u2588\u2588    \u2588\u2588\u2588\u2588");
-    for (uint8_t x = 0; x < QR_CODE_SIZE; x++) {
-        printf("\u2588\u2588");
+}
+
+// Prints the supplied QR codes side by side, two module rows per line of text
+static void print_qr_codes(const uint8_t** qrcodes, int numCodes) {
+    for(int y = 0; y < QR_FRAME_SIZE; y += 2) {
+        for(int i = 0; i < numCodes; ++i) {
+            if(i > 0) {
+                line_append(QR_DIVIDER);
+            }
+            line_append_qr_row_pair(qrcodes[i], y);
+        }
+        line_flush();
     }
-    printf("\u2588\u2588\u2588\u2588\n");
 }
 
-void print_key_details(const char* title, const ExtendedKey* key) {
-    int addressLen;
+static void print_labelled_chars(const char* label, const uint8_t* chars, int len) {
+    line_append(label);
+    line_append_chars(chars, len);
+    line_flush();
+}
 
-    printf("Extended key - %s\n\n", title);
+static void print_labelled_hex(const char* label, const uint8_t* bytes, int len) {
+    line_append(label);
+    line_append_hex(bytes, len);
+    line_flush();
+}
 
-    printf(" Private key bytes: ");
-    for(int i = 0; i < PRIVATE_KEY_LENGTH; ++i) {
-        printf("%02X", key->privateKey[i]);
-    }
-    printf("\n");
 
-    printf("  Chain code bytes: ");
-    for(int i = 0; i < CHAIN_CODE_LENGTH; ++i) {
-        printf("%02X", key->chainCode[i]);
-    }
-    printf("\n");
+void print_key_qr_codes(const ExtendedKey* key) {
+    const uint8_t* qrcodes[] = { PRIVATE_KEY_QR_BUFFER, PUBLIC_ADDRESS_QR_BUFFER };
 
-    printf("  Public key bytes: ");
-    for(int i = 0; i < PUBLIC_KEY_LENGTH; ++i) {
-        printf("%02X", key->publicKey[i]);
-    }
-    printf("\n");
+    get_private_key_wif_qr(key, BTC_MAIN_NET, PRIVATE_KEY_QR_BUFFER);
+    get_p2pkh_qr(key, PUBLIC_ADDRESS_QR_BUFFER);
 
-    printf("       Fingerprint: ");
-    for(int i = 0; i < FINGERPRINT_LENGTH; ++i) {
-        printf("%02X", key->fingerprint[i]);
-    }
-    printf("\n");
+    print_qr_codes(qrcodes, 2);
+}
 
-    printf("Parent Fingerprint: ");
-    for(int i = 0; i < FINGERPRINT_LENGTH; ++i) {
-        printf("%02X", key->parentFingerprint[i]);
-    }
-    printf("\n");
+void print_key_details(const char* title, const ExtendedKey* key) {
+    int addressLen;
 
-    printf("             Index: 0x%08X\n\n", key->index);
+    printf("Extended key - %s\n\n", title);
 
+    print_labelled_hex(" Private key bytes: ", key->privateKey, PRIVATE_KEY_LENGTH);
+    print_labelled_hex("  Chain code bytes: ", key->chainCode, CHAIN_CODE_LENGTH);
+    print_labelled_hex("  Public key bytes: ", key->publicKey, PUBLIC_KEY_LENGTH);
+    print_labelled_hex("       Fingerprint: ", key->fingerprint, FINGERPRINT_LENGTH);
+    print_labelled_hex("Parent Fingerprint: ", key->parentFingerprint, FINGERPRINT_LENGTH);
+
+    printf("             Index: 0x%08X\n\n", key->index);
 
-    printf(" BIP32 Private Key: ");
     addressLen = get_extended_private_key_address(key, PRIVATE_KEY_PRINT_BUFFER);
-    for(int i = 0; i < addressLen; ++i) {
-        printf("%c", PRIVATE_KEY_PRINT_BUFFER[i]);
-    }
-    printf("\n");
-    printf("         +     WIF: ");
+    print_labelled_chars(" BIP32 Private Key: ", PRIVATE_KEY_PRINT_BUFFER, addressLen);
     addressLen = get_private_key_wif(key, BTC_MAIN_NET, PRIVATE_KEY_PRINT_BUFFER);
-    printf("%s", PRIVATE_KEY_PRINT_BUFFER);
-    printf("\n");
-    
-    printf("  BIP32 Public Key: ");
+    print_labelled_chars("         +     WIF: ", PRIVATE_KEY_PRINT_BUFFER, addressLen);
+
     addressLen = get_extended_public_key_address(key, PRIVATE_KEY_PRINT_BUFFER);
-    for(int i = 0; i < addressLen; ++i) {
-        printf("%c", PRIVATE_KEY_PRINT_BUFFER[i]);
-    }
-    printf("\n");
-    printf("          +  P2PKH: ");
+    print_labelled_chars("  BIP32 Public Key: ", PRIVATE_KEY_PRINT_BUFFER, addressLen);
     addressLen = get_p2pkh_public_address(key, PUBLIC_ADDRESS_PRINT_BUFFER);
-    for(int i = 0; i < addressLen; ++i) {
-        printf("%c", PUBLIC_ADDRESS_PRINT_BUFFER[i]);
-    }
-    printf("\n");
-
-    printf("          + P2WPKH: ");
+    print_labelled_chars("          +  P2PKH: ", PUBLIC_ADDRESS_PRINT_BUFFER, addressLen);
     addressLen = get_p2wpkh_public_address(key, PUBLIC_ADDRESS_PRINT_BUFFER);
-    for(int i = 0; i < addressLen; ++i) {
-        printf("%c", PUBLIC_ADDRESS_PRINT_BUFFER[i]);
-    }
-    printf("\n\n");
+    print_labelled_chars("          + P2WPKH: ", PUBLIC_ADDRESS_PRINT_BUFFER, addressLen);
 
-    printf("    QR Codes:\n\n");
+    printf("\n    QR Codes:\n\n");
     print_key_qr_codes(key);
 
     printf("\n\n\n");
 }
 
+void print_address_batch(const ExtendedKey* parentKey, uint32_t firstIndex, int count, bool printQRCodes) {
+    ExtendedKey childKey;
+    char indexText[16];
+    int addressLen;
+
+    for(int i = 0; i < count; ++i) {
+        uint32_t index = (firstIndex + i);
+        derive_child_key(parentKey, index, false, &childKey);
+
+        snprintf(indexText, sizeof(indexText), "%10lu  ", (unsigned long) index);
+        line_append(indexText);
+
+        addressLen = get_p2pkh_public_address(&childKey, PUBLIC_ADDRESS_PRINT_BUFFER);
+        line_append_chars(PUBLIC_ADDRESS_PRINT_BUFFER, addressLen);
+        line_append("  ");
+
+        addressLen = get_p2wpkh_public_address(&childKey, PUBLIC_ADDRESS_PRINT_BUFFER);
+        line_append_chars(PUBLIC_ADDRESS_PRINT_BUFFER, addressLen);
+        line_flush();
+
+        if(printQRCodes) {
+            const uint8_t* qrcodes[] = { PUBLIC_ADDRESS_QR_BUFFER };
+            get_p2pkh_qr(&childKey, PUBLIC_ADDRESS_QR_BUFFER);
+            print_qr_codes(qrcodes, 1);
+        }
+    }
+
+    secure_zero(&childKey, sizeof(ExtendedKey));
+}
+
 void print_bytes(const uint8_t* a, int aSize, int formatted) {
     if(formatted) {
         printf("    ");
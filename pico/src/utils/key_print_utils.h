@@ -7,4 +7,15 @@ void print_key_qr_codes(const ExtendedKey* key);
 void print_key_details(const char* title, const ExtendedKey* key);
 void print_bytes(const uint8_t* a, int aSize, int formatted);
 
+/**
+ * Print the addresses of a run of consecutive (non-hardened) children of the supplied key, one
+ * line per address. Intended for bulk auditing of addresses over the serial console.
+ *
+ * parentKey        in      The key whose children are printed (e.g. a BIP44 "change" level key)
+ * firstIndex       in      Child index of the first address to print
+ * count            in      Number of addresses to print
+ * printQRCodes     in      Also print the P2PKH QR code for each address
+ */
+void print_address_batch(const ExtendedKey* parentKey, uint32_t firstIndex, int count, bool printQRCodes);
+
 #endif      // _KEY_PRINT_UTILS_H_
@@ -32,8 +32,6 @@
     CHECKSUM_FIELD_LENGTH                           \
 )
 
-#define HARDENED_CHILD_INDEX_OFFSET         (0x80000000)
-
 const uint8_t SECP256K1_CURVE_ORDER[32] = {
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
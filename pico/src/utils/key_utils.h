@@ -6,6 +6,7 @@
 #define PUBLIC_KEY_LENGTH                   (33)
 #define CHAIN_CODE_LENGTH                   (32)
 #define FINGERPRINT_LENGTH                  (4)
+#define HARDENED_CHILD_INDEX_OFFSET         (0x80000000)
 
 #include "seed_utils.h"
 #include "pico/stdlib.h"
@@ -0,0 +1,239 @@
+#include "flash_store.h"
+#include "utils/hash_utils.h"
+
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+//
+//      Record format
+//
+//  +-------------------------------+
+//  | Magic                         |   "PWFS"
+//  | 4 bytes                       |
+//  +-------------------------------+
+//  | Check                         |   First 4 bytes of SHA-256 over everything from the
+//  | 4 bytes                       |   sequence number to the end of the data
+//  +-------------------------------+
+//  | Sequence number               |   One more than the record before, the newest wins
+//  | 4 bytes                       |
+//  +-------------------------------+
+//  | Data length                   |
+//  | 2 bytes                       |
+//  +-------------------------------+
+//  | Reserved                      |   0xFFFF
+//  | 2 bytes                       |
+//  +-------------------------------+
+//  | Data                          |
+//  +-------------------------------+
+//  | 0xFF padding to               |
+//  | FLASH_STORE_RECORD_SIZE       |
+//  +-------------------------------+
+//
+//  Records fill the slots in order, wrapping round. A sector is erased as the first of its slots is
+//  reached, by which time everything in it is older than the newest record
+//
+#define RECORD_MAGIC            (0x53465750)
+#define CHECKED_OFFSET          (2 * sizeof(uint32_t))
+#define MAX_RECORD_DATA         (FLASH_STORE_RECORD_SIZE - sizeof(FlashRecordHeader))
+#define SLOTS_PER_SECTOR        (FLASH_SECTOR_SIZE / FLASH_STORE_RECORD_SIZE)
+#define NO_SLOT                 (-1)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t check;
+    uint32_t sequence;
+    uint16_t length;
+    uint16_t reserved;
+} FlashRecordHeader;
+
+// From the linker script, the end of the program image
+extern char __flash_binary_end;
+
+static bool storeScanned = false;
+static int newestSlot = NO_SLOT;
+static uint32_t newestSequence;
+static FlashStoreStats storeStats;
+
+// Programming copies from RAM, never from the flash being written
+static uint8_t recordBuffer[FLASH_STORE_RECORD_SIZE];
+
+
+static const uint8_t* slot_address(int slot) {
+    return (const uint8_t*) (XIP_BASE + FLASH_STORE_OFFSET + (slot * FLASH_STORE_RECORD_SIZE));
+}
+
+static int slot_sector(int slot) {
+    return (slot / SLOTS_PER_SECTOR);
+}
+
+static uint32_t record_check(const uint8_t* record, uint16_t length) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t check;
+
+    do_sha256(&record[CHECKED_OFFSET], (sizeof(FlashRecordHeader) - CHECKED_OFFSET + length), digest);
+    memcpy(&check, digest, sizeof(check));
+
+    return check;
+}
+
+static bool is_valid_record(int slot) {
+    const uint8_t* record = slot_address(slot);
+    const FlashRecordHeader* header = (const FlashRecordHeader*) record;
+
+    return (header->magic == RECORD_MAGIC) &&
+        (header->length <= MAX_RECORD_DATA) &&
+        (header->check == record_check(record, header->length));
+}
+
+static bool is_blank(int slot) {
+    const uint8_t* record = slot_address(slot);
+
+    for(int i = 0; i < FLASH_STORE_RECORD_SIZE; ++i) {
+        if(record[i] != 0xFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A program image that has grown into the reserved sectors would be erased by the first write
+static bool is_store_available() {
+    static bool warned = false;
+
+    bool available = ((uint32_t) &__flash_binary_end - XIP_BASE) <= FLASH_STORE_OFFSET;
+    if(!available && !warned) {
+        printf("Flash store disabled, the program image overlaps it\n");
+        warned = true;
+    }
+
+    return available;
+}
+
+static void scan_store() {
+    if(storeScanned) {
+        return;
+    }
+
+    for(int slot = 0; slot < FLASH_STORE_SLOTS; ++slot) {
+        if(!is_valid_record(slot)) {
+            continue;
+        }
+
+        // Compared as a difference, so the newest still wins once the sequence numbers wrap
+        uint32_t sequence = ((const FlashRecordHeader*) slot_address(slot))->sequence;
+        if((newestSlot == NO_SLOT) || ((int32_t) (sequence - newestSequence) > 0)) {
+            newestSlot = slot;
+            newestSequence = sequence;
+        }
+    }
+
+    storeScanned = true;
+    ++storeStats.scans;
+}
+
+// Nothing may execute from flash while it is erased or programmed, neither core1 nor an interrupt
+// handler on this core. Core1 is only held if it has agreed to be, see multicore_lockout_victim_init()
+static void run_flash_operation(uint32_t offset, const uint8_t* data) {
+    bool holdCore1 = multicore_lockout_victim_is_initialized(1);
+    if(holdCore1) {
+        multicore_lockout_start_blocking();
+    }
+
+    uint32_t interrupts = save_and_disable_interrupts();
+    if(data) {
+        flash_range_program(offset, data, FLASH_STORE_RECORD_SIZE);
+    } else {
+        flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    }
+    restore_interrupts(interrupts);
+
+    if(holdCore1) {
+        multicore_lockout_end_blocking();
+    }
+}
+
+
+wallet_error flash_store_read(uint8_t* data, uint32_t length) {
+    uint64_t startTime = time_us_64();
+
+    if(!is_store_available()) {
+        return WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
+    }
+
+    scan_store();
+    if(newestSlot == NO_SLOT) {
+        return WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
+    }
+
+    const uint8_t* record = slot_address(newestSlot);
+    if(((const FlashRecordHeader*) record)->length != length) {
+        return WALLET_ERROR(WF_WALLET_FILE_CORRUPTED, 0);
+    }
+
+    memcpy(data, &record[sizeof(FlashRecordHeader)], length);
+
+    ++storeStats.reads;
+    storeStats.lastReadUs = (uint32_t) (time_us_64() - startTime);
+    return NO_ERROR;
+}
+
+wallet_error flash_store_write(const uint8_t* data, uint32_t length) {
+    if((length > MAX_RECORD_DATA) || !is_store_available()) {
+        return WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, 0);
+    }
+
+    scan_store();
+
+    uint32_t sequence = (newestSlot == NO_SLOT) ? 1 : (newestSequence + 1);
+    FlashRecordHeader header = {
+        .magic = RECORD_MAGIC,
+        .sequence = sequence,
+        .length = length,
+        .reserved = 0xFFFF
+    };
+
+    memset(recordBuffer, 0xFF, FLASH_STORE_RECORD_SIZE);
+    memcpy(recordBuffer, &header, sizeof(header));
+    memcpy(&recordBuffer[sizeof(header)], data, length);
+    header.check = record_check(recordBuffer, length);
+    memcpy(recordBuffer, &header, sizeof(header));
+
+    int slot = (newestSlot == NO_SLOT) ? 0 : ((newestSlot + 1) % FLASH_STORE_SLOTS);
+    for(int attempt = 0; attempt < FLASH_STORE_SLOTS; ++attempt, slot = ((slot + 1) % FLASH_STORE_SLOTS)) {
+        if((slot % SLOTS_PER_SECTOR) == 0) {
+            // Wrapped all the way round to the newest record's sector, it must survive until this
+            // one is written
+            if((newestSlot != NO_SLOT) && (slot_sector(slot) == slot_sector(newestSlot))) {
+                break;
+            }
+
+            run_flash_operation(FLASH_STORE_OFFSET + (slot_sector(slot) * FLASH_SECTOR_SIZE), NULL);
+            ++storeStats.erases;
+        } else if(!is_blank(slot)) {
+            ++storeStats.skippedSlots;
+            continue;
+        }
+
+        run_flash_operation(FLASH_STORE_OFFSET + (slot * FLASH_STORE_RECORD_SIZE), recordBuffer);
+        if(memcmp(slot_address(slot), recordBuffer, FLASH_STORE_RECORD_SIZE)) {
+            ++storeStats.skippedSlots;
+            continue;
+        }
+
+        newestSlot = slot;
+        newestSequence = sequence;
+        ++storeStats.writes;
+        return NO_ERROR;
+    }
+
+    return WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, 0);
+}
+
+const FlashStoreStats* get_flash_store_stats() {
+    return &storeStats;
+}
@@ -0,0 +1,51 @@
+#ifndef _FLASH_STORE_H_
+#define _FLASH_STORE_H_
+
+#include "wallet_defs.h"
+
+#include "hardware/flash.h"
+
+
+#define FLASH_STORE_SECTORS                 (4)
+#define FLASH_STORE_SIZE                    (FLASH_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define FLASH_STORE_OFFSET                  (PICO_FLASH_SIZE_BYTES - FLASH_STORE_SIZE)     // From the start of flash
+#define FLASH_STORE_RECORD_SIZE             (2 * FLASH_PAGE_SIZE)
+#define FLASH_STORE_SLOTS                   (FLASH_STORE_SIZE / FLASH_STORE_RECORD_SIZE)
+
+typedef struct {
+    uint32_t scans;                 // Scans of the whole store, one per boot
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;                // Sectors erased, a sector is only erased as the log wraps into it
+    uint32_t skippedSlots;          // Slots passed over because they weren't blank, e.g. a write cut short
+    uint32_t lastReadUs;            // Time taken by the last flash_store_read(), scan included
+} FlashStoreStats;
+
+
+/**
+ * Read the newest record. The store is scanned on first use, after that a read is a copy out of
+ * XIP flash
+ *
+ * data             out     The record's bytes
+ * length           in      Expected length of the record
+ *
+ * Returns WF_FILE_NOT_FOUND if nothing has been written, or WF_WALLET_FILE_CORRUPTED if the newest
+ * record isn't length bytes long
+ */
+wallet_error flash_store_read(uint8_t* data, uint32_t length);
+
+/**
+ * Append a record, which becomes the newest. Records go round the reserved sectors in turn, so each
+ * sector is erased once every FLASH_STORE_SLOTS writes. Interrupts are disabled and core1 is held
+ * (if it has called multicore_lockout_victim_init()) while the flash is erased or programmed, since
+ * nothing can execute from flash until it is done
+ *
+ * data             in      The record's bytes
+ * length           in      At most FLASH_STORE_RECORD_SIZE less the record header
+ */
+wallet_error flash_store_write(const uint8_t* data, uint32_t length);
+
+const FlashStoreStats* get_flash_store_stats();
+
+
+#endif      // _FLASH_STORE_H_
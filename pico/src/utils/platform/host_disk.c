@@ -0,0 +1,184 @@
+#include "host_disk.h"
+
+#include "ff.h"
+#include "diskio.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define HOST_DISK_DRIVE             (0)
+
+static int imageFile = -1;
+static uint8_t* image = NULL;
+static size_t imageSize;
+static DSTATUS driveStatus = STA_NOINIT;
+static HostDiskStats diskStats;
+
+
+static bool is_valid_range(LBA_t sector, UINT count) {
+    uint64_t sectors = imageSize / HOST_DISK_SECTOR_SIZE;
+    return (sector < sectors) && (count <= (sectors - sector));
+}
+
+
+bool host_disk_open(const char* path, uint32_t createSizeKb) {
+    struct stat imageStat;
+
+    host_disk_close();
+
+    imageFile = open(path, (createSizeKb ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR), 0644);
+    if(imageFile < 0) {
+        perror(path);
+        return false;
+    }
+
+    if(createSizeKb && (ftruncate(imageFile, ((off_t) createSizeKb * 1024)) != 0)) {
+        perror(path);
+        host_disk_close();
+        return false;
+    }
+
+    if((fstat(imageFile, &imageStat) != 0) || (imageStat.st_size == 0) || (imageStat.st_size % HOST_DISK_SECTOR_SIZE)) {
+        printf("%s: not a whole number of %d byte sectors\n", path, HOST_DISK_SECTOR_SIZE);
+        host_disk_close();
+        return false;
+    }
+
+    imageSize = (size_t) imageStat.st_size;
+    image = mmap(NULL, imageSize, (PROT_READ | PROT_WRITE), MAP_SHARED, imageFile, 0);
+    if(image == MAP_FAILED) {
+        image = NULL;
+        perror(path);
+        host_disk_close();
+        return false;
+    }
+
+    driveStatus = STA_NOINIT;
+    return true;
+}
+
+void host_disk_close() {
+    if(image) {
+        msync(image, imageSize, MS_SYNC);
+        munmap(image, imageSize);
+        image = NULL;
+    }
+
+    if(imageFile >= 0) {
+        close(imageFile);
+        imageFile = -1;
+    }
+
+    imageSize = 0;
+    driveStatus = STA_NOINIT;
+}
+
+int host_disk_format() {
+    static BYTE work[FF_MAX_SS];
+    MKFS_PARM options = {
+        .fmt = (FM_ANY | FM_SFD)
+    };
+
+    return f_mkfs("0:", &options, work, sizeof(work));
+}
+
+uint32_t host_disk_sectors() {
+    return (uint32_t) (imageSize / HOST_DISK_SECTOR_SIZE);
+}
+
+const HostDiskStats* host_disk_stats() {
+    return &diskStats;
+}
+
+void host_disk_reset_stats() {
+    memset(&diskStats, 0, sizeof(diskStats));
+}
+
+
+// FatFs diskio interface
+
+DSTATUS disk_status(BYTE pdrv) {
+    ++diskStats.statusCalls;
+    return (pdrv == HOST_DISK_DRIVE) ? driveStatus : STA_NOINIT;
+}
+
+DSTATUS disk_initialize(BYTE pdrv) {
+    ++diskStats.initializeCalls;
+    if(pdrv != HOST_DISK_DRIVE) {
+        return STA_NOINIT;
+    }
+
+    driveStatus = image ? 0 : (STA_NOINIT | STA_NODISK);
+    return driveStatus;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count) {
+    ++diskStats.readCalls;
+    if((pdrv != HOST_DISK_DRIVE) || !is_valid_range(sector, count)) {
+        return RES_PARERR;
+    }
+    if(driveStatus & STA_NOINIT) {
+        return RES_NOTRDY;
+    }
+
+    memcpy(buff, &image[sector * HOST_DISK_SECTOR_SIZE], ((size_t) count * HOST_DISK_SECTOR_SIZE));
+    diskStats.sectorsRead += count;
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count) {
+    ++diskStats.writeCalls;
+    if((pdrv != HOST_DISK_DRIVE) || !is_valid_range(sector, count)) {
+        return RES_PARERR;
+    }
+    if(driveStatus & STA_NOINIT) {
+        return RES_NOTRDY;
+    }
+
+    memcpy(&image[sector * HOST_DISK_SECTOR_SIZE], buff, ((size_t) count * HOST_DISK_SECTOR_SIZE));
+    diskStats.sectorsWritten += count;
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
+    ++diskStats.ioctlCalls;
+    if(pdrv != HOST_DISK_DRIVE) {
+        return RES_PARERR;
+    }
+    if(!image) {
+        return RES_NOTRDY;
+    }
+
+    switch(cmd) {
+        case CTRL_SYNC:
+            ++diskStats.syncCalls;
+            return (msync(image, imageSize, MS_SYNC) == 0) ? RES_OK : RES_ERROR;
+        case GET_SECTOR_COUNT:
+            *(LBA_t*) buff = (LBA_t) (imageSize / HOST_DISK_SECTOR_SIZE);
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD*) buff = HOST_DISK_SECTOR_SIZE;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *(DWORD*) buff = 1;         // Unknown erase block size
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
+
+// FatFs file timestamps, from the host clock rather than the Pico's RTC
+DWORD get_fattime() {
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    return ((DWORD) (local.tm_year - 80) << 25) | ((DWORD) (local.tm_mon + 1) << 21) | ((DWORD) local.tm_mday << 16) |
+        ((DWORD) local.tm_hour << 11) | ((DWORD) local.tm_min << 5) | ((DWORD) (local.tm_sec / 2));
+}
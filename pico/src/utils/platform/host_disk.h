@@ -0,0 +1,57 @@
+#ifndef _HOST_DISK_H_
+#define _HOST_DISK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host only. host_disk.c implements the FatFs diskio interface over a disk image file mapped with
+// mmap, so wallet_file.c can run against FAT images on a desktop. Link it in place of the
+// FatFs_SPI SD card driver, and build with PICO_NO_HARDWARE (the Pico SDK's host platform)
+
+#define HOST_DISK_SECTOR_SIZE       (512)
+
+
+typedef struct {
+    uint32_t statusCalls;           // disk_status
+    uint32_t initializeCalls;       // disk_initialize, one per mount
+    uint32_t readCalls;             // disk_read, each a single or multi-block transfer on a card
+    uint32_t writeCalls;
+    uint32_t ioctlCalls;
+    uint32_t syncCalls;             // CTRL_SYNC, at f_sync and f_close of written files
+    uint64_t sectorsRead;
+    uint64_t sectorsWritten;
+} HostDiskStats;
+
+
+/**
+ * Map a disk image as drive 0. The image is used in place, writes go straight to the file
+ *
+ * path                 in      Image file
+ * createSizeKb         in      If not 0, the image is created (or truncated) to this size, zero
+ *                              filled. It still needs formatting, see host_disk_format()
+ *
+ * Returns false if the file couldn't be opened or mapped, or isn't a whole number of sectors
+ */
+bool host_disk_open(const char* path, uint32_t createSizeKb);
+
+/**
+ * Flush and unmap the image
+ */
+void host_disk_close();
+
+/**
+ * Make a FAT volume filling the image, with no partition table
+ *
+ * Returns the FRESULT from f_mkfs
+ */
+int host_disk_format();
+
+// Sectors in the mapped image, 0 if there is none
+uint32_t host_disk_sectors();
+
+const HostDiskStats* host_disk_stats();
+
+void host_disk_reset_stats();
+
+
+#endif      // _HOST_DISK_H_
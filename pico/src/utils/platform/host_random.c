@@ -0,0 +1,30 @@
+#include "wallet_random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Host only. Implements wallet_random.h from the operating system's random source, as pico_rand is
+// not part of the Pico SDK's host platform. Link it in place of wallet_random.c
+
+static FILE* randomSource;
+
+
+void wallet_random_init() {
+    if(!randomSource) {
+        randomSource = fopen("/dev/urandom", "rb");
+    }
+}
+
+uint8_t get_random_byte() {
+    int byte;
+
+    wallet_random_init();
+
+    // Carrying on without a random source would hand out predictable keys and nonces
+    if(!randomSource || ((byte = fgetc(randomSource)) == EOF)) {
+        fprintf(stderr, "No random source available\n");
+        abort();
+    }
+
+    return (uint8_t) byte;
+}
@@ -0,0 +1,150 @@
+#include "key_input.h"
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+
+#define KEY_HOLD_REPEAT_SCANS           (KEY_HOLD_REPEAT_TIME_MS / KEY_SCAN_INTERVAL_MS)
+#define KEY_QUEUE_MASK                  (KEY_INPUT_QUEUE_SIZE - 1)
+
+static uint8_t keyPins[KEY_INPUT_MAX_KEYS];
+static uint8_t keyCount;
+
+// Debounce state, only touched from the scan alarm
+static bool keyDown[KEY_INPUT_MAX_KEYS];
+static uint8_t keyChangeScans[KEY_INPUT_MAX_KEYS];     // Consecutive scans that disagreed with keyDown
+static uint16_t keyHoldScans[KEY_INPUT_MAX_KEYS];      // Scans since the press, or the last hold repeat
+
+// Set while the scan alarm is scheduled. The GPIO and timer interrupts share a priority, so neither
+// can interrupt the other part way through starting or stopping the scan
+static volatile bool scanRunning;
+
+// Single producer (the scan alarm), single consumer (the main loop). Only the producer writes
+// queueHead and only the consumer writes queueTail, so no lock is needed
+static KeyEvent eventQueue[KEY_INPUT_QUEUE_SIZE];
+static volatile uint32_t queueHead;
+static volatile uint32_t queueTail;
+static volatile uint32_t droppedEvents;
+static volatile KeyEventCallback eventCallback;
+
+
+static void push_event(uint8_t key, KeyEventType type) {
+    uint32_t head = queueHead;
+    if((head - queueTail) >= KEY_INPUT_QUEUE_SIZE) {
+        ++droppedEvents;
+        return;
+    }
+
+    eventQueue[head & KEY_QUEUE_MASK] = (KeyEvent) { .key = key, .type = type };
+
+    // The event must be in place before the consumer can see it
+    __dmb();
+    queueHead = (head + 1);
+
+    KeyEventCallback callback = eventCallback;
+    if(callback) {
+        callback();
+    }
+}
+
+static int64_t scan_keys(alarm_id_t id, void* userData) {
+    bool settling = false;
+
+    for(int i = 0; i < keyCount; ++i) {
+        // Active low
+        bool down = !gpio_get(keyPins[i]);
+
+        if(down != keyDown[i]) {
+            if(++keyChangeScans[i] >= KEY_DEBOUNCE_SAMPLES) {
+                keyDown[i] = down;
+                keyChangeScans[i] = 0;
+                keyHoldScans[i] = 0;
+                push_event(i, (down ? KEY_EVENT_PRESSED : KEY_EVENT_RELEASED));
+            }
+        } else {
+            keyChangeScans[i] = 0;
+
+            if(down && (++keyHoldScans[i] >= KEY_HOLD_REPEAT_SCANS)) {
+                keyHoldScans[i] = 0;
+                push_event(i, KEY_EVENT_HELD);
+            }
+        }
+
+        settling |= (keyDown[i] || keyChangeScans[i]);
+    }
+
+    if(settling) {
+        // Relative to when this scan was due, so scans don't drift
+        return -((int64_t) KEY_SCAN_INTERVAL_MS * 1000);
+    }
+
+    // Everything released and stable, sleep until the next edge
+    scanRunning = false;
+    return 0;
+}
+
+static void start_scan() {
+    if(scanRunning) {
+        return;
+    }
+
+    scanRunning = true;
+    if(add_alarm_in_ms(KEY_SCAN_INTERVAL_MS, scan_keys, NULL, true) < 0) {
+        // No alarm slots free. The next edge will try again
+        scanRunning = false;
+    }
+}
+
+static void on_key_edge(uint gpio, uint32_t events) {
+    start_scan();
+}
+
+
+void key_input_init(const uint8_t* pins, uint8_t numKeys) {
+    keyCount = (numKeys > KEY_INPUT_MAX_KEYS) ? KEY_INPUT_MAX_KEYS : numKeys;
+
+    for(int i = 0; i < keyCount; ++i) {
+        keyPins[i] = pins[i];
+        keyDown[i] = false;
+        keyChangeScans[i] = 0;
+        keyHoldScans[i] = 0;
+
+        gpio_init(keyPins[i]);
+        gpio_pull_up(keyPins[i]);
+        gpio_set_dir(keyPins[i], GPIO_IN);
+        gpio_set_irq_enabled_with_callback(keyPins[i], (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE), true, on_key_edge);
+    }
+
+    // Pick up any key that is already held down. Interrupts are masked so an edge can't start a
+    // second scan part way through
+    uint32_t interrupts = save_and_disable_interrupts();
+    start_scan();
+    restore_interrupts(interrupts);
+}
+
+bool key_input_get_event(KeyEvent* event) {
+    uint32_t tail = queueTail;
+    if(tail == queueHead) {
+        return false;
+    }
+
+    // Read the event only after seeing it published, and release the slot only once it has been read
+    __dmb();
+    *event = eventQueue[tail & KEY_QUEUE_MASK];
+    __dmb();
+    queueTail = (tail + 1);
+
+    return true;
+}
+
+void key_input_set_event_callback(KeyEventCallback callback) {
+    eventCallback = callback;
+}
+
+bool key_input_has_events() {
+    return (queueTail != queueHead);
+}
+
+uint32_t key_input_dropped_events() {
+    return droppedEvents;
+}
@@ -0,0 +1,59 @@
+#ifndef _KEY_INPUT_H_
+#define _KEY_INPUT_H_
+
+#include "pico/stdlib.h"
+
+
+#define KEY_INPUT_MAX_KEYS              (8)
+#define KEY_INPUT_QUEUE_SIZE            (16)        // Events, must be a power of 2
+#define KEY_SCAN_INTERVAL_MS            (5)
+#define KEY_DEBOUNCE_SAMPLES            (2)         // Consecutive matching scans before a change is accepted
+#define KEY_HOLD_REPEAT_TIME_MS         (250)
+
+typedef enum {
+    KEY_EVENT_PRESSED,
+    KEY_EVENT_RELEASED,
+    KEY_EVENT_HELD                  // Repeats every KEY_HOLD_REPEAT_TIME_MS while the key stays down
+} KeyEventType;
+
+typedef struct {
+    uint8_t key;                    // Index into the pins passed to key_input_init()
+    uint8_t type;                   // KeyEventType
+} KeyEvent;
+
+// Called from interrupt context each time an event is queued
+typedef void (*KeyEventCallback)();
+
+
+/**
+ * Set up active low (pulled up) keys. Edges on any of the pins wake a scan alarm, which debounces
+ * the keys and generates hold repeats, and stops itself again once every key is released
+ *
+ * pins                 in      GPIO of each key
+ * numKeys              in      Number of keys, up to KEY_INPUT_MAX_KEYS
+ */
+void key_input_init(const uint8_t* pins, uint8_t numKeys);
+
+/**
+ * Take the oldest pending key event, if there is one. Events are queued from interrupt context
+ * and must only be taken by one consumer
+ *
+ * event                out     The event
+ *
+ * Returns false if there were no events
+ */
+bool key_input_get_event(KeyEvent* event);
+
+/**
+ * Set a function to be told about new events, e.g. to wake whatever takes them. NULL for none
+ */
+void key_input_set_event_callback(KeyEventCallback callback);
+
+// True if there are events waiting to be taken
+bool key_input_has_events();
+
+// Events lost because the queue was full
+uint32_t key_input_dropped_events();
+
+
+#endif      // _KEY_INPUT_H_
@@ -0,0 +1,201 @@
+#include "task_scheduler.h"
+
+#include "hardware/sync.h"
+
+#include <stdio.h>
+
+typedef struct {
+    TaskFunction function;          // NULL for an unused slot
+    void* context;
+    volatile bool ready;
+    bool timerSet;
+    absolute_time_t wakeTime;
+
+    TaskStats stats;
+} SchedulerTask;
+
+static SchedulerTask tasks[SCHEDULER_MAX_TASKS];
+
+// Start of the step currently running, for scheduler_slice_expired()
+static uint64_t stepStartUs;
+
+
+static bool is_valid_task(int taskId) {
+    return (taskId >= 0) && (taskId < SCHEDULER_MAX_TASKS) && tasks[taskId].function;
+}
+
+static bool is_any_task_ready() {
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(tasks[i].function && tasks[i].ready) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Finds the earliest pending timer, returns false if there are none
+static bool get_next_wake_time(absolute_time_t* wakeTime) {
+    bool found = false;
+
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(tasks[i].function && tasks[i].timerSet) {
+            if(!found || (absolute_time_diff_us(tasks[i].wakeTime, *wakeTime) > 0)) {
+                *wakeTime = tasks[i].wakeTime;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+static void wake_due_timers() {
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(tasks[i].function && tasks[i].timerSet && time_reached(tasks[i].wakeTime)) {
+            tasks[i].timerSet = false;
+            tasks[i].ready = true;
+        }
+    }
+}
+
+static void run_task(int taskId) {
+    SchedulerTask* task = &tasks[taskId];
+
+    // Cleared before the step, so a wake that arrives while it runs isn't lost
+    task->ready = false;
+
+    stepStartUs = time_us_64();
+    TaskResult result = task->function(taskId, task->context);
+    uint32_t runTime = (uint32_t) (time_us_64() - stepStartUs);
+
+    ++task->stats.runs;
+    task->stats.totalRunTimeUs += runTime;
+    if(runTime > task->stats.maxRunTimeUs) {
+        task->stats.maxRunTimeUs = runTime;
+    }
+
+    switch(result) {
+        case TASK_WAIT:
+            break;
+        case TASK_YIELD:
+            task->ready = true;
+            break;
+        case TASK_DONE:
+            task->function = NULL;
+            break;
+    }
+}
+
+// Only there to raise an interrupt, which ends the __wfi()
+static int64_t on_wake_alarm(alarm_id_t id, void* userData) {
+    return 0;
+}
+
+
+int scheduler_add_task(const char* name, TaskFunction function, void* context) {
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(!tasks[i].function) {
+            tasks[i] = (SchedulerTask) {
+                .context = context,
+                .stats = { .name = name }
+            };
+
+            // Publish the slot only once it is set up
+            __dmb();
+            tasks[i].function = function;
+            tasks[i].ready = true;
+            return i;
+        }
+    }
+
+    return SCHEDULER_INVALID_TASK;
+}
+
+void scheduler_wake_task(int taskId) {
+    if(is_valid_task(taskId)) {
+        tasks[taskId].ready = true;
+    }
+}
+
+void scheduler_set_timer(int taskId, uint32_t delayMs) {
+    if(is_valid_task(taskId)) {
+        tasks[taskId].wakeTime = make_timeout_time_ms(delayMs);
+        tasks[taskId].timerSet = true;
+    }
+}
+
+void scheduler_cancel_timer(int taskId) {
+    if(is_valid_task(taskId)) {
+        tasks[taskId].timerSet = false;
+    }
+}
+
+bool scheduler_slice_expired() {
+    return (time_us_64() - stepStartUs) >= SCHEDULER_SLICE_US;
+}
+
+bool scheduler_run_ready_tasks() {
+    bool ranTask = false;
+
+    wake_due_timers();
+
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(tasks[i].function && tasks[i].ready) {
+            run_task(i);
+            ranTask = true;
+        }
+    }
+
+    return ranTask;
+}
+
+void scheduler_wait_for_work() {
+    absolute_time_t wakeTime;
+    bool hasTimer = get_next_wake_time(&wakeTime);
+    if(hasTimer && time_reached(wakeTime)) {
+        return;
+    }
+
+    // Without a timer interrupt due, only a wake from some other interrupt would end the sleep
+    alarm_id_t alarm = 0;
+    if(hasTimer) {
+        alarm = add_alarm_at(wakeTime, on_wake_alarm, NULL, false);
+        if(alarm <= 0) {
+            // Already due, or no alarm slots free, so don't risk sleeping past it
+            return;
+        }
+    }
+
+    // With interrupts masked, one that arrives after the check still ends the __wfi() (it is taken
+    // once they are restored) rather than being missed until the next one
+    uint32_t interrupts = save_and_disable_interrupts();
+    if(!is_any_task_ready()) {
+        __wfi();
+    }
+    restore_interrupts(interrupts);
+
+    if(alarm > 0) {
+        cancel_alarm(alarm);
+    }
+}
+
+const TaskStats* scheduler_get_task_stats(int taskId) {
+    return is_valid_task(taskId) ? &tasks[taskId].stats : NULL;
+}
+
+void scheduler_print_stats() {
+    printf("%-12s %8s %12s %8s %8s\n", "Task", "Runs", "Total us", "Avg us", "Max us");
+
+    for(int i = 0; i < SCHEDULER_MAX_TASKS; ++i) {
+        if(!tasks[i].function) {
+            continue;
+        }
+
+        const TaskStats* stats = &tasks[i].stats;
+        uint32_t averageTime = stats->runs ? (uint32_t) (stats->totalRunTimeUs / stats->runs) : 0;
+        printf("%-12s %8lu %12llu %8lu %8lu\n", stats->name, (unsigned long) stats->runs,
+            (unsigned long long) stats->totalRunTimeUs, (unsigned long) averageTime,
+            (unsigned long) stats->maxRunTimeUs);
+    }
+}
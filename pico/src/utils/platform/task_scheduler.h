@@ -0,0 +1,89 @@
+#ifndef _TASK_SCHEDULER_H_
+#define _TASK_SCHEDULER_H_
+
+#include "pico/stdlib.h"
+
+// Runs core0's work (input, the app state machines and the display) as tasks. PBKDF2, seed
+// generation and address generation run on core1 through crypto_worker.h instead, so they are never
+// sliced here. Key events reach the input task through key_input's own interrupt-fed queue, and
+// timers are per task, so there is no separate event queue
+
+
+#define SCHEDULER_MAX_TASKS             (8)
+#define SCHEDULER_SLICE_US              (5000)      // Run time after which long jobs should yield
+#define SCHEDULER_INVALID_TASK          (-1)
+
+typedef enum {
+    TASK_WAIT,                      // Nothing to do until woken, by a timer or scheduler_wake_task()
+    TASK_YIELD,                     // More to do, run again once the other ready tasks have had a turn
+    TASK_DONE                       // Finished, remove the task
+} TaskResult;
+
+/**
+ * A task step. Steps run to completion, so a long job does a slice of its work (until
+ * scheduler_slice_expired()) per step, keeping its progress in context, and returns TASK_YIELD
+ *
+ * taskId               in      The running task, for its timer
+ * context              in/out  Task state, as passed to scheduler_add_task()
+ */
+typedef TaskResult (*TaskFunction)(int taskId, void* context);
+
+typedef struct {
+    const char* name;
+    uint32_t runs;                  // Steps run so far
+    uint64_t totalRunTimeUs;
+    uint32_t maxRunTimeUs;          // Longest single step, the worst case input latency it caused
+} TaskStats;
+
+
+/**
+ * Add a task. It is ready, so runs on the next scheduler pass
+ *
+ * name                 in      Label for the stats, must stay valid while the task exists
+ * function             in      Step function
+ * context              in      Passed to each step
+ *
+ * Returns the task's id, or SCHEDULER_INVALID_TASK if the task table is full
+ */
+int scheduler_add_task(const char* name, TaskFunction function, void* context);
+
+/**
+ * Make a task ready, so it runs on the next scheduler pass. Safe to call from interrupt context
+ */
+void scheduler_wake_task(int taskId);
+
+/**
+ * Wake a task once a delay has passed, replacing any timer it already has. A task that wants to run
+ * periodically sets its timer again from each step
+ *
+ * taskId               in      Task to wake
+ * delayMs              in      Delay from now
+ */
+void scheduler_set_timer(int taskId, uint32_t delayMs);
+
+void scheduler_cancel_timer(int taskId);
+
+// True once the running step has used SCHEDULER_SLICE_US, time for a long job to return TASK_YIELD
+bool scheduler_slice_expired();
+
+/**
+ * Run one step of every ready task, in the order they were added
+ *
+ * Returns true if any task ran
+ */
+bool scheduler_run_ready_tasks();
+
+/**
+ * Sleep until there is something for scheduler_run_ready_tasks() to do: a task woken from an
+ * interrupt, or the earliest timer coming due. Returns immediately if a task is already ready
+ */
+void scheduler_wait_for_work();
+
+// NULL for an unused task id
+const TaskStats* scheduler_get_task_stats(int taskId);
+
+// Print the run time of each task over stdio
+void scheduler_print_stats();
+
+
+#endif      // _TASK_SCHEDULER_H_
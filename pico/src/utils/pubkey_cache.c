@@ -0,0 +1,308 @@
+#include "pubkey_cache.h"
+#include "wallet_file.h"
+#include "secure_zero.h"
+#include "platform/wallet_random.h"
+
+#include "cryptography/cifra/chacha20poly1305.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+//
+//      Cache file format
+//
+//  +-------------------------------+
+//  | Magic                         |   "PKC1"
+//  | 4 bytes                       |
+//  +-------------------------------+
+//  | Slot count                    |   PUBKEY_CACHE_SLOTS
+//  | 2 bytes                       |
+//  +-------------------------------+
+//  | Salt                          |   Random per file, every record is bound to it
+//  | 16 bytes                      |
+//  +-------------------------------+
+//  | Nonce, Tag                    |   ChaCha20-Poly1305 over the fields above, with nothing
+//  | 12 + 16 bytes                 |   encrypted. Checks the key before any record is trusted
+//  +-------------------------------+
+//  | Zero padding to 128 bytes     |
+//  +-------------------------------+
+//  | Records                       |   PUBKEY_CACHE_SLOTS of them, see below
+//  | 128 bytes each                |
+//  +-------------------------------+
+//
+//      Record format
+//
+//  +-------------------------------+
+//  | Nonce                         |   Random per write
+//  | 12 bytes                      |
+//  +-------------------------------+
+//  | Tag                           |   Also covers the salt and the slot number, so records
+//  | 16 bytes                      |   can't be moved between slots or files
+//  +-------------------------------+
+//  | Encrypted entry               |   Path depth (1), path (16), depth (1), index (4),
+//  | 100 bytes                     |   fingerprint (4), parent fingerprint (4), chain code (32),
+//  |                               |   public key (33), zero padding (5)
+//  +-------------------------------+
+//
+//
+#define CACHE_MAGIC             "PKC1"
+#define MAGIC_LENGTH            (4)
+#define SALT_LENGTH             (16)
+#define NONCE_LENGTH            (12)
+#define TAG_LENGTH              (16)
+#define HEADER_AAD_LENGTH       (MAGIC_LENGTH + sizeof(uint16_t) + SALT_LENGTH)
+#define RECORD_AAD_LENGTH       (SALT_LENGTH + sizeof(uint32_t))
+#define ENTRY_LENGTH            (PUBKEY_CACHE_RECORD_SIZE - NONCE_LENGTH - TAG_LENGTH)
+
+#define FNV_OFFSET_BASIS        (2166136261u)
+#define FNV_PRIME               (16777619u)
+
+
+static uint8_t cacheKey[PUBKEY_CACHE_KEY_LENGTH];
+static uint8_t cacheSalt[SALT_LENGTH];
+static bool cacheOpen;
+static PubkeyCacheStats cacheStats;
+
+// Work variables
+static uint8_t recordBuffer[PUBKEY_CACHE_RECORD_SIZE];
+static uint8_t entryBuffer[ENTRY_LENGTH];
+
+
+static void fill_random(uint8_t* dest, size_t len) {
+    for(size_t i = 0; i < len; ++i) {
+        dest[i] = get_random_byte();
+    }
+}
+
+static uint32_t slot_for_path(const uint32_t* path, uint8_t pathDepth) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    const uint8_t* bytes = (const uint8_t*) path;
+
+    hash = (hash ^ pathDepth) * FNV_PRIME;
+    for(int i = 0; i < (pathDepth * sizeof(uint32_t)); ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return (hash % PUBKEY_CACHE_SLOTS);
+}
+
+static uint32_t slot_offset(uint32_t slot) {
+    // The header takes the first record's worth of the file
+    return (slot + 1) * PUBKEY_CACHE_RECORD_SIZE;
+}
+
+static void make_header_aad(uint8_t* dest) {
+    uint16_t slotCount = PUBKEY_CACHE_SLOTS;
+
+    memcpy(dest, CACHE_MAGIC, MAGIC_LENGTH);
+    memcpy(&dest[MAGIC_LENGTH], &slotCount, sizeof(slotCount));
+    memcpy(&dest[MAGIC_LENGTH + sizeof(slotCount)], cacheSalt, SALT_LENGTH);
+}
+
+static void make_record_aad(uint8_t* dest, uint32_t slot) {
+    memcpy(dest, cacheSalt, SALT_LENGTH);
+    memcpy(&dest[SALT_LENGTH], &slot, sizeof(slot));
+}
+
+static void serialize_entry(const uint32_t* path, uint8_t pathDepth, const ExtendedKey* key, uint8_t* dest) {
+    uint8_t* writePtr = dest;
+
+    memset(dest, 0, ENTRY_LENGTH);
+
+    *writePtr++ = pathDepth;
+    memcpy(writePtr, path, (pathDepth * sizeof(uint32_t)));
+    writePtr += (PUBKEY_CACHE_MAX_PATH_DEPTH * sizeof(uint32_t));
+
+    *writePtr++ = key->depth;
+    memcpy(writePtr, &key->index, sizeof(key->index));
+    writePtr += sizeof(key->index);
+
+    memcpy(writePtr, key->fingerprint, FINGERPRINT_LENGTH);
+    writePtr += FINGERPRINT_LENGTH;
+    memcpy(writePtr, key->parentFingerprint, FINGERPRINT_LENGTH);
+    writePtr += FINGERPRINT_LENGTH;
+
+    memcpy(writePtr, key->chainCode, CHAIN_CODE_LENGTH);
+    writePtr += CHAIN_CODE_LENGTH;
+    memcpy(writePtr, key->publicKey, PUBLIC_KEY_LENGTH);
+}
+
+// Returns false if the entry is for some other path
+static bool deserialize_entry(const uint8_t* src, const uint32_t* path, uint8_t pathDepth, ExtendedKey* dest) {
+    const uint8_t* readPtr = src;
+
+    if((*readPtr++ != pathDepth) || memcmp(readPtr, path, (pathDepth * sizeof(uint32_t)))) {
+        return false;
+    }
+    readPtr += (PUBKEY_CACHE_MAX_PATH_DEPTH * sizeof(uint32_t));
+
+    memset(dest, 0, sizeof(ExtendedKey));
+
+    dest->depth = *readPtr++;
+    memcpy(&dest->index, readPtr, sizeof(dest->index));
+    readPtr += sizeof(dest->index);
+
+    memcpy(dest->fingerprint, readPtr, FINGERPRINT_LENGTH);
+    readPtr += FINGERPRINT_LENGTH;
+    memcpy(dest->parentFingerprint, readPtr, FINGERPRINT_LENGTH);
+    readPtr += FINGERPRINT_LENGTH;
+
+    memcpy(dest->chainCode, readPtr, CHAIN_CODE_LENGTH);
+    readPtr += CHAIN_CODE_LENGTH;
+    memcpy(dest->publicKey, readPtr, PUBLIC_KEY_LENGTH);
+
+    return true;
+}
+
+// Returns false if the header is malformed or wasn't written with cacheKey
+static bool check_header(const uint8_t* header) {
+    uint8_t expected[HEADER_AAD_LENGTH];
+
+    memcpy(cacheSalt, &header[MAGIC_LENGTH + sizeof(uint16_t)], SALT_LENGTH);
+    make_header_aad(expected);
+    if(memcmp(header, expected, HEADER_AAD_LENGTH)) {
+        return false;
+    }
+
+    return cf_chacha20poly1305_decrypt(
+        cacheKey, &header[HEADER_AAD_LENGTH],
+        header, HEADER_AAD_LENGTH,
+        entryBuffer, 0,
+        &header[HEADER_AAD_LENGTH + NONCE_LENGTH],
+        entryBuffer
+    ) == 0;
+}
+
+// A new salt leaves every record already in the file unreadable, so there is nothing to erase
+static wallet_error write_new_header() {
+    memset(recordBuffer, 0, PUBKEY_CACHE_RECORD_SIZE);
+
+    fill_random(cacheSalt, SALT_LENGTH);
+    make_header_aad(recordBuffer);
+    fill_random(&recordBuffer[HEADER_AAD_LENGTH], NONCE_LENGTH);
+
+    cf_chacha20poly1305_encrypt(
+        cacheKey, &recordBuffer[HEADER_AAD_LENGTH],
+        recordBuffer, HEADER_AAD_LENGTH,
+        entryBuffer, 0,
+        entryBuffer,
+        &recordBuffer[HEADER_AAD_LENGTH + NONCE_LENGTH]
+    );
+
+    return write_wallet_file_at(PUBKEY_CACHE_FILE, 0, recordBuffer, PUBKEY_CACHE_RECORD_SIZE);
+}
+
+
+wallet_error pubkey_cache_open(const uint8_t* key) {
+    pubkey_cache_close();
+    memcpy(cacheKey, key, PUBKEY_CACHE_KEY_LENGTH);
+
+    wallet_error err = read_wallet_file_at(PUBKEY_CACHE_FILE, 0, recordBuffer, PUBKEY_CACHE_RECORD_SIZE);
+    if((err == NO_ERROR) && check_header(recordBuffer)) {
+        cacheOpen = true;
+        return NO_ERROR;
+    }
+
+    // Missing, short or written with another key are all reasons to start again, anything else
+    // is the card's problem
+    if(
+        (err != NO_ERROR) &&
+        (GET_WF_RESULT(err) != WF_FILE_NOT_FOUND) &&
+        (GET_WF_RESULT(err) != WF_WALLET_FILE_CORRUPTED)
+    ) {
+        ++cacheStats.diskErrors;
+        secure_zero(cacheKey, PUBKEY_CACHE_KEY_LENGTH);
+        return err;
+    }
+
+    err = write_new_header();
+    if(err != NO_ERROR) {
+        printf("Public key cache reset failed: 0x%04X\n", err);
+        ++cacheStats.diskErrors;
+        secure_zero(cacheKey, PUBKEY_CACHE_KEY_LENGTH);
+        return err;
+    }
+
+    ++cacheStats.resets;
+    cacheOpen = true;
+    return NO_ERROR;
+}
+
+void pubkey_cache_close() {
+    secure_zero(cacheKey, PUBKEY_CACHE_KEY_LENGTH);
+    cacheOpen = false;
+}
+
+bool pubkey_cache_get(const uint32_t* path, uint8_t pathDepth, ExtendedKey* dest) {
+    uint8_t aad[RECORD_AAD_LENGTH];
+
+    if(!cacheOpen || (pathDepth > PUBKEY_CACHE_MAX_PATH_DEPTH)) {
+        return false;
+    }
+
+    uint32_t slot = slot_for_path(path, pathDepth);
+    wallet_error err = read_wallet_file_at(PUBKEY_CACHE_FILE, slot_offset(slot), recordBuffer, PUBKEY_CACHE_RECORD_SIZE);
+    if(err != NO_ERROR) {
+        // Short means the file hasn't grown as far as this slot yet
+        if(GET_WF_RESULT(err) == WF_WALLET_FILE_CORRUPTED) {
+            ++cacheStats.misses;
+        } else {
+            ++cacheStats.diskErrors;
+        }
+        return false;
+    }
+
+    make_record_aad(aad, slot);
+    if(cf_chacha20poly1305_decrypt(
+        cacheKey, recordBuffer,
+        aad, RECORD_AAD_LENGTH,
+        &recordBuffer[NONCE_LENGTH + TAG_LENGTH], ENTRY_LENGTH,
+        &recordBuffer[NONCE_LENGTH],
+        entryBuffer
+    )) {
+        // Includes slots that were never written, but lie inside the file
+        ++cacheStats.rejected;
+        return false;
+    }
+
+    if(!deserialize_entry(entryBuffer, path, pathDepth, dest)) {
+        ++cacheStats.misses;
+        return false;
+    }
+
+    ++cacheStats.hits;
+    return true;
+}
+
+void pubkey_cache_put(const uint32_t* path, uint8_t pathDepth, const ExtendedKey* key) {
+    uint8_t aad[RECORD_AAD_LENGTH];
+
+    if(!cacheOpen || (pathDepth > PUBKEY_CACHE_MAX_PATH_DEPTH)) {
+        return;
+    }
+
+    uint32_t slot = slot_for_path(path, pathDepth);
+    serialize_entry(path, pathDepth, key, entryBuffer);
+
+    fill_random(recordBuffer, NONCE_LENGTH);
+    make_record_aad(aad, slot);
+    cf_chacha20poly1305_encrypt(
+        cacheKey, recordBuffer,
+        aad, RECORD_AAD_LENGTH,
+        entryBuffer, ENTRY_LENGTH,
+        &recordBuffer[NONCE_LENGTH + TAG_LENGTH],
+        &recordBuffer[NONCE_LENGTH]
+    );
+
+    wallet_error err = write_wallet_file_at(PUBKEY_CACHE_FILE, slot_offset(slot), recordBuffer, PUBKEY_CACHE_RECORD_SIZE);
+    if(err != NO_ERROR) {
+        ++cacheStats.diskErrors;
+    } else {
+        ++cacheStats.stores;
+    }
+}
+
+const PubkeyCacheStats* get_pubkey_cache_stats() {
+    return &cacheStats;
+}
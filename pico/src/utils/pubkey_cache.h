@@ -0,0 +1,65 @@
+#ifndef _PUBKEY_CACHE_H_
+#define _PUBKEY_CACHE_H_
+
+#include "wallet_defs.h"
+#include "key_utils.h"
+
+
+#define PUBKEY_CACHE_FILE                   "pubkeys.dat"
+#define PUBKEY_CACHE_KEY_LENGTH             (32)
+#define PUBKEY_CACHE_MAX_PATH_DEPTH         (4)
+#define PUBKEY_CACHE_SLOTS                  (256)           // Direct mapped, a node always lives in the slot its path hashes to
+#define PUBKEY_CACHE_RECORD_SIZE            (128)           // Header and records alike, so no record straddles a sector
+
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;                // Empty slot, or holding another path
+    uint32_t rejected;              // Records that failed authentication (corrupt, or from another key)
+    uint32_t stores;
+    uint32_t resets;                // File (re)created because it was missing, or belonged to another key
+    uint32_t diskErrors;
+} PubkeyCacheStats;
+
+
+/**
+ * Start using the cache file for a wallet. The file is checked against the key, and started afresh
+ * if it is missing or was written with a different key, i.e. another wallet or password
+ *
+ * cacheKey         in      PUBKEY_CACHE_KEY_LENGTH byte key, from the wallet's password hash
+ *
+ * On an error the cache is left closed and lookups simply miss
+ */
+wallet_error pubkey_cache_open(const uint8_t* cacheKey);
+
+/**
+ * Forget (and zeroise) the key. Lookups miss until the cache is opened again
+ */
+void pubkey_cache_close();
+
+/**
+ * Fetch the public half of a derived key. Only the record for the path is read from the card
+ *
+ * path             in      Child indices below the BIP44 base key, hardened offsets applied
+ * pathDepth        in      Number of entries in path (at most PUBKEY_CACHE_MAX_PATH_DEPTH)
+ * dest             out     Public key, chain code, fingerprints, depth and index. The private key
+ *                          is zeroed, so dest can only be used for public key operations
+ *
+ * Returns true on a hit. dest is untouched on a miss
+ */
+bool pubkey_cache_get(const uint32_t* path, uint8_t pathDepth, ExtendedKey* dest);
+
+/**
+ * Store the public half of a derived key, replacing whatever was in its slot. The private key is
+ * never written
+ *
+ * path             in      As pubkey_cache_get()
+ * pathDepth        in      As pubkey_cache_get()
+ * key              in      The key at path
+ */
+void pubkey_cache_put(const uint32_t* path, uint8_t pathDepth, const ExtendedKey* key);
+
+const PubkeyCacheStats* get_pubkey_cache_stats();
+
+
+#endif      // _PUBKEY_CACHE_H_
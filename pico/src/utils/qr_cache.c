@@ -0,0 +1,106 @@
+#include "qr_cache.h"
+#include "secure_zero.h"
+
+#include <string.h>
+
+
+typedef struct {
+    QRCacheKey key;
+    uint32_t lastUsed;                          // 0 if the slot is empty
+    uint8_t qrcode[QR_CODE_BYTES];
+} QRCacheEntry;
+
+#define QR_CACHE_NUM_ENTRIES                (QR_CACHE_RAM_BUDGET / sizeof(QRCacheEntry))
+
+
+static QRCacheEntry qrCache[QR_CACHE_NUM_ENTRIES];
+static uint32_t qrCacheUseCounter;
+
+
+static void evict_entry(QRCacheEntry* entry) {
+    if(entry->key.keyType == QR_KEY_TYPE_WIF) {
+        secure_zero(entry, sizeof(QRCacheEntry));
+    } else {
+        entry->lastUsed = 0;
+    }
+}
+
+static bool keys_equal(const QRCacheKey* a, const QRCacheKey* b) {
+    if(
+        (a->pathDepth != b->pathDepth) ||
+        (a->keyType != b->keyType) ||
+        (a->network != b->network)
+    ) {
+        return false;
+    }
+
+    return (memcmp(a->path, b->path, (a->pathDepth * sizeof(uint32_t))) == 0);
+}
+
+static QRCacheEntry* find_entry(const QRCacheKey* cacheKey) {
+    for(int i = 0; i < QR_CACHE_NUM_ENTRIES; ++i) {
+        if(qrCache[i].lastUsed && keys_equal(&qrCache[i].key, cacheKey)) {
+            return &qrCache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static QRCacheEntry* get_free_entry() {
+    QRCacheEntry* oldest = &qrCache[0];
+
+    for(int i = 0; i < QR_CACHE_NUM_ENTRIES; ++i) {
+        if(!qrCache[i].lastUsed) {
+            return &qrCache[i];
+        }
+
+        if(qrCache[i].lastUsed < oldest->lastUsed) {
+            oldest = &qrCache[i];
+        }
+    }
+
+    evict_entry(oldest);
+    return oldest;
+}
+
+
+void qr_cache_make_key(QRCacheKey* dest, const uint32_t* path, uint8_t pathDepth, QRKeyType keyType, BTCNetwork network) {
+    if(pathDepth > QR_CACHE_MAX_PATH_DEPTH) {
+        pathDepth = QR_CACHE_MAX_PATH_DEPTH;
+    }
+
+    memset(dest, 0, sizeof(QRCacheKey));
+    memcpy(dest->path, path, (pathDepth * sizeof(uint32_t)));
+    dest->pathDepth = pathDepth;
+    dest->keyType = keyType;
+    dest->network = network;
+}
+
+bool qr_cache_contains(const QRCacheKey* cacheKey) {
+    return (find_entry(cacheKey) != NULL);
+}
+
+void get_cached_key_qr(const QRCacheKey* cacheKey, const ExtendedKey* key, uint8_t* qrcode) {
+    QRCacheEntry* entry = find_entry(cacheKey);
+
+    if(!entry) {
+        entry = get_free_entry();
+
+        if(cacheKey->keyType == QR_KEY_TYPE_WIF) {
+            get_private_key_wif_qr(key, cacheKey->network, entry->qrcode);
+        } else {
+            get_p2pkh_qr(key, entry->qrcode);
+        }
+        memcpy(&entry->key, cacheKey, sizeof(QRCacheKey));
+    }
+
+    // Counter wrap would take ~4 billion QR lookups, so it is not worth handling
+    entry->lastUsed = ++qrCacheUseCounter;
+    memcpy(qrcode, entry->qrcode, QR_CODE_BYTES);
+}
+
+void qr_cache_clear() {
+    secure_zero(qrCache, sizeof(qrCache));
+    qrCacheUseCounter = 0;
+}
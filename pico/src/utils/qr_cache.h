@@ -0,0 +1,58 @@
+#ifndef _QR_CACHE_H_
+#define _QR_CACHE_H_
+
+#include "key_utils.h"
+
+
+#define QR_CACHE_MAX_PATH_DEPTH             (4)
+#define QR_CACHE_RAM_BUDGET                 (1024)          // Bytes of RAM set aside for cached QR bitmaps
+
+
+typedef enum {
+    QR_KEY_TYPE_P2PKH       = 0,
+    QR_KEY_TYPE_WIF         = 1
+} QRKeyType;
+
+// Identifies a rendered QR code. The path is relative to the wallet's BIP44 base key (m/44')
+// and holds raw child indices, with the hardened offset already applied where relevant.
+typedef struct {
+    uint32_t path[QR_CACHE_MAX_PATH_DEPTH];
+    uint8_t pathDepth;
+    uint8_t keyType;
+    uint8_t network;
+} QRCacheKey;
+
+
+/**
+ * Build a cache key for the supplied derivation path
+ *
+ * dest             out     The cache key to be configured
+ * path             in      Child indices below the BIP44 base key, hardened offsets applied
+ * pathDepth        in      Number of entries in path (at most QR_CACHE_MAX_PATH_DEPTH)
+ * keyType          in      Which QR code (public address or private WIF) the key refers to
+ * network          in      Network the QR code was generated for
+ */
+void qr_cache_make_key(QRCacheKey* dest, const uint32_t* path, uint8_t pathDepth, QRKeyType keyType, BTCNetwork network);
+
+/**
+ * Returns true if a rendered QR bitmap for the supplied key is held in the cache
+ */
+bool qr_cache_contains(const QRCacheKey* cacheKey);
+
+/**
+ * Fetch the QR bitmap (QR_CODE_BYTES long) for the supplied key. If it is not cached it is
+ * generated from the extended key and stored, evicting the least recently used entry if needed.
+ *
+ * cacheKey         in      Identifies the QR code being requested
+ * key              in      The extended key at the cache key's path. Only used on a cache miss
+ * qrcode           out     Storage for the QR bitmap
+ */
+void get_cached_key_qr(const QRCacheKey* cacheKey, const ExtendedKey* key, uint8_t* qrcode);
+
+/**
+ * Drop (and zeroise) every cached entry
+ */
+void qr_cache_clear();
+
+
+#endif      // _QR_CACHE_H_
@@ -0,0 +1,13 @@
+#include "secure_zero.h"
+
+#include <stdint.h>
+
+
+// The compiler is free to drop a memset on memory it thinks is dead, so wipe through a volatile
+// pointer to make sure the secret really goes away
+void secure_zero(void* data, size_t len) {
+    volatile uint8_t* p = (volatile uint8_t*) data;
+    while(len--) {
+        *p++ = 0;
+    }
+}
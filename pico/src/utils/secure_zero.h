@@ -0,0 +1,17 @@
+#ifndef _SECURE_ZERO_H_
+#define _SECURE_ZERO_H_
+
+#include <stddef.h>
+
+
+/**
+ * Zero memory holding secrets (keys, seed words, rendered private keys). Unlike memset() this is
+ * never dropped as a dead store, so it is safe on buffers that aren't read again
+ *
+ * data             out     The memory to wipe
+ * len              in      Its length in bytes
+ */
+void secure_zero(void* data, size_t len);
+
+
+#endif      // _SECURE_ZERO_H_
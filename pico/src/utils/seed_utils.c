@@ -4,7 +4,6 @@
 #include "platform/wallet_random.h"
 #include "big_int/big_int.h"
 #include "key_print_utils.h"
-#include "cryptography/cifra/pbkdf2.h"
 #include "cryptography/cifra/sha2.h"
 
 #include <string.h>
@@ -35,6 +34,8 @@ extern const char* BIP39_WORD_LIST[];
 uint8_t _bipSentenceBuffer[SENTENCE_LENGTH_CHARS];
 uint8_t _mnemonicPassphraseBuffer[MNEMONIC_PREFIX_LENGTH + MAX_MNEMONIC_PASSPHRASE_LENGTH];
 
+static SeedProgressFunction seedProgressFunction;
+
 
 int16_t get_bip39_word_idx(const char* word) {
     // Stupidly inefficient. I will fix this later
@@ -142,7 +143,8 @@ int validate_mnemonic(char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH +
     return (checksum[0] == encoded[32]);
 }
 
-int mnemonic_to_seed(
+void begin_mnemonic_to_seed(
+    Pbkdf2State* state,
     const char** mnemonic, int numWords,
     const char* passphrase, int passphraseLen,
     uint8_t* seed
@@ -158,18 +160,44 @@ int mnemonic_to_seed(
     }
     --sentenceLen;
 
-    // Hash mnemonic (+ passphrase) to get seed
-    cf_pbkdf2_hmac(
+    // Hash mnemonic (+ passphrase) to get seed. The sentence is consumed by the init, so the buffer
+    // is free for reuse straight away
+    pbkdf2_init(
+        state, &cf_sha512,
         _bipSentenceBuffer, sentenceLen, 
         passphrase, passphraseLen, 
         2048, 
-        seed, EXTENDED_MASTER_KEY_LENGTH,
-        &cf_sha512
+        seed, EXTENDED_MASTER_KEY_LENGTH
     );
+    memset(_bipSentenceBuffer, 0, SENTENCE_LENGTH_CHARS);
+}
+
+int mnemonic_to_seed(
+    const char** mnemonic, int numWords,
+    const char* passphrase, int passphraseLen,
+    uint8_t* seed
+) {
+    Pbkdf2State state;
+
+    // The slowest part of creating or recovering a wallet, so it is run in chunks with a progress
+    // report after each
+    begin_mnemonic_to_seed(&state, mnemonic, numWords, passphrase, passphraseLen, seed);
+    while(!pbkdf2_step(&state, MNEMONIC_TO_SEED_STEP)) {
+        if(seedProgressFunction) {
+            seedProgressFunction(pbkdf2_percent(&state));
+        }
+    }
+    if(seedProgressFunction) {
+        seedProgressFunction(100);
+    }
 
     return EXTENDED_MASTER_KEY_LENGTH;
 }
 
+void set_seed_progress_function(SeedProgressFunction function) {
+    seedProgressFunction = function;
+}
+
 int generate_seed(SeedCtx* ctx, const char* passphrase, int passphraseLen) {
     // Step 1 - generate entropy and apply checksum
 #if USE_DEBUG_ENTROPY
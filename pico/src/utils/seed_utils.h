@@ -1,6 +1,8 @@
 #ifndef _SEED_UTILS_H_
 #define _SEED_UTILS_H_
 
+#include "hash_utils.h"
+
 #include <stdint.h>
 
 
@@ -10,6 +12,7 @@
 #define MAX_MNEMONIC_PASSPHRASE_LENGTH      (16)
 #define MNEMONIC_LENGTH                     (24)
 #define MAX_MNEMONIC_WORD_LENGTH            (8)
+#define MNEMONIC_TO_SEED_STEP               (128)       // PBKDF2 iterations between progress reports
 
 
 typedef struct {
@@ -18,6 +21,8 @@ typedef struct {
     uint8_t seed[EXTENDED_MASTER_KEY_LENGTH];
 } SeedCtx;
 
+typedef void (*SeedProgressFunction)(uint8_t percent);
+
 
 int generate_seed(SeedCtx* ctx, const char* passphrase, int passphraseLen);
 
@@ -29,7 +34,29 @@ int mnemonic_to_seed(
     const char* passphrase, int passphraseLen,
     uint8_t* seed
 );
+
+/**
+ * Start the BIP39 mnemonic to seed derivation, to be run to completion with pbkdf2_step(). The
+ * passphrase is the PBKDF2 salt, so must stay valid until then
+ *
+ * state            out     Derivation state
+ * mnemonic         in      Mnemonic words, and how many there are
+ * passphrase       in      Salt ("mnemonic" followed by any passphrase), and its length
+ * seed             out     EXTENDED_MASTER_KEY_LENGTH bytes, written as the derivation completes
+ */
+void begin_mnemonic_to_seed(
+    Pbkdf2State* state,
+    const char** mnemonic, int numWords,
+    const char* passphrase, int passphraseLen,
+    uint8_t* seed
+);
 int validate_mnemonic(char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1]);
 
+/**
+ * Set a function to be told how far mnemonic_to_seed() (and so generate_seed()) has got, after
+ * each MNEMONIC_TO_SEED_STEP iterations of the seed's PBKDF2. NULL for none
+ */
+void set_seed_progress_function(SeedProgressFunction function);
+
 
 #endif      // _SEED_UTILS_H_
@@ -0,0 +1,411 @@
+#include "ur_encoder.h"
+#include "hash_utils.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+#define CBOR_TYPE_UNSIGNED          (0x00)
+#define CBOR_TYPE_BYTES             (0x40)
+#define CBOR_TYPE_ARRAY             (0x80)
+#define CBOR_TYPE_MAP               (0xA0)
+#define CBOR_TYPE_TAG               (0xC0)
+#define CBOR_FALSE                  (0xF4)
+#define CBOR_TRUE                   (0xF5)
+
+#define CBOR_TAG_KEYPATH            (304)
+
+#define HDKEY_KEY_DATA              (3)
+#define HDKEY_CHAIN_CODE            (4)
+#define HDKEY_ORIGIN                (6)
+#define HDKEY_PARENT_FINGERPRINT    (8)
+#define KEYPATH_COMPONENTS          (1)
+#define KEYPATH_SOURCE_FINGERPRINT  (2)
+#define KEYPATH_DEPTH               (3)
+
+#define PART_HEADER_MAX_LENGTH      (24)        // CBOR overhead of a multi-part fragment
+#define BYTEWORDS_CHECKSUM_LENGTH   (4)
+
+
+// Minimal bytewords: the first and last letters of each of the 256 bytewords, in byte order
+static const char BYTEWORDS_MINIMAL[] =
+    "aeadaoaxaaahamatayasbkbdbnbtbabs"
+    "bebybgbwbbbzcmchcscfcycwcecackct"
+    "cxclcpcndkdadsdidedtdrdndwdpdmdl"
+    "dyeheyeoeeecenemetesftfrfnfsfmfh"
+    "fzfpfwfxfyfefgflfdgagegrgsgtglgw"
+    "gdgygmgughgohfhghdhkhthphhhlhyhe"
+    "hnhsidiaieihiyioisinimjejzjnjtjl"
+    "jojsjpjkjykpkoktkskkknkgkekikblb"
+    "lalylflslrlplnltloldlelulklgmnmy"
+    "mhmemomumwmdmtmsmknlnyndnsntnnne"
+    "nboyoeotoxonolospdptpkpypspmplpe"
+    "pfpaprqdqzrerprlrorhrdrkrfryrnrs"
+    "rtsesasrssskswstspsosgsbsfsntotk"
+    "titttdtetytltbtstptatnuyuoutueur"
+    "vtvyvovlvevwvavdvswlwdwmwpwewyws"
+    "wtwnwzwfwkykynylyaytzszoztzczezm";
+
+
+// Work buffer for the CBOR encoded part currently being generated
+static uint8_t partBuffer[PART_HEADER_MAX_LENGTH + UR_DEFAULT_MAX_FRAGMENT_LENGTH * 2];
+
+
+//
+// CRC32 (IEEE 802.3) as used by BC-UR for both message and bytewords checksums
+//
+static uint32_t crc32(const uint8_t* data, int length) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for(int i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for(int j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+
+//
+// Xoshiro256** PRNG, seeded from SHA-256 as per the BC-UR fountain code specification
+//
+typedef struct {
+    uint64_t s[4];
+} Xoshiro256;
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static void xoshiro_init(Xoshiro256* rng, const uint8_t* seed, int seedLength) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    do_sha256(seed, seedLength, digest);
+    for(int i = 0; i < 4; ++i) {
+        uint64_t v = 0;
+        for(int j = 0; j < 8; ++j) {
+            v = (v << 8) | digest[(i * 8) + j];
+        }
+        rng->s[i] = v;
+    }
+}
+
+static uint64_t xoshiro_next(Xoshiro256* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+static double xoshiro_next_double(Xoshiro256* rng) {
+    return ((double) xoshiro_next(rng)) / ((double) UINT64_MAX + 1.0);
+}
+
+static int xoshiro_next_int(Xoshiro256* rng, int low, int high) {
+    return (int) (xoshiro_next_double(rng) * (high - low + 1)) + low;
+}
+
+
+//
+// Fountain code fragment selection
+//
+
+// Picks a degree in [1, seqLength] with probability proportional to 1/degree using Vose's alias
+// method, built and sampled in exactly the same order as the reference implementation
+static int choose_degree(Xoshiro256* rng, int seqLength) {
+    double probs[UR_MAX_SEQUENCE_LENGTH];
+    double aliasProbs[UR_MAX_SEQUENCE_LENGTH];
+    uint8_t aliases[UR_MAX_SEQUENCE_LENGTH];
+    uint8_t small[UR_MAX_SEQUENCE_LENGTH], large[UR_MAX_SEQUENCE_LENGTH];
+    int numSmall = 0, numLarge = 0;
+    double total = 0;
+
+    for(int i = 0; i < seqLength; ++i) {
+        probs[i] = 1.0 / (i + 1);
+        total += probs[i];
+    }
+
+    for(int i = 0; i < seqLength; ++i) {
+        probs[i] = (probs[i] * seqLength) / total;
+        aliasProbs[i] = 0;
+        aliases[i] = 0;
+    }
+
+    for(int i = (seqLength - 1); i >= 0; --i) {
+        if(probs[i] < 1) {
+            small[numSmall++] = i;
+        } else {
+            large[numLarge++] = i;
+        }
+    }
+
+    while(numSmall && numLarge) {
+        uint8_t a = small[--numSmall];
+        uint8_t g = large[--numLarge];
+
+        aliasProbs[a] = probs[a];
+        aliases[a] = g;
+        probs[g] += (probs[a] - 1);
+        if(probs[g] < 1) {
+            small[numSmall++] = g;
+        } else {
+            large[numLarge++] = g;
+        }
+    }
+
+    while(numLarge) {
+        aliasProbs[large[--numLarge]] = 1;
+    }
+    while(numSmall) {
+        aliasProbs[small[--numSmall]] = 1;
+    }
+
+    double r1 = xoshiro_next_double(rng);
+    double r2 = xoshiro_next_double(rng);
+    int i = (int) (seqLength * r1);
+
+    return ((r2 < aliasProbs[i]) ? i : aliases[i]) + 1;
+}
+
+// Sets one bit per fragment index that should be mixed into the given part
+static uint64_t choose_fragments(uint32_t seqNum, uint16_t seqLength, uint32_t checksum) {
+    uint8_t remaining[UR_MAX_SEQUENCE_LENGTH];
+    uint8_t seed[8];
+    Xoshiro256 rng;
+    uint64_t fragments = 0;
+
+    if(seqNum <= seqLength) {
+        return (1ULL << (seqNum - 1));
+    }
+
+    for(int i = 0; i < 4; ++i) {
+        seed[i] = (seqNum >> (24 - (8 * i))) & 0xFF;
+        seed[i + 4] = (checksum >> (24 - (8 * i))) & 0xFF;
+    }
+    xoshiro_init(&rng, seed, sizeof(seed));
+
+    int degree = choose_degree(&rng, seqLength);
+
+    // Only the first "degree" entries of the shuffle are ever used, so stop there
+    for(int i = 0; i < seqLength; ++i) {
+        remaining[i] = i;
+    }
+    for(int numRemaining = seqLength; degree > 0; --degree, --numRemaining) {
+        int index = xoshiro_next_int(&rng, 0, (numRemaining - 1));
+        fragments |= (1ULL << remaining[index]);
+        memmove(&remaining[index], &remaining[index + 1], (numRemaining - index - 1));
+    }
+
+    return fragments;
+}
+
+
+//
+// CBOR encoding
+//
+static int cbor_write_header(uint8_t* dest, uint8_t majorType, uint32_t value) {
+    if(value < 24) {
+        dest[0] = majorType | value;
+        return 1;
+    } else if(value <= 0xFF) {
+        dest[0] = majorType | 24;
+        dest[1] = value;
+        return 2;
+    } else if(value <= 0xFFFF) {
+        dest[0] = majorType | 25;
+        dest[1] = (value >> 8);
+        dest[2] = value;
+        return 3;
+    }
+
+    dest[0] = majorType | 26;
+    dest[1] = (value >> 24);
+    dest[2] = (value >> 16);
+    dest[3] = (value >> 8);
+    dest[4] = value;
+    return 5;
+}
+
+static int cbor_write_bytes(uint8_t* dest, const uint8_t* data, uint16_t length) {
+    int headerLength = cbor_write_header(dest, CBOR_TYPE_BYTES, length);
+    memcpy(dest + headerLength, data, length);
+    return (headerLength + length);
+}
+
+static uint32_t fingerprint_to_uint(const uint8_t* fingerprint) {
+    return (
+        ((uint32_t) fingerprint[0] << 24) |
+        ((uint32_t) fingerprint[1] << 16) |
+        ((uint32_t) fingerprint[2] << 8) |
+        fingerprint[3]
+    );
+}
+
+
+//
+// Bytewords
+//
+static int append_bytewords(char* dest, const uint8_t* data, int length) {
+    for(int i = 0; i < length; ++i) {
+        *dest++ = BYTEWORDS_MINIMAL[data[i] * 2] - ('a' - 'A');
+        *dest++ = BYTEWORDS_MINIMAL[(data[i] * 2) + 1] - ('a' - 'A');
+    }
+
+    return (length * 2);
+}
+
+static int append_bytewords_with_checksum(char* dest, const uint8_t* data, int length) {
+    uint32_t checksum = crc32(data, length);
+    uint8_t checksumBytes[BYTEWORDS_CHECKSUM_LENGTH] = {
+        (checksum >> 24), (checksum >> 16), (checksum >> 8), checksum
+    };
+
+    int written = append_bytewords(dest, data, length);
+    return written + append_bytewords(dest + written, checksumBytes, BYTEWORDS_CHECKSUM_LENGTH);
+}
+
+
+//
+// Public functions
+//
+bool ur_encoder_init(UREncoder* encoder, const char* type, const uint8_t* message, uint16_t messageLength, uint16_t maxFragmentLength) {
+    uint16_t fragmentLength = messageLength;
+
+    if(maxFragmentLength > (UR_DEFAULT_MAX_FRAGMENT_LENGTH * 2)) {
+        maxFragmentLength = (UR_DEFAULT_MAX_FRAGMENT_LENGTH * 2);
+    }
+
+    // Find the smallest fragment count whose (equal sized) fragments fit the requested length
+    uint16_t maxFragmentCount = (messageLength / UR_MIN_FRAGMENT_LENGTH);
+    for(uint16_t fragmentCount = 1; fragmentCount <= maxFragmentCount; ++fragmentCount) {
+        fragmentLength = (messageLength + fragmentCount - 1) / fragmentCount;
+        if(fragmentLength <= maxFragmentLength) {
+            break;
+        }
+    }
+
+    encoder->type = type;
+    encoder->message = message;
+    encoder->messageLength = messageLength;
+    encoder->fragmentLength = fragmentLength;
+    encoder->seqLength = (messageLength + fragmentLength - 1) / fragmentLength;
+    encoder->seqNum = 0;
+    encoder->checksum = crc32(message, messageLength);
+
+    return (encoder->seqLength <= UR_MAX_SEQUENCE_LENGTH) && (fragmentLength <= maxFragmentLength);
+}
+
+bool ur_encoder_is_single_part(const UREncoder* encoder) {
+    return (encoder->seqLength <= 1);
+}
+
+int ur_encoder_next_part(UREncoder* encoder, char* dest, int destLength) {
+    int typeLength = strlen(encoder->type);
+    int pos = 0;
+
+    if(ur_encoder_is_single_part(encoder)) {
+        int maxLength = 3 + typeLength + 1 + ((encoder->messageLength + BYTEWORDS_CHECKSUM_LENGTH) * 2);
+        if(maxLength >= destLength) {
+            return -1;
+        }
+
+        pos += sprintf(dest, "UR:%s/", encoder->type);
+        pos += append_bytewords_with_checksum(dest + pos, encoder->message, encoder->messageLength);
+    } else {
+        uint8_t* fragment = partBuffer + PART_HEADER_MAX_LENGTH;
+        uint64_t fragmentIndexes;
+        int partLength = 0;
+
+        encoder->seqNum += 1;
+        fragmentIndexes = choose_fragments(encoder->seqNum, encoder->seqLength, encoder->checksum);
+
+        // XOR the chosen fragments together, zero padding the final one
+        memset(fragment, 0, encoder->fragmentLength);
+        for(int i = 0; i < encoder->seqLength; ++i) {
+            if(fragmentIndexes & (1ULL << i)) {
+                int offset = (i * encoder->fragmentLength);
+                int length = encoder->messageLength - offset;
+                if(length > encoder->fragmentLength) {
+                    length = encoder->fragmentLength;
+                }
+                for(int j = 0; j < length; ++j) {
+                    fragment[j] ^= encoder->message[offset + j];
+                }
+            }
+        }
+
+        // [seqNum, seqLen, messageLen, checksum, data]
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_ARRAY, 5);
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_UNSIGNED, encoder->seqNum);
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_UNSIGNED, encoder->seqLength);
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_UNSIGNED, encoder->messageLength);
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_UNSIGNED, encoder->checksum);
+        partLength += cbor_write_header(partBuffer + partLength, CBOR_TYPE_BYTES, encoder->fragmentLength);
+        memmove(partBuffer + partLength, fragment, encoder->fragmentLength);
+        partLength += encoder->fragmentLength;
+
+        int maxLength = 3 + typeLength + 24 + ((partLength + BYTEWORDS_CHECKSUM_LENGTH) * 2);
+        if(maxLength >= destLength) {
+            return -1;
+        }
+
+        pos += sprintf(dest, "UR:%s/%lu-%u/", encoder->type, (unsigned long) encoder->seqNum, encoder->seqLength);
+        pos += append_bytewords_with_checksum(dest + pos, partBuffer, partLength);
+    }
+
+    dest[pos] = 0;
+
+    // Type names are supplied in lower case, everything else is upper-cased as it is written
+    for(int i = 3; i < (3 + typeLength); ++i) {
+        if((dest[i] >= 'a') && (dest[i] <= 'z')) {
+            dest[i] -= ('a' - 'A');
+        }
+    }
+
+    return pos;
+}
+
+int ur_encode_crypto_hdkey(const ExtendedKey* key, const uint32_t* originPath, uint8_t originDepth, const uint8_t* sourceFingerprint, uint8_t* dest) {
+    uint8_t* writePtr = dest;
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_MAP, 4);
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, HDKEY_KEY_DATA);
+    writePtr += cbor_write_bytes(writePtr, key->publicKey, PUBLIC_KEY_LENGTH);
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, HDKEY_CHAIN_CODE);
+    writePtr += cbor_write_bytes(writePtr, key->chainCode, CHAIN_CODE_LENGTH);
+
+    // Origin keypath
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, HDKEY_ORIGIN);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_TAG, CBOR_TAG_KEYPATH);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_MAP, 3);
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, KEYPATH_COMPONENTS);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_ARRAY, (originDepth * 2));
+    for(int i = 0; i < originDepth; ++i) {
+        writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, (originPath[i] & ~HARDENED_CHILD_INDEX_OFFSET));
+        *writePtr++ = (originPath[i] & HARDENED_CHILD_INDEX_OFFSET) ? CBOR_TRUE : CBOR_FALSE;
+    }
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, KEYPATH_SOURCE_FINGERPRINT);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, fingerprint_to_uint(sourceFingerprint));
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, KEYPATH_DEPTH);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, originDepth);
+
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, HDKEY_PARENT_FINGERPRINT);
+    writePtr += cbor_write_header(writePtr, CBOR_TYPE_UNSIGNED, fingerprint_to_uint(key->parentFingerprint));
+
+    return (writePtr - dest);
+}
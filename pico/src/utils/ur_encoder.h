@@ -0,0 +1,74 @@
+#ifndef _UR_ENCODER_H_
+#define _UR_ENCODER_H_
+
+#include "key_utils.h"
+
+#include <stdint.h>
+
+
+#define UR_MAX_SEQUENCE_LENGTH              (64)        // Upper bound on the number of fragments a message is split into
+#define UR_MIN_FRAGMENT_LENGTH              (10)
+#define UR_DEFAULT_MAX_FRAGMENT_LENGTH      (40)        // Fits a crypto-hdkey part inside a version 5 (37x37) QR code
+#define UR_MAX_HDKEY_CBOR_LENGTH            (160)
+
+
+// Encodes a CBOR message as a sequence of BC-UR (Uniform Resource) strings. Messages that fit in a
+// single fragment produce a single-part UR, everything else produces an endless fountain-coded
+// multi-part sequence. Parts are generated one at a time from the message, so no more than one
+// part ever needs to be held in memory
+typedef struct {
+    const char* type;                   // UR type, e.g. "crypto-hdkey". Must outlive the encoder
+    const uint8_t* message;             // CBOR encoded message. Must outlive the encoder
+    uint16_t messageLength;
+    uint16_t fragmentLength;
+    uint16_t seqLength;
+    uint32_t seqNum;
+    uint32_t checksum;                  // CRC32 of the complete message
+} UREncoder;
+
+
+/**
+ * Prepare an encoder for the supplied message
+ *
+ * encoder              out     The encoder to be configured
+ * type                 in      The UR type of the message (lower case)
+ * message              in      The CBOR encoded message
+ * messageLength        in      Number of bytes in message
+ * maxFragmentLength    in      Largest fragment (in bytes) that a single part may carry
+ *
+ * Returns false if the message would need more than UR_MAX_SEQUENCE_LENGTH fragments
+ */
+bool ur_encoder_init(UREncoder* encoder, const char* type, const uint8_t* message, uint16_t messageLength, uint16_t maxFragmentLength);
+
+/**
+ * Returns true if the message fits in a single, non fountain-coded, part
+ */
+bool ur_encoder_is_single_part(const UREncoder* encoder);
+
+/**
+ * Generate the next part in the sequence. Parts are upper-cased so they can be carried in a QR
+ * code's alphanumeric mode
+ *
+ * encoder              in/out  The encoder to generate the part from
+ * dest                 out     Storage for the null-terminated part string
+ * destLength           in      Size of dest, in bytes
+ *
+ * Returns the length of the part string, or -1 if it would not fit in dest
+ */
+int ur_encoder_next_part(UREncoder* encoder, char* dest, int destLength);
+
+/**
+ * Encode the supplied key as a BCR-2020-007 crypto-hdkey (public key only), including origin info
+ *
+ * key                  in      The key to be encoded
+ * originPath           in      Raw child indices (hardened offsets applied) from the master key to key
+ * originDepth          in      Number of entries in originPath
+ * sourceFingerprint    in      Fingerprint of the master key
+ * dest                 out     Storage for the CBOR bytes (at least UR_MAX_HDKEY_CBOR_LENGTH bytes)
+ *
+ * Returns the number of bytes written to dest
+ */
+int ur_encode_crypto_hdkey(const ExtendedKey* key, const uint32_t* originPath, uint8_t originDepth, const uint8_t* sourceFingerprint, uint8_t* dest);
+
+
+#endif      // _UR_ENCODER_H_
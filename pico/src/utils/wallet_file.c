@@ -1,26 +1,91 @@
 #include "wallet_file.h"
 #include "wallet_app/hd_wallet.h"
+#include "utils/secure_zero.h"
 #include "ff.h"
+#include "diskio.h"
 #include "f_util.h"
+
+#include "pico/time.h"
+#if !PICO_NO_HARDWARE
 #include "sd_card.h"
+#include "hardware/gpio.h"
+#include "hardware/structs/iobank0.h"
+#endif
+
+#ifndef WALLET_FLASH_STORAGE
+#define WALLET_FLASH_STORAGE    (0)             // 1 to keep wallet.dat in reserved on-board flash rather than on the card
+#endif
+#if WALLET_FLASH_STORAGE
+#include "utils/platform/flash_store.h"
+#endif
 
 #include <stdio.h>
+#include <string.h>
 
 
-static const char* const WALLET_FILE        = "wallet.dat";
+static const char* const WALLET_FILE        = "wallet.dat";          // Single wallet, from before containers
+static const char* const WALLET_CONTAINER_FILE  = "wallets.dat";
 static const char* const MNEMONICS_FILE     = "mnemonic.txt";
 static const char* const WALLET_DIRECTORY   = "PicoWallet";
 
 
+#define WRITE_BLOCK_SIZE        (128)
+
+static const char* const BENCHMARK_FILE     = "bench.tmp";
+static const char* const CONTAINER_BENCHMARK_FILE   = "benchct.tmp";
+#define BENCHMARK_CHUNK_SIZE    (8 * FF_MIN_SS)         // Whole sectors, so FatFs passes them straight to multi-block transfers
+
+#define IS_MNEMONIC_CHAR(x)     ((x >= 'a') && (x <= 'z'))
+#define IS_UPPER_CASE_CHAR(x)   ((x >= 'A') && (x <= 'Z'))
+#define MNEMONIC_COMMENT_CHAR   ('#')                   // Comments run to the end of the line
+#define MNEMONIC_READ_SIZE      (FF_MIN_SS)             // Read a sector at a time
+
+//
+//      Wallet container format
+//
+//  +-------------------------------+
+//  | Header                        |   Magic "PWCT", format version, index entry size, slot
+//  | 1 sector                      |   count, records allocated
+//  +-------------------------------+
+//  | Index                         |   One 16 byte entry per slot, in slot order: slot id,
+//  | WALLET_CONTAINER_SLOTS        |   label hash, record offset, version, record length.
+//  |   entries                     |   An entry's offset is 0 while its slot is empty
+//  +-------------------------------+
+//  | Records                       |   One sector each, in the order they were appended. A
+//  |                               |   replaced wallet is rewritten where it is
+//  +-------------------------------+
+//
+#define CONTAINER_MAGIC             (0x54435750)
+#define CONTAINER_FORMAT_VERSION    (1)
+#define CONTAINER_SECTOR_SIZE       (FF_MIN_SS)
+#define CONTAINER_INDEX_OFFSET      (CONTAINER_SECTOR_SIZE)
+#define CONTAINER_DATA_OFFSET       (CONTAINER_INDEX_OFFSET + (WALLET_CONTAINER_SLOTS * sizeof(ContainerIndexEntry)))
+#define CONTAINER_RECORD_SIZE       (CONTAINER_SECTOR_SIZE)
+#define LABEL_HASH_OFFSET_BASIS     (2166136261u)
+#define LABEL_HASH_PRIME            (16777619u)
+
+#if PICO_NO_HARDWARE
+// Host build, the volume is a disk image served to FatFs by host_disk.c
+static FATFS hostFatFs;
+
+#define VOLUME_NAME             ("0:")
+#define VOLUME_FATFS            (&hostFatFs)
+#else
 #define MISO_PIN                (4)
 #define SD_SS_PIN               (5)              
 #define SCK_PIN                 (6)
 #define MOSI_PIN                (7)
 #define SPI_INST                (spi0)
 
-#define WRITE_BLOCK_SIZE        (128)
+#ifndef SD_CARD_DETECT
+#define SD_CARD_DETECT          (0)             // 1 if the socket's card detect switch is wired up
+#endif
+#define CARD_DETECT_PIN         (13)
+#define CARD_DETECT_EDGES       (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
 
-#define IS_MNEMONIC_CHAR(x)     ((x >= 'a') && (x <= 'z'))
+#ifndef SD_MAX_BAUD_RATE
+#define SD_MAX_BAUD_RATE        (25 * 1000 * 1000)      // Ceiling for the clock calibration, the SD default speed limit
+#endif
 
 // Hardware Configuration of SPI "objects"
 // Note: multiple SD cards can be driven by one SPI if they use different slave
@@ -30,7 +95,7 @@ static spi_t SDCARD_SPI = {
     .miso_gpio  = MISO_PIN,
     .mosi_gpio  = MOSI_PIN,
     .sck_gpio   = SCK_PIN,
-    .baud_rate  = 12500 * 1000          //.baud_rate = 25 * 1000 * 1000, // Actual frequency: 20833333. 
+    .baud_rate  = 12500 * 1000          // Safe rate to start from, sd_calibrate_clock() steps it up at mount
 };
 
 // Hardware Configuration of the SD Card "objects"
@@ -38,12 +103,75 @@ static sd_card_t SD_CARD = {
     .pcName = "0:",                     // Name used to mount device
     .spi = &SDCARD_SPI,                 // Pointer to the SPI driving this card
     .ss_gpio = SD_SS_PIN,               // The SPI slave select GPIO for this SD card
+#if SD_CARD_DETECT
+    .use_card_detect    = true,
+    .card_detect_gpio   = CARD_DETECT_PIN,
+    .card_detected_true = 0             // Switch closes to ground (against the pull up) with a card in
+#else
     .use_card_detect    = false,
-    .card_detect_gpio   = 13,           // TODO: Card detect
+    .card_detect_gpio   = CARD_DETECT_PIN,
     .card_detected_true = -1            // What the GPIO read returns when a card is
                                         // present. Use -1 if there is no card detect.
+#endif
 };
 
+#define VOLUME_NAME             (SD_CARD.pcName)
+#define VOLUME_FATFS            (&SD_CARD.fatfs)
+
+// Calibration stops below a rate that went on to fail, until the card is swapped
+static uint baudRateLimit = SD_MAX_BAUD_RATE;
+#endif
+
+// The volume stays mounted, and in WALLET_DIRECTORY, between file operations. It is only dropped on
+// request, after a failed operation, or when the card may have been swapped
+static bool volumeMounted = false;
+static bool inWalletDirectory = false;
+static WalletStorageStats storageStats;
+
+// Splits mnemonic.txt into words. The file holds one or more mnemonics, each MNEMONIC_LENGTH words
+// laid out however the user likes (one per line, numbered, ...), with comments
+typedef struct {
+    char (*mnemonics)[MAX_MNEMONIC_WORD_LENGTH + 1];   // Where the wanted mnemonic's words go
+    uint32_t wantedMnemonic;
+    uint32_t wordCount;                                 // Words in the file so far
+    uint8_t wordLength;                                 // Of the word in progress, 0 between words
+    char word[MAX_MNEMONIC_WORD_LENGTH + 1];            // Carries a word over a read boundary
+    bool inComment;
+    bool wordTooLong;
+} MnemonicTokenizer;
+
+static uint8_t mnemonicReadBuffer[MNEMONIC_READ_SIZE];
+
+typedef struct {
+    uint32_t magic;
+    uint16_t formatVersion;
+    uint16_t entrySize;
+    uint32_t slots;                 // Index entries
+    uint32_t records;               // Record sectors allocated so far
+} ContainerHeader;
+
+typedef struct {
+    uint32_t slotId;                // The entry's own slot, so a stray read can't pass for it
+    uint32_t labelHash;             // 0 for no label
+    uint32_t offset;                // Of the record, 0 while the slot is empty
+    uint16_t version;               // 1 when the slot is first written, then one more per replacement
+    uint16_t length;
+} ContainerIndexEntry;
+
+// Records are written a whole sector at a time
+static uint8_t containerSectorBuffer[CONTAINER_SECTOR_SIZE];
+
+#if PICO_NO_HARDWARE
+static bool check_volume_changed() {
+    return false;
+}
+
+static void on_volume_mounted() {
+}
+
+static void on_volume_failed() {
+}
+#else
 size_t sd_get_num() {
     return 1; 
 }
@@ -60,28 +188,101 @@ spi_t *spi_get_by_num(size_t num) {
     return (num <= sd_get_num()) ? &SDCARD_SPI : NULL;
 }
 
-FRESULT open_wallet_file(FIL* file, int write, const char* filename) {
-    FRESULT fr;
-    sd_card_t* sd = sd_get_by_num(0);
-    
-    fr = f_mount(&sd->fatfs, sd->pcName, 1);
+// Returns true, with the card set to be initialised from scratch, if card detect saw it come out
+static bool check_volume_changed() {
+#if SD_CARD_DETECT
+    // The card detect pin's edges latch in the raw interrupt status whether or not its interrupt is
+    // enabled, so a card pulled and pushed back in between two checks still shows up
+    uint32_t events = ((iobank0_hw->intr[SD_CARD.card_detect_gpio / 8] >> (4 * (SD_CARD.card_detect_gpio % 8))) & CARD_DETECT_EDGES);
+    if(events) {
+        gpio_acknowledge_irq(SD_CARD.card_detect_gpio, events);
+    }
+
+    if(events || !sd_card_detect(&SD_CARD)) {
+        sd_reset_clock_calibration(&SD_CARD);
+        SD_CARD.m_Status |= STA_NOINIT;
+        baudRateLimit = SD_MAX_BAUD_RATE;
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+static void on_volume_mounted() {
+#if SD_CARD_DETECT
+    // Edges up to now were the card going in
+    gpio_acknowledge_irq(SD_CARD.card_detect_gpio, CARD_DETECT_EDGES);
+#endif
+
+    // The card has been initialised at the configured rate, find how fast it can go. Cached, so only
+    // the first mount of a card pays for it
+    int status = sd_calibrate_clock(&SD_CARD, baudRateLimit);
+    if(SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        printf("SD clock calibration error: %d, staying at %u Hz\n", status, SDCARD_SPI.baud_rate);
+    }
+}
+
+// The error may have been the clock being too fast for the card, so the next mount calibrates again
+// below the rate in use
+static void on_volume_failed() {
+    if(SD_CARD.calibrated_baud_rate > SD_CARD.base_baud_rate) {
+        baudRateLimit = SD_CARD.calibrated_baud_rate - 1;
+        ++storageStats.clockFallbacks;
+    }
+
+    sd_reset_clock_calibration(&SD_CARD);
+}
+#endif
+
+static void drop_mount_session() {
+    if(volumeMounted) {
+        f_unmount(VOLUME_NAME);
+        ++storageStats.unmounts;
+    }
+
+    volumeMounted = false;
+    inWalletDirectory = false;
+}
+
+static void drop_failed_session() {
+    on_volume_failed();
+    drop_mount_session();
+}
+
+static FRESULT ensure_mounted() {
+    if(volumeMounted && check_volume_changed()) {
+        drop_mount_session();
+        ++storageStats.cardChanges;
+    }
+
+    if(volumeMounted) {
+        return FR_OK;
+    }
+
+    FRESULT fr = f_mount(VOLUME_FATFS, VOLUME_NAME, 1);
     if(FR_OK != fr) {
         printf("f_mount error: %s (%d)\n", FRESULT_str(fr), fr);
         return fr;
     }
 
-    fr = f_chdir(WALLET_DIRECTORY);
-    if(FR_OK != fr) {
-        if((FR_NO_PATH == fr) || (FR_NO_FILE == fr)) {
-            fr = f_mkdir(WALLET_DIRECTORY);
-            if(FR_OK != fr) {
-                printf("f_mkdir error for %s: %s (%d)\n", WALLET_DIRECTORY, (fr), fr);
-                f_unmount(sd->pcName);
-                return fr;
-            }
-        } else {
-            printf("f_chdir error for %s: %s (%d)\n", WALLET_DIRECTORY, (fr), fr);
-            f_unmount(sd->pcName);
+    on_volume_mounted();
+
+    volumeMounted = true;
+    ++storageStats.mounts;
+    return FR_OK;
+}
+
+static FRESULT enter_wallet_directory() {
+    if(inWalletDirectory) {
+        return FR_OK;
+    }
+
+    FRESULT fr = f_chdir(WALLET_DIRECTORY);
+    if((FR_NO_PATH == fr) || (FR_NO_FILE == fr)) {
+        fr = f_mkdir(WALLET_DIRECTORY);
+        if(FR_OK != fr) {
+            printf("f_mkdir error for %s: %s (%d)\n", WALLET_DIRECTORY, FRESULT_str(fr), fr);
             return fr;
         }
 
@@ -89,29 +290,64 @@ FRESULT open_wallet_file(FIL* file, int write, const char* filename) {
     }
 
     if(FR_OK != fr) {
-        printf("f_chdir error for %s: %s (%d)\n", WALLET_DIRECTORY, (fr), fr);
-        f_unmount(sd->pcName);
+        printf("f_chdir error for %s: %s (%d)\n", WALLET_DIRECTORY, FRESULT_str(fr), fr);
         return fr;
     }
 
-    if(write) {
-        return f_open(file, filename, (FA_OPEN_ALWAYS | FA_WRITE));
-    } else {
-        return f_open(file, filename, (FA_OPEN_EXISTING | FA_READ));
+    inWalletDirectory = true;
+    ++storageStats.directoryChanges;
+    return FR_OK;
+}
+
+static FRESULT open_wallet_file_mode(FIL* file, BYTE mode, const char* filename) {
+    FRESULT fr;
+    
+    fr = ensure_mounted();
+    if(FR_OK != fr) {
+        return fr;
     }
+
+    fr = enter_wallet_directory();
+    if(FR_OK != fr) {
+        drop_failed_session();
+        return fr;
+    }
+
+    fr = f_open(file, filename, mode);
+
+    // A missing file is an answer, anything else may mean the card has gone
+    if((FR_OK != fr) && (FR_NO_FILE != fr) && (FR_NO_PATH != fr)) {
+        drop_failed_session();
+    } else if(FR_OK == fr) {
+        ++storageStats.opens;
+    }
+
+    return fr;
 }
 
-FRESULT close_wallet_file(FIL* file) {
-    sd_card_t* sd = sd_get_by_num(0);
+FRESULT open_wallet_file(FIL* file, int write, const char* filename) {
+    return open_wallet_file_mode(file, (write ? (FA_OPEN_ALWAYS | FA_WRITE) : (FA_OPEN_EXISTING | FA_READ)), filename);
+}
 
+FRESULT close_wallet_file(FIL* file) {
     FRESULT fr = f_close(file);
     if (FR_OK != fr) {
         printf("f_close error: %s (%d)\n", FRESULT_str(fr), fr);
+        drop_failed_session();
     }
-    f_unmount(sd->pcName);
+
+    return fr;
+}
+
+void unmount_wallet_storage() {
+    drop_mount_session();
+}
+
+const WalletStorageStats* get_wallet_storage_stats() {
+    return &storageStats;
 }
 
-wallet_error load_wallet_data_from_disk(uint8_t* data) {
+static wallet_error load_legacy_wallet_file(uint8_t* data) {
     FRESULT openResult, closeResult, readResult;
     uint8_t* dataPtr = data;
     UINT bytesRead;
@@ -152,51 +388,400 @@ wallet_error load_wallet_data_from_disk(uint8_t* data) {
     return returnValue;
 }
 
-wallet_error save_wallet_data_to_disk(const uint8_t* data) {
-    FRESULT openResult, closeResult, writeResult;
-    FIL walletFile;
-    UINT bytesWritten;
-    int bytesRemaining = SERIALIZED_WALLET_SIZE;
-    const uint8_t* dataPtr = data;
+static uint32_t hash_wallet_label(const char* label) {
+    uint32_t hash = LABEL_HASH_OFFSET_BASIS;
 
+    while(*label) {
+        hash = (hash ^ (uint8_t) *label++) * LABEL_HASH_PRIME;
+    }
 
-    // Open wallet file for writing
-    openResult = open_wallet_file(&walletFile, 1, WALLET_FILE);
-    if (FR_OK != openResult) {
-        printf("f_open(%s) error: %s (%d)\n", WALLET_FILE, FRESULT_str(openResult), openResult);
-        return WALLET_ERROR(WF_FAILED_TO_OPEN, openResult);
+    // 0 is kept for no label
+    return hash ? hash : 1;
+}
+
+static uint32_t index_entry_offset(uint32_t slot) {
+    return CONTAINER_INDEX_OFFSET + (slot * sizeof(ContainerIndexEntry));
+}
+
+static bool is_entry_in_use(const ContainerIndexEntry* entry, uint32_t slot) {
+    return (entry->slotId == slot) &&
+        (entry->offset >= CONTAINER_DATA_OFFSET) &&
+        ((entry->offset % CONTAINER_RECORD_SIZE) == 0);
+}
+
+static wallet_error read_container_at(FIL* file, uint32_t offset, void* data, uint32_t length) {
+    UINT bytesRead = 0;
+
+    FRESULT fr = f_lseek(file, offset);
+    if(FR_OK == fr) {
+        fr = f_read(file, data, length, &bytesRead);
+    }
+
+    if(FR_OK != fr) {
+        return WALLET_ERROR(WF_FATFS_ERROR, fr);
+    } else if(bytesRead != length) {
+        return WALLET_ERROR(WF_WALLET_FILE_CORRUPTED, 0);
     }
 
-    while(bytesRemaining) {
-        int bytesToWrite = (bytesRemaining > WRITE_BLOCK_SIZE) ? WRITE_BLOCK_SIZE : bytesRemaining;
-        writeResult = f_write(&walletFile, dataPtr, bytesToWrite, &bytesWritten);
+    return NO_ERROR;
+}
+
+static wallet_error write_container_at(FIL* file, uint32_t offset, const void* data, uint32_t length) {
+    UINT bytesWritten = 0;
 
-        // Check
-        if((FR_OK != writeResult) || (bytesWritten != bytesToWrite)) {
-            close_wallet_file(&walletFile);
-            return WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, writeResult);
+    FRESULT fr = f_lseek(file, offset);
+    if(FR_OK == fr) {
+        fr = f_write(file, data, length, &bytesWritten);
+    }
+
+    if(FR_OK != fr) {
+        return WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, fr);
+    } else if(bytesWritten != length) {
+        return WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, FR_DENIED);     // Card full
+    }
+
+    return NO_ERROR;
+}
+
+static wallet_error open_container(FIL* file, const char* filename, bool write) {
+    FRESULT fr = open_wallet_file_mode(file, (write ? (FA_OPEN_ALWAYS | FA_READ | FA_WRITE) : (FA_OPEN_EXISTING | FA_READ)), filename);
+    if(FR_OK != fr) {
+        if((FR_NO_FILE == fr) || (FR_NO_PATH == fr)) {
+            return WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
         }
 
-        // Loop
-        dataPtr += bytesWritten;
-        bytesRemaining -= bytesWritten;
+        return WALLET_ERROR(WF_FAILED_TO_OPEN, fr);
     }
 
-    closeResult = close_wallet_file(&walletFile);
-    if (FR_OK != closeResult) {
-        printf("f_close error: %s (%d)\n", FRESULT_str(closeResult), closeResult);
+    return NO_ERROR;
+}
+
+// The index is written out in full, FatFs leaves the contents of a file grown by seeking undefined
+static wallet_error create_container(FIL* file, ContainerHeader* header) {
+    *header = (ContainerHeader) {
+        .magic = CONTAINER_MAGIC,
+        .formatVersion = CONTAINER_FORMAT_VERSION,
+        .entrySize = sizeof(ContainerIndexEntry),
+        .slots = WALLET_CONTAINER_SLOTS,
+        .records = 0
+    };
+
+    memset(containerSectorBuffer, 0, CONTAINER_SECTOR_SIZE);
+    memcpy(containerSectorBuffer, header, sizeof(ContainerHeader));
+    wallet_error err = write_container_at(file, 0, containerSectorBuffer, CONTAINER_SECTOR_SIZE);
+
+    memset(containerSectorBuffer, 0, CONTAINER_SECTOR_SIZE);
+    for(uint32_t offset = CONTAINER_INDEX_OFFSET; (err == NO_ERROR) && (offset < CONTAINER_DATA_OFFSET); offset += CONTAINER_SECTOR_SIZE) {
+        err = write_container_at(file, offset, containerSectorBuffer, CONTAINER_SECTOR_SIZE);
+    }
+
+    return err;
+}
+
+static wallet_error read_container_header(FIL* file, ContainerHeader* header) {
+    wallet_error err = read_container_at(file, 0, header, sizeof(ContainerHeader));
+    if(err != NO_ERROR) {
+        return err;
+    }
+
+    if((header->magic != CONTAINER_MAGIC) || (header->entrySize != sizeof(ContainerIndexEntry)) || (header->slots != WALLET_CONTAINER_SLOTS)) {
+        return WALLET_ERROR(WF_WALLET_FILE_CORRUPTED, 0);
+    } else if(header->formatVersion != CONTAINER_FORMAT_VERSION) {
+        return WALLET_ERROR(WF_FILE_VERSION_MISMATCH, 0);
+    }
+
+    return NO_ERROR;
+}
+
+static wallet_error load_wallet_from_container(const char* filename, uint32_t slot, uint8_t* data) {
+    ContainerIndexEntry entry;
+    FIL file;
+
+    if(slot >= WALLET_CONTAINER_SLOTS) {
+        return WALLET_ERROR(WF_FAIL, 0);
+    }
+
+    wallet_error err = open_container(&file, filename, false);
+    if(err != NO_ERROR) {
+        return err;
+    }
+
+    // The header isn't read, the entry vouches for itself, so finding a wallet is one seek and one
+    // sector read
+    err = read_container_at(&file, index_entry_offset(slot), &entry, sizeof(entry));
+    if(err == NO_ERROR) {
+        if(!is_entry_in_use(&entry, slot)) {
+            err = WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
+        } else if(entry.length != SERIALIZED_WALLET_SIZE) {
+            err = WALLET_ERROR(WF_WALLET_FILE_CORRUPTED, 0);
+        } else {
+            err = read_container_at(&file, entry.offset, data, SERIALIZED_WALLET_SIZE);
+        }
+    }
+
+    close_wallet_file(&file);
+    return err;
+}
+
+static wallet_error save_wallet_to_container(const char* filename, uint32_t slot, const char* label, const uint8_t* data) {
+    ContainerHeader header;
+    ContainerIndexEntry entry;
+    FIL file;
+
+    if(slot >= WALLET_CONTAINER_SLOTS) {
+        return WALLET_ERROR(WF_FAIL, 0);
+    }
+
+    wallet_error err = open_container(&file, filename, true);
+    if(err != NO_ERROR) {
+        printf("f_open(%s) error: 0x%04X\n", filename, err);
+        return err;
+    }
+
+    if(f_size(&file) == 0) {
+        err = create_container(&file, &header);
+    } else {
+        err = read_container_header(&file, &header);
+    }
+
+    if(err == NO_ERROR) {
+        err = read_container_at(&file, index_entry_offset(slot), &entry, sizeof(entry));
+    }
+
+    if(err == NO_ERROR) {
+        memset(containerSectorBuffer, 0, CONTAINER_SECTOR_SIZE);
+        memcpy(containerSectorBuffer, data, SERIALIZED_WALLET_SIZE);
+
+        if(is_entry_in_use(&entry, slot)) {
+            // Replaced where it is, in a single sector write
+            err = write_container_at(&file, entry.offset, containerSectorBuffer, CONTAINER_RECORD_SIZE);
+            ++entry.version;
+        } else {
+            entry = (ContainerIndexEntry) {
+                .slotId = slot,
+                .offset = CONTAINER_DATA_OFFSET + (header.records * CONTAINER_RECORD_SIZE),
+                .version = 1
+            };
+
+            // The record count goes out ahead of the entry, so a save cut short can leak a record
+            // but never hand the same one to two slots
+            ++header.records;
+            err = write_container_at(&file, entry.offset, containerSectorBuffer, CONTAINER_RECORD_SIZE);
+            if(err == NO_ERROR) {
+                err = write_container_at(&file, 0, &header, sizeof(header));
+            }
+        }
+
+        entry.length = SERIALIZED_WALLET_SIZE;
+        if(label) {
+            entry.labelHash = hash_wallet_label(label);
+        }
+    }
+
+    if(err == NO_ERROR) {
+        err = write_container_at(&file, index_entry_offset(slot), &entry, sizeof(entry));
+    }
+
+    FRESULT closeResult = close_wallet_file(&file);
+    if((err == NO_ERROR) && (FR_OK != closeResult)) {
+        err = WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, closeResult);
+    }
+
+    return err;
+}
+
+static wallet_error find_wallet_in_container(const char* filename, const char* label, uint32_t* slot) {
+    const ContainerIndexEntry* entries = (const ContainerIndexEntry*) containerSectorBuffer;
+    const uint32_t entriesPerSector = (CONTAINER_SECTOR_SIZE / sizeof(ContainerIndexEntry));
+    uint32_t labelHash = hash_wallet_label(label);
+    FIL file;
+
+    wallet_error err = open_container(&file, filename, false);
+    if(err != NO_ERROR) {
+        return err;
+    }
+
+    err = WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
+    for(uint32_t first = 0; first < WALLET_CONTAINER_SLOTS; first += entriesPerSector) {
+        wallet_error readError = read_container_at(&file, index_entry_offset(first), containerSectorBuffer, CONTAINER_SECTOR_SIZE);
+        if(readError != NO_ERROR) {
+            err = readError;
+            break;
+        }
+
+        for(uint32_t i = 0; i < entriesPerSector; ++i) {
+            if(is_entry_in_use(&entries[i], (first + i)) && (entries[i].labelHash == labelHash)) {
+                *slot = (first + i);
+                err = NO_ERROR;
+                break;
+            }
+        }
+
+        if(err == NO_ERROR) {
+            break;
+        }
+    }
+
+    close_wallet_file(&file);
+    return err;
+}
+
+// Before containers there was only ever the one wallet, in wallet.dat, which is now slot 0's
+static wallet_error load_wallet_data_from_card(uint32_t slot, uint8_t* data) {
+    wallet_error err = load_wallet_from_container(WALLET_CONTAINER_FILE, slot, data);
+    if((slot == DEFAULT_WALLET_SLOT) && (GET_WF_RESULT(err) == WF_FILE_NOT_FOUND)) {
+        err = load_legacy_wallet_file(data);
+    }
+
+    return err;
+}
+
+#if WALLET_FLASH_STORAGE
+// Flash holds slot 0's wallet, any others are in the container on the card
+wallet_error load_wallet_data_from_disk(uint32_t slot, uint8_t* data) {
+    if(slot != DEFAULT_WALLET_SLOT) {
+        return load_wallet_data_from_card(slot, data);
+    }
+
+    wallet_error err = flash_store_read(data, SERIALIZED_WALLET_SIZE);
+    if(GET_WF_RESULT(err) != WF_FILE_NOT_FOUND) {
+        return err;
+    }
+
+    // Nothing in flash yet, so fall back to the card, and move the wallet into flash so the next
+    // boot doesn't need the card
+    err = load_wallet_data_from_card(slot, data);
+    if(err == NO_ERROR) {
+        wallet_error flashError = flash_store_write(data, SERIALIZED_WALLET_SIZE);
+        if(flashError != NO_ERROR) {
+            printf("Copying wallet to flash failed: 0x%04X\n", flashError);
+        }
+    }
+
+    return err;
+}
+
+// The copy on the card (if any) is left as it was, flash holds the current wallet
+wallet_error save_wallet_data_to_disk(uint32_t slot, const char* label, const uint8_t* data) {
+    if(slot != DEFAULT_WALLET_SLOT) {
+        return save_wallet_to_container(WALLET_CONTAINER_FILE, slot, label, data);
+    }
+
+    return flash_store_write(data, SERIALIZED_WALLET_SIZE);
+}
+#else
+wallet_error load_wallet_data_from_disk(uint32_t slot, uint8_t* data) {
+    return load_wallet_data_from_card(slot, data);
+}
+
+wallet_error save_wallet_data_to_disk(uint32_t slot, const char* label, const uint8_t* data) {
+    return save_wallet_to_container(WALLET_CONTAINER_FILE, slot, label, data);
+}
+#endif
+
+wallet_error find_wallet_slot(const char* label, uint32_t* slot) {
+    return find_wallet_in_container(WALLET_CONTAINER_FILE, label, slot);
+}
+
+static void end_mnemonic_word(MnemonicTokenizer* tokenizer) {
+    if(!tokenizer->wordLength) {
+        return;
+    }
+
+    if((tokenizer->wordCount / MNEMONIC_LENGTH) == tokenizer->wantedMnemonic) {
+        char* dest = tokenizer->mnemonics[tokenizer->wordCount % MNEMONIC_LENGTH];
+        memcpy(dest, tokenizer->word, tokenizer->wordLength);
+        dest[tokenizer->wordLength] = 0;
+    }
+
+    ++tokenizer->wordCount;
+    tokenizer->wordLength = 0;
+}
+
+static void tokenize_mnemonics(MnemonicTokenizer* tokenizer, const uint8_t* data, UINT length) {
+    for(UINT i = 0; i < length; ++i) {
+        char c = data[i];
+
+        if(tokenizer->inComment) {
+            tokenizer->inComment = (c != '\n');
+        } else if(c == MNEMONIC_COMMENT_CHAR) {
+            end_mnemonic_word(tokenizer);
+            tokenizer->inComment = true;
+        } else if(IS_MNEMONIC_CHAR(c) || IS_UPPER_CASE_CHAR(c)) {
+            if(tokenizer->wordLength == MAX_MNEMONIC_WORD_LENGTH) {
+                // No word list word is this long, and it would overflow the caller's array
+                tokenizer->wordTooLong = true;
+                return;
+            }
+
+            tokenizer->word[tokenizer->wordLength++] = IS_UPPER_CASE_CHAR(c) ? (c - 'A' + 'a') : c;
+        } else {
+            // Anything else (spaces, newlines, numbering, punctuation) separates words
+            end_mnemonic_word(tokenizer);
+        }
+    }
+}
+
+static wallet_error read_mnemonic_words(FIL* mnemonicsFile, MnemonicTokenizer* tokenizer) {
+    FRESULT readResult;
+    UINT bytesRead;
+
+    do {
+        readResult = f_read(mnemonicsFile, mnemonicReadBuffer, MNEMONIC_READ_SIZE, &bytesRead);
+        if(FR_OK != readResult) {
+            return WALLET_ERROR(WF_FATFS_ERROR, readResult);
+        }
+
+        tokenize_mnemonics(tokenizer, mnemonicReadBuffer, bytesRead);
+        if(tokenizer->wordTooLong) {
+            return WALLET_ERROR(WF_BAD_MNEMONIC_FILE_DATA, 0);
+        }
+    } while(bytesRead == MNEMONIC_READ_SIZE);
+
+    end_mnemonic_word(tokenizer);
+    return NO_ERROR;
+}
+
+static wallet_error parse_mnemonics(FIL* mnemonicsFile, uint32_t mnemonicIndex, char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1], uint32_t* mnemonicCount) {
+    MnemonicTokenizer tokenizer = {
+        .mnemonics = mnemonics,
+        .wantedMnemonic = mnemonicIndex
+    };
+
+    wallet_error err = read_mnemonic_words(mnemonicsFile, &tokenizer);
+
+    // Both hold raw seed phrase text, whether or not the file parsed
+    secure_zero(mnemonicReadBuffer, MNEMONIC_READ_SIZE);
+    secure_zero(tokenizer.word, sizeof(tokenizer.word));
+
+    if(NO_ERROR != err) {
+        return err;
+    }
+
+    // Every mnemonic must be complete, a stray word suggests the file isn't what we think it is
+    if((tokenizer.wordCount == 0) || (tokenizer.wordCount % MNEMONIC_LENGTH)) {
+        return WALLET_ERROR(WF_BAD_MNEMONIC_FILE_DATA, 0);
+    }
+
+    if(mnemonicCount) {
+        *mnemonicCount = (tokenizer.wordCount / MNEMONIC_LENGTH);
+    }
+
+    if(mnemonicIndex >= (tokenizer.wordCount / MNEMONIC_LENGTH)) {
+        return WALLET_ERROR(WF_BAD_MNEMONIC_FILE_DATA, 0);
     }
 
     return NO_ERROR;
 }
 
 wallet_error read_mnemonics_from_disk(char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1]) {
+    return read_mnemonics_from_disk_at(0, mnemonics, NULL);
+}
+
+wallet_error read_mnemonics_from_disk_at(uint32_t mnemonicIndex, char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1], uint32_t* mnemonicCount) {
     FIL mnemonicsFile;
-    FRESULT openResult, closeResult;
-    UINT bytesRead;
-    wallet_error readResult;
-    wallet_error returnValue = NO_ERROR;
-    int lineCount = 0, bytePos = 0;
+    FRESULT openResult;
+    wallet_error returnValue;
 
 
     // Open mnemonic file
@@ -209,64 +794,310 @@ wallet_error read_mnemonics_from_disk(char mnemonics[MNEMONIC_LENGTH][MAX_MNEMON
         }
     }
 
-    // Loop until we hit our first mnemonic char. This gets rid of any leading spaces or newlines or
-    // whatever
-    char c;
-    do {
-        readResult = f_read(&mnemonicsFile, &c, 1, &bytesRead);
-        if((FR_OK != readResult) || !bytesRead) {
-            return WALLET_ERROR(WF_FATFS_ERROR, readResult);
+    returnValue = parse_mnemonics(&mnemonicsFile, mnemonicIndex, mnemonics, mnemonicCount);
+
+    // The volume stays mounted, so the file must be closed whatever happened
+    close_wallet_file(&mnemonicsFile);
+
+    return returnValue;
+}
+
+wallet_error begin_wallet_export_file(FIL* file, const char* filename) {
+    FRESULT fr = open_wallet_file(file, 1, filename);
+    if(FR_OK != fr) {
+        printf("f_open(%s) error: %s (%d)\n", filename, FRESULT_str(fr), fr);
+        return WALLET_ERROR(WF_FAILED_TO_OPEN, fr);
+    }
+
+    // Opened at the start, so this drops anything from a previous export
+    fr = f_truncate(file);
+    if(FR_OK != fr) {
+        close_wallet_file(file);
+        return WALLET_ERROR(WF_FATFS_ERROR, fr);
+    }
+
+    return NO_ERROR;
+}
+
+wallet_error write_wallet_export_data(FIL* file, const uint8_t* data, uint32_t length) {
+    UINT bytesWritten;
+
+    FRESULT fr = f_write(file, data, length, &bytesWritten);
+    if(FR_OK != fr) {
+        return WALLET_ERROR(WF_FATFS_ERROR, fr);
+    } else if(bytesWritten != length) {
+        return WALLET_ERROR(WF_FATFS_ERROR, FR_DENIED);     // Card full
+    }
+
+    return NO_ERROR;
+}
+
+wallet_error end_wallet_export_file(FIL* file) {
+    FRESULT fr = close_wallet_file(file);
+    return (FR_OK == fr) ? NO_ERROR : WALLET_ERROR(WF_FATFS_ERROR, fr);
+}
+
+wallet_error read_wallet_file_at(const char* filename, uint32_t offset, uint8_t* data, uint32_t length) {
+    FIL file;
+    UINT bytesRead = 0;
+
+    FRESULT fr = open_wallet_file(&file, 0, filename);
+    if(FR_OK != fr) {
+        if((FR_NO_FILE == fr) || (FR_NO_PATH == fr)) {
+            return WALLET_ERROR(WF_FILE_NOT_FOUND, 0);
         }
-    } while(!IS_MNEMONIC_CHAR(c));
 
-    // Store initial mnemonic character
-    mnemonics[lineCount][bytePos++] = c;
+        return WALLET_ERROR(WF_FAILED_TO_OPEN, fr);
+    }
 
-    // Read remainder of file char by char
-    int terminate = 0;
-    do {
-        // Loop until we get something mnemonic-y
-        int gotSeparator = 0;
-        do {
-            readResult = f_read(&mnemonicsFile, &c, 1, &bytesRead);
-            if(FR_OK != readResult) {
-                // Error, close file and terminate with error
-                terminate = 1;
-            } else if(!bytesRead) {
-                // EOF, close file and terminate
-                terminate = 1;
-            } else if(!IS_MNEMONIC_CHAR(c)) {
-                // If we got a non-mnemonic char then that counts as a word separator.
-                gotSeparator = 1;
-            }
-        } while(!IS_MNEMONIC_CHAR(c) && !terminate);
+    // Reading, a seek past the end stops at the end, and the read comes up short
+    fr = f_lseek(&file, offset);
+    if(FR_OK == fr) {
+        fr = f_read(&file, data, length, &bytesRead);
+    }
+
+    close_wallet_file(&file);
+
+    if(FR_OK != fr) {
+        return WALLET_ERROR(WF_FATFS_ERROR, fr);
+    } else if(bytesRead != length) {
+        return WALLET_ERROR(WF_WALLET_FILE_CORRUPTED, 0);
+    }
+
+    return NO_ERROR;
+}
+
+wallet_error write_wallet_file_at(const char* filename, uint32_t offset, const uint8_t* data, uint32_t length) {
+    FIL file;
+    UINT bytesWritten = 0;
+
+    FRESULT fr = open_wallet_file(&file, 1, filename);
+    if(FR_OK != fr) {
+        printf("f_open(%s) error: %s (%d)\n", filename, FRESULT_str(fr), fr);
+        return WALLET_ERROR(WF_FAILED_TO_OPEN, fr);
+    }
+
+    fr = f_lseek(&file, offset);
+    if(FR_OK == fr) {
+        fr = f_write(&file, data, length, &bytesWritten);
+    }
+
+    FRESULT closeResult = close_wallet_file(&file);
+
+    if(FR_OK != fr) {
+        return WALLET_ERROR(WF_FATFS_ERROR, fr);
+    } else if(bytesWritten != length) {
+        return WALLET_ERROR(WF_FATFS_ERROR, FR_DENIED);     // Card full
+    } else if(FR_OK != closeResult) {
+        return WALLET_ERROR(WF_FATFS_ERROR, closeResult);
+    }
+
+    return NO_ERROR;
+}
+
+static void fill_benchmark_chunk(uint8_t* buffer, uint32_t chunk) {
+    for(uint32_t i = 0; i < BENCHMARK_CHUNK_SIZE; i += sizeof(uint32_t)) {
+        uint32_t value = (chunk * BENCHMARK_CHUNK_SIZE) + i;
+        memcpy(&buffer[i], &value, sizeof(value));
+    }
+}
+
+static bool check_benchmark_chunk(const uint8_t* buffer, uint32_t chunk) {
+    for(uint32_t i = 0; i < BENCHMARK_CHUNK_SIZE; i += sizeof(uint32_t)) {
+        uint32_t value = (chunk * BENCHMARK_CHUNK_SIZE) + i;
+        if(memcmp(&buffer[i], &value, sizeof(value))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void print_throughput(const char* name, uint32_t bytes, uint64_t timeUs) {
+    uint32_t kbPerSecond = timeUs ? (uint32_t) (((uint64_t) bytes * 1000000) / (timeUs * 1024)) : 0;
+    printf("SD %-6s %6lu KB in %6lu ms, %5lu KB/s\n", name, (unsigned long) (bytes / 1024),
+        (unsigned long) (timeUs / 1000), (unsigned long) kbPerSecond);
+}
+
+void run_sd_benchmark(uint32_t sizeKb) {
+    // Too big for the stack
+    static uint8_t buffer[BENCHMARK_CHUNK_SIZE];
+    uint32_t chunks = ((sizeKb * 1024) + BENCHMARK_CHUNK_SIZE - 1) / BENCHMARK_CHUNK_SIZE;
+    uint32_t bytes = chunks * BENCHMARK_CHUNK_SIZE;
+    uint64_t writeUs = 0, readUs = 0, startUs;
+    uint32_t badChunks = 0;
+    UINT transferred;
+    FIL file;
+
+
+    FRESULT fr = open_wallet_file(&file, 1, BENCHMARK_FILE);
+    if(FR_OK != fr) {
+        printf("SD benchmark: can't open %s: %s (%d)\n", BENCHMARK_FILE, FRESULT_str(fr), fr);
+        return;
+    }
+
+#if !PICO_NO_HARDWARE
+    printf("SD clock %u Hz (configured %u Hz, limit %u Hz)\n", SDCARD_SPI.baud_rate, SD_CARD.base_baud_rate, baudRateLimit);
+#endif
+
+    // Only the transfers are timed, not filling and checking the buffer
+    fr = f_truncate(&file);
+    for(uint32_t i = 0; (FR_OK == fr) && (i < chunks); ++i) {
+        fill_benchmark_chunk(buffer, i);
+
+        startUs = time_us_64();
+        fr = f_write(&file, buffer, BENCHMARK_CHUNK_SIZE, &transferred);
+        writeUs += time_us_64() - startUs;
+
+        if((FR_OK == fr) && (BENCHMARK_CHUNK_SIZE != transferred)) {
+            fr = FR_DENIED;         // Card full
+        }
+    }
+
+    if(FR_OK == fr) {
+        startUs = time_us_64();
+        fr = f_sync(&file);
+        writeUs += time_us_64() - startUs;
+    }
+
+    // Opened for writing only, so reopen it to read back
+    close_wallet_file(&file);
+    if(FR_OK == fr) {
+        fr = open_wallet_file(&file, 0, BENCHMARK_FILE);
+        if(FR_OK != fr) {
+            printf("SD benchmark: can't reopen %s: %s (%d)\n", BENCHMARK_FILE, FRESULT_str(fr), fr);
+            return;
+        }
 
-        // Check to see if we have reached a termination condition
-        if(terminate) {
-            if(FR_OK != readResult) {
-                return WALLET_ERROR(WF_FATFS_ERROR, readResult);
+        for(uint32_t i = 0; (FR_OK == fr) && (i < chunks); ++i) {
+            startUs = time_us_64();
+            fr = f_read(&file, buffer, BENCHMARK_CHUNK_SIZE, &transferred);
+            readUs += time_us_64() - startUs;
+
+            if((FR_OK == fr) && ((BENCHMARK_CHUNK_SIZE != transferred) || !check_benchmark_chunk(buffer, i))) {
+                ++badChunks;
             }
-            break;
         }
-        
-        // If we encountered separator characters, move on to the next mnemonic slot
-        if(gotSeparator) {
-            mnemonics[lineCount][bytePos] = 0;
-            ++lineCount;
-            bytePos = 0;
+
+        close_wallet_file(&file);
+    }
+
+    f_unlink(BENCHMARK_FILE);
+
+    if(FR_OK != fr) {
+        printf("SD benchmark error: %s (%d)\n", FRESULT_str(fr), fr);
+        return;
+    }
+
+    print_throughput("write", bytes, writeUs);
+    print_throughput("read", bytes, readUs);
+    printf("SD %lu of %lu chunks read back wrong\n", (unsigned long) badChunks, (unsigned long) chunks);
+}
+
+static void fill_container_benchmark_data(uint8_t* data, uint32_t slot, uint32_t version) {
+    for(uint32_t i = 0; i < SERIALIZED_WALLET_SIZE; ++i) {
+        data[i] = (uint8_t) ((slot * 31) + (version * 7) + i);
+    }
+}
+
+static bool check_container_benchmark_data(const uint8_t* data, uint32_t slot, uint32_t version) {
+    for(uint32_t i = 0; i < SERIALIZED_WALLET_SIZE; ++i) {
+        if(data[i] != (uint8_t) ((slot * 31) + (version * 7) + i)) {
+            return false;
         }
+    }
 
-        // Store our mnemonic char
-        mnemonics[lineCount][bytePos++] = c;
-    } while((lineCount < MNEMONIC_LENGTH) && (FR_OK == readResult));
+    return true;
+}
 
-    // We have finished reading the final word. Need to add in the final null-terminator
-    mnemonics[lineCount][bytePos] = 0;
+void run_wallet_container_benchmark(uint32_t slotCount) {
+    uint8_t data[SERIALIZED_WALLET_SIZE];
+    char label[16];
+    uint64_t appendUs, loadUs = 0, maxLoadUs = 0, replaceUs, findUs, startUs;
+    uint32_t badLoads = 0, replaced = 0, foundSlot = 0;
+    wallet_error err = NO_ERROR;
 
-    // Sanity check
-    if(lineCount != (MNEMONIC_LENGTH - 1)) {
-        return WALLET_ERROR(WF_BAD_MNEMONIC_FILE_DATA, 0);
+
+    if(slotCount > WALLET_CONTAINER_SLOTS) {
+        slotCount = WALLET_CONTAINER_SLOTS;
+    } else if(!slotCount) {
+        return;
     }
 
-    return NO_ERROR;
+    // Start from an empty container, whatever an earlier run left behind
+    FRESULT fr = ensure_mounted();
+    if(FR_OK == fr) {
+        fr = enter_wallet_directory();
+    }
+    if(FR_OK != fr) {
+        printf("Container benchmark: no volume: %s (%d)\n", FRESULT_str(fr), fr);
+        return;
+    }
+    f_unlink(CONTAINER_BENCHMARK_FILE);
+
+    // Only the container operations are timed, not making up and checking the data
+    appendUs = 0;
+    for(uint32_t slot = 0; (err == NO_ERROR) && (slot < slotCount); ++slot) {
+        fill_container_benchmark_data(data, slot, 0);
+        snprintf(label, sizeof(label), "bench%lu", (unsigned long) slot);
+
+        startUs = time_us_64();
+        err = save_wallet_to_container(CONTAINER_BENCHMARK_FILE, slot, label, data);
+        appendUs += time_us_64() - startUs;
+    }
+
+    // Visit the slots out of order, so each load has to seek
+    for(uint32_t i = 0; (err == NO_ERROR) && (i < slotCount); ++i) {
+        uint32_t slot = (i * 7919) % slotCount;
+
+        startUs = time_us_64();
+        err = load_wallet_from_container(CONTAINER_BENCHMARK_FILE, slot, data);
+        uint64_t timeUs = time_us_64() - startUs;
+
+        loadUs += timeUs;
+        if(timeUs > maxLoadUs) {
+            maxLoadUs = timeUs;
+        }
+        if((err == NO_ERROR) && !check_container_benchmark_data(data, slot, 0)) {
+            ++badLoads;
+        }
+    }
+
+    // Every tenth slot replaced in place, then read back
+    replaceUs = 0;
+    for(uint32_t slot = 0; (err == NO_ERROR) && (slot < slotCount); slot += 10) {
+        fill_container_benchmark_data(data, slot, 1);
+
+        startUs = time_us_64();
+        err = save_wallet_to_container(CONTAINER_BENCHMARK_FILE, slot, NULL, data);
+        replaceUs += time_us_64() - startUs;
+        ++replaced;
+    }
+    for(uint32_t slot = 0; (err == NO_ERROR) && (slot < slotCount); slot += 10) {
+        err = load_wallet_from_container(CONTAINER_BENCHMARK_FILE, slot, data);
+        if((err == NO_ERROR) && !check_container_benchmark_data(data, slot, 1)) {
+            ++badLoads;
+        }
+    }
+
+    // The last label is the worst case for a search of the index
+    snprintf(label, sizeof(label), "bench%lu", (unsigned long) (slotCount - 1));
+    startUs = time_us_64();
+    if(err == NO_ERROR) {
+        err = find_wallet_in_container(CONTAINER_BENCHMARK_FILE, label, &foundSlot);
+    }
+    findUs = time_us_64() - startUs;
+
+    f_unlink(CONTAINER_BENCHMARK_FILE);
+
+    if(err != NO_ERROR) {
+        printf("Container benchmark error: 0x%04X\n", err);
+        return;
+    }
+
+    printf("Container %lu slots, append %lu us each\n", (unsigned long) slotCount, (unsigned long) (appendUs / slotCount));
+    printf("Container load %lu us each, %lu us worst\n", (unsigned long) (loadUs / slotCount), (unsigned long) maxLoadUs);
+    printf("Container replace %lu us each (%lu slots)\n", (unsigned long) (replaceUs / replaced), (unsigned long) replaced);
+    printf("Container find by label %lu us (slot %lu)\n", (unsigned long) findUs, (unsigned long) foundSlot);
+    printf("Container %lu loads read back wrong\n", (unsigned long) badLoads);
 }
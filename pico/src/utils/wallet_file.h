@@ -5,9 +5,137 @@
 #include "seed_utils.h"
 
 
-wallet_error load_wallet_data_from_disk(uint8_t* data);
-wallet_error save_wallet_data_to_disk(const uint8_t* data);
+#define WALLET_CONTAINER_SLOTS      (1024)          // Fixed when a container is created, a multiple of 32 keeps records sector aligned
+#define DEFAULT_WALLET_SLOT         (0)
+
+typedef struct {
+    uint32_t mounts;                // Volume mounts (each one re-reads the FAT)
+    uint32_t unmounts;
+    uint32_t directoryChanges;      // f_chdir into the wallet directory
+    uint32_t opens;                 // Files opened successfully
+    uint32_t cardChanges;           // Sessions dropped because card detect saw the card come out
+    uint32_t clockFallbacks;        // Errors at a calibrated SD clock rate, each lowers the next calibration's limit
+} WalletStorageStats;
+
+
+/**
+ * Load an encrypted wallet (SERIALIZED_WALLET_SIZE bytes) from the wallet container, wallets.dat.
+ * Slot 0 falls back to the single wallet in wallet.dat, for cards written before containers. Built
+ * with WALLET_FLASH_STORAGE, slot 0 lives in reserved on-board flash (see flash_store.h) instead, and
+ * is moved there from the card the first time it is loaded
+ * 
+ * slot             in      Which wallet, below WALLET_CONTAINER_SLOTS
+ * data             out     The encrypted wallet
+ * 
+ * Returns WF_FILE_NOT_FOUND if the slot is empty
+ */
+wallet_error load_wallet_data_from_disk(uint32_t slot, uint8_t* data);
+
+/**
+ * Save an encrypted wallet to the wallet container, replacing whatever the slot held. An empty slot
+ * gets a new record at the end of the container, an occupied one is rewritten where it is
+ * 
+ * slot             in      Which wallet, below WALLET_CONTAINER_SLOTS
+ * label            in      Name to find the wallet by with find_wallet_slot(). NULL keeps the slot's
+ *                          current label. Not kept for a slot 0 held in flash
+ * data             in      The encrypted wallet
+ */
+wallet_error save_wallet_data_to_disk(uint32_t slot, const char* label, const uint8_t* data);
+
+/**
+ * Find the lowest slot saved with a label. Only a hash of the label is stored, so a match should be
+ * confirmed by decrypting the wallet
+ * 
+ * label            in      As passed to save_wallet_data_to_disk()
+ * slot             out     The slot
+ * 
+ * Returns WF_FILE_NOT_FOUND if no slot has the label
+ */
+wallet_error find_wallet_slot(const char* label, uint32_t* slot);
 wallet_error read_mnemonics_from_disk(char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1]);
 
+/**
+ * Read one of the mnemonics in mnemonic.txt. The file holds one or more mnemonics of MNEMONIC_LENGTH
+ * words each, in any layout. Words are separated by anything other than letters, and '#' starts a
+ * comment that runs to the end of the line
+ * 
+ * mnemonicIndex    in      Which mnemonic to read, from 0
+ * mnemonics        out     The mnemonic's words
+ * mnemonicCount    out     Number of mnemonics in the file. Optional
+ * 
+ * Returns WF_BAD_MNEMONIC_FILE_DATA if a word is too long, the file ends part way through a
+ * mnemonic, or there is no mnemonic at mnemonicIndex
+ */
+wallet_error read_mnemonics_from_disk_at(uint32_t mnemonicIndex, char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1], uint32_t* mnemonicCount);
+
+/**
+ * Create (or empty) a file in the wallet directory, to stream data into with
+ * write_wallet_export_data()
+ * 
+ * file             out     The open file
+ * filename         in      Name within the wallet directory
+ */
+wallet_error begin_wallet_export_file(FIL* file, const char* filename);
+
+/**
+ * Append to a file from begin_wallet_export_file(). Whole sectors written at a sector aligned
+ * offset go straight from data to the card as one multi-block transfer, bypassing FatFs's sector
+ * buffer, so callers streaming a lot of data should write in multiples of FF_MIN_SS
+ */
+wallet_error write_wallet_export_data(FIL* file, const uint8_t* data, uint32_t length);
+
+/**
+ * Close a file from begin_wallet_export_file(), flushing whatever is buffered
+ */
+wallet_error end_wallet_export_file(FIL* file);
+
+/**
+ * Read part of a file in the wallet directory, for files that are only ever used a record at a time
+ * 
+ * filename         in      Name within the wallet directory
+ * offset           in      Where to start reading
+ * data             out     The bytes read
+ * length           in      Number of bytes to read
+ * 
+ * Returns WF_FILE_NOT_FOUND if there is no such file, or WF_WALLET_FILE_CORRUPTED if it ends
+ * before offset + length
+ */
+wallet_error read_wallet_file_at(const char* filename, uint32_t offset, uint8_t* data, uint32_t length);
+
+/**
+ * Write part of a file in the wallet directory, creating the file if needed. Writing past the end
+ * grows the file, and the contents of any gap are undefined
+ * 
+ * filename         in      Name within the wallet directory
+ * offset           in      Where to start writing
+ * data             in      The bytes to write
+ * length           in      Number of bytes to write
+ */
+wallet_error write_wallet_file_at(const char* filename, uint32_t offset, const uint8_t* data, uint32_t length);
+
+/**
+ * The card is mounted on first use and stays mounted between file operations. End the session,
+ * e.g. before the card may be removed or at shutdown. The next file operation mounts it again
+ */
+void unmount_wallet_storage();
+
+const WalletStorageStats* get_wallet_storage_stats();
+
+/**
+ * Print the SD card's clock rate and file write and read throughput over stdio, for qualifying cards.
+ * Writes a scratch file in the wallet directory, reads it back and checks it, then deletes it
+ * 
+ * sizeKb           in      Amount to write and read back
+ */
+void run_sd_benchmark(uint32_t sizeKb);
+
+/**
+ * Print the time taken to append, load (in a scattered order), replace and search for wallets in a
+ * scratch container of slotCount wallets, over stdio. The scratch container is deleted afterwards
+ * 
+ * slotCount        in      Wallets to put in the container, at most WALLET_CONTAINER_SLOTS
+ */
+void run_wallet_container_benchmark(uint32_t slotCount);
+
 
 #endif      // _WALLET_FILE_H_
@@ -0,0 +1,299 @@
+#include "address_export.h"
+
+#include "utils/platform/task_scheduler.h"
+#include "utils/wallet_file.h"
+#include "utils/secure_zero.h"
+
+#include "pico/util/queue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#ifndef ADDRESS_EXPORT_BENCHMARK
+#define ADDRESS_EXPORT_BENCHMARK        (0)
+#endif
+
+#define ADDRESS_LINE_MAX_LENGTH         (160)
+
+static const char* const EXPORT_HEADER  = "path,p2pkh,p2wpkh\n";
+
+typedef struct {
+    uint8_t segment;
+    uint16_t length;
+} FilledSegment;
+
+// Core1 fills segments and queues them on filledQueue; core0 writes them out and hands them back
+// on freeQueue. The queues' spin locks order the segment contents between the cores
+static uint8_t segments[ADDRESS_EXPORT_SEGMENTS][ADDRESS_EXPORT_SEGMENT_SIZE] __attribute__((aligned(4)));
+static queue_t filledQueue;
+static queue_t freeQueue;
+static bool queuesInitialized = false;
+
+static AddressExportRange exportRange;
+static AddressExportStats exportStats;
+static FIL exportFile;
+static CryptoJobHandle exportJob = CRYPTO_INVALID_JOB;
+static bool exportRunning = false;
+static bool exportFinished = false;
+static wallet_error exportResult;
+static uint64_t exportStartUs;
+
+// Set by core0 when a write fails, so core1 stops generating lines nobody will write
+static volatile bool exportCancelled;
+
+// Set by core0 when the user stops the export. Unlike a failure, what has been generated is written
+static volatile bool exportStopRequested;
+
+
+static void reset_segment_queues() {
+    uint8_t segment;
+    FilledSegment filled;
+
+    if(!queuesInitialized) {
+        queue_init(&filledQueue, sizeof(FilledSegment), ADDRESS_EXPORT_SEGMENTS);
+        queue_init(&freeQueue, sizeof(uint8_t), ADDRESS_EXPORT_SEGMENTS);
+        queuesInitialized = true;
+    }
+
+    while(queue_try_remove(&filledQueue, &filled));
+    while(queue_try_remove(&freeQueue, &segment));
+
+    for(segment = 0; segment < ADDRESS_EXPORT_SEGMENTS; ++segment) {
+        queue_add_blocking(&freeQueue, &segment);
+    }
+}
+
+static void finish_export() {
+    wallet_error generatorResult = crypto_job_result(exportJob);
+    crypto_job_release(exportJob);
+    exportJob = CRYPTO_INVALID_JOB;
+
+    wallet_error closeResult = end_wallet_export_file(&exportFile);
+    if(NO_ERROR == exportResult) {
+        exportResult = (NO_ERROR != generatorResult) ? generatorResult : closeResult;
+    }
+
+    exportStats.totalTimeUs = time_us_64() - exportStartUs;
+    exportRunning = false;
+    exportFinished = true;
+
+#if ADDRESS_EXPORT_BENCHMARK
+    printf("Exported %lu addresses, %lu bytes in %lu segment writes: %lu ms writing, %lu ms total, "
+        "%lu generator stalls\n", (unsigned long) exportStats.addresses, (unsigned long) exportStats.bytesWritten,
+        (unsigned long) exportStats.segmentWrites, (unsigned long) (exportStats.writeTimeUs / 1000),
+        (unsigned long) (exportStats.totalTimeUs / 1000), (unsigned long) exportStats.generatorStalls);
+#endif
+}
+
+// Core0 half. Writes each segment core1 has filled, then hands it back to be filled again
+static TaskResult export_writer_task(int taskId, void* context) {
+    FilledSegment filled;
+
+    if(!exportRunning) {
+        return TASK_DONE;
+    }
+
+    // Sampled before draining: core1 queues its last segment before the job completes, so once the
+    // job is seen complete, the queue holds everything left to write
+    bool generatorDone = (crypto_job_status(exportJob) == CRYPTO_JOB_COMPLETE);
+
+    while(queue_try_remove(&filledQueue, &filled)) {
+        if(NO_ERROR == exportResult) {
+            uint64_t startUs = time_us_64();
+            exportResult = write_wallet_export_data(&exportFile, segments[filled.segment], filled.length);
+            exportStats.writeTimeUs += (time_us_64() - startUs);
+
+            if(NO_ERROR == exportResult) {
+                exportStats.bytesWritten += filled.length;
+                ++exportStats.segmentWrites;
+            } else {
+                exportCancelled = true;
+            }
+        }
+
+        // Handed back even after an error, so core1 never waits on it forever
+        queue_add_blocking(&freeQueue, &filled.segment);
+
+        if(scheduler_slice_expired()) {
+            return TASK_YIELD;
+        }
+    }
+
+    if(generatorDone) {
+        finish_export();
+        return TASK_DONE;
+    }
+
+    // Core1 can't wake this task, so poll for segments at about the rate it fills them
+    scheduler_set_timer(taskId, ADDRESS_EXPORT_POLL_INTERVAL_MS);
+    return TASK_WAIT;
+}
+
+// Core1 side: hand a full segment over to be written and take the next free one
+static uint8_t queue_segment(uint8_t segment, uint16_t length) {
+    FilledSegment filled = {
+        .segment = segment,
+        .length = length
+    };
+
+    queue_add_blocking(&filledQueue, &filled);
+
+    if(!queue_try_remove(&freeQueue, &segment)) {
+        ++exportStats.generatorStalls;
+        queue_remove_blocking(&freeQueue, &segment);
+    }
+
+    return segment;
+}
+
+static int format_address_line(char* line, const char* parentPath, uint32_t index, const ExtendedKey* key) {
+    int length = snprintf(line, ADDRESS_LINE_MAX_LENGTH, "%s/%lu,", parentPath, (unsigned long) index);
+
+    get_p2pkh_public_address(key, (uint8_t*) &line[length]);
+    length += strlen(&line[length]);
+    line[length++] = ',';
+
+    get_p2wpkh_public_address(key, (uint8_t*) &line[length]);
+    length += strlen(&line[length]);
+    line[length++] = '\n';
+
+    return length;
+}
+
+
+wallet_error start_address_export(HDWallet* wallet, const AddressExportRange* range, CryptoProgressCallback callback, void* context) {
+    if(exportRunning || (range->parentDepth > ADDRESS_EXPORT_MAX_PATH_DEPTH)) {
+        return WALLET_ERROR(WF_FAIL, 0);
+    }
+
+    wallet_error err = begin_wallet_export_file(&exportFile, ADDRESS_EXPORT_FILE);
+    if(NO_ERROR != err) {
+        return err;
+    }
+
+    memcpy(&exportRange, range, sizeof(AddressExportRange));
+    memset(&exportStats, 0, sizeof(exportStats));
+    reset_segment_queues();
+    exportCancelled = false;
+    exportStopRequested = false;
+    exportResult = NO_ERROR;
+    exportFinished = false;
+    exportStartUs = time_us_64();
+
+    // The writer is added first, as a job can't be withdrawn once submitted. It only runs on the next
+    // scheduler pass, and just ends if the export didn't get going
+    if(scheduler_add_task("export", export_writer_task, NULL) == SCHEDULER_INVALID_TASK) {
+        end_wallet_export_file(&exportFile);
+        return WALLET_ERROR(WF_FAIL, 0);
+    }
+
+    exportJob = crypto_worker_submit(CRYPTO_JOB_EXPORT_ADDRESSES, wallet, NULL, callback, context);
+    if(exportJob == CRYPTO_INVALID_JOB) {
+        end_wallet_export_file(&exportFile);
+        return WALLET_ERROR(WF_FAIL, 0);
+    }
+
+    exportRunning = true;
+    return NO_ERROR;
+}
+
+bool finish_address_export(wallet_error* result) {
+    if(!exportFinished) {
+        return false;
+    }
+
+    exportFinished = false;
+    *result = exportResult;
+    return true;
+}
+
+void cancel_address_export() {
+    if(exportRunning) {
+        exportStopRequested = true;
+    }
+}
+
+const AddressExportStats* get_address_export_stats() {
+    return &exportStats;
+}
+
+wallet_error generate_address_export(const HDWallet* wallet, WalletProgressFunction progress) {
+    ExtendedKey keys[2];
+    ExtendedKey childKey;
+    char parentPath[ADDRESS_LINE_MAX_LENGTH / 2];
+    char line[ADDRESS_LINE_MAX_LENGTH];
+    int currentKey = 0;
+    int pathLength;
+    uint8_t segment;
+    uint16_t segmentLength = 0;
+    uint8_t lastPercent = 0;
+
+
+    queue_remove_blocking(&freeQueue, &segment);
+
+    // Down to the parent of the exported keys, building its path for the first column as it goes
+    memcpy(&keys[currentKey], &wallet->baseKey44, sizeof(ExtendedKey));
+    pathLength = snprintf(parentPath, sizeof(parentPath), "m/%d'", BASE_KEY_INDEX);
+    for(int i = 0; i < exportRange.parentDepth; ++i) {
+        uint32_t index = exportRange.parentPath[i];
+        bool hardened = (index & HARDENED_CHILD_INDEX_OFFSET);
+
+        derive_child_key(&keys[currentKey], (index & ~HARDENED_CHILD_INDEX_OFFSET), hardened, &keys[currentKey ^ 1]);
+        currentKey ^= 1;
+
+        pathLength += snprintf(&parentPath[pathLength], (sizeof(parentPath) - pathLength), "/%lu%s",
+            (unsigned long) (index & ~HARDENED_CHILD_INDEX_OFFSET), (hardened ? "'" : ""));
+    }
+
+    for(uint32_t i = 0; (i <= exportRange.count) && !exportCancelled && !exportStopRequested; ++i) {
+        int lineLength;
+
+        // Line 0 is the header
+        if(i == 0) {
+            lineLength = strlen(EXPORT_HEADER);
+            memcpy(line, EXPORT_HEADER, lineLength);
+        } else {
+            uint32_t index = exportRange.firstIndex + (i - 1);
+            derive_child_key(&keys[currentKey], index, false, &childKey);
+            lineLength = format_address_line(line, parentPath, index, &childKey);
+            ++exportStats.addresses;
+        }
+
+        // Lines run on from one segment into the next, the file is just a stream of them
+        const char* linePtr = line;
+        while(lineLength) {
+            int copyLength = ADDRESS_EXPORT_SEGMENT_SIZE - segmentLength;
+            if(copyLength > lineLength) {
+                copyLength = lineLength;
+            }
+
+            memcpy(&segments[segment][segmentLength], linePtr, copyLength);
+            segmentLength += copyLength;
+            linePtr += copyLength;
+            lineLength -= copyLength;
+
+            if(segmentLength == ADDRESS_EXPORT_SEGMENT_SIZE) {
+                segment = queue_segment(segment, segmentLength);
+                segmentLength = 0;
+            }
+        }
+
+        uint8_t percent = (uint8_t) (((uint64_t) i * 100) / (exportRange.count ? exportRange.count : 1));
+        if(progress && (percent != lastPercent)) {
+            progress(percent);
+            lastPercent = percent;
+        }
+    }
+
+    // The tail is the only write that isn't whole sectors
+    if(segmentLength && !exportCancelled) {
+        queue_segment(segment, segmentLength);
+    }
+
+    secure_zero(keys, sizeof(keys));
+    secure_zero(&childKey, sizeof(childKey));
+    exportStats.stopped = exportStopRequested && (exportStats.addresses < exportRange.count);
+
+    return exportCancelled ? WALLET_ERROR(WF_FAILED_TO_WRITE_KEY_DATA, 0) : NO_ERROR;
+}
@@ -0,0 +1,78 @@
+#ifndef _ADDRESS_EXPORT_H_
+#define _ADDRESS_EXPORT_H_
+
+#include "hd_wallet.h"
+#include "crypto_worker.h"
+#include "pico/stdlib.h"
+
+
+#define ADDRESS_EXPORT_FILE             ("addresses.csv")
+#define ADDRESS_EXPORT_SEGMENT_SIZE     (8 * 512)   // Whole sectors, each segment is one multi-block write
+#define ADDRESS_EXPORT_SEGMENTS         (3)         // One being written, one being filled, one spare
+#define ADDRESS_EXPORT_MAX_PATH_DEPTH   (4)
+#define ADDRESS_EXPORT_DEFAULT_COUNT    (1000)
+#define ADDRESS_EXPORT_POLL_INTERVAL_MS (5)
+
+typedef struct {
+    uint32_t parentPath[ADDRESS_EXPORT_MAX_PATH_DEPTH];     // From the BIP44 base key, hardened offsets applied
+    uint8_t parentDepth;
+    uint32_t firstIndex;                                    // Of the (non-hardened) children exported
+    uint32_t count;
+} AddressExportRange;
+
+// Counted on both cores, so only settled once the export has finished
+typedef struct {
+    uint32_t addresses;             // Addresses generated so far
+    uint32_t bytesWritten;
+    uint32_t segmentWrites;
+    uint32_t generatorStalls;       // Times core1 had to wait for the card to free a segment
+    bool stopped;                   // Cut short by cancel_address_export()
+    uint64_t writeTimeUs;           // Spent in the file writes
+    uint64_t totalTimeUs;           // From start to the file being closed
+} AddressExportStats;
+
+
+/**
+ * Start writing the P2PKH and P2WPKH addresses of a range of child keys, with their paths, to
+ * ADDRESS_EXPORT_FILE in the wallet directory. The keys are derived and formatted on core1 into a
+ * ring of sector aligned segments, while a scheduler task on core0 writes the segments already
+ * filled, so derivation and the card's writes overlap
+ *
+ * The wallet belongs to core1, as for crypto_worker_submit(), until finish_address_export() has
+ * returned true
+ * 
+ * wallet               in      Wallet whose keys are exported
+ * range                in      Keys to export
+ * callback             in      Progress callback, may be NULL
+ * context              in      Passed to the callback
+ *
+ * Returns an error if an export is already running, the file couldn't be created, or the crypto
+ * worker is busy
+ */
+wallet_error start_address_export(HDWallet* wallet, const AddressExportRange* range, CryptoProgressCallback callback, void* context);
+
+/**
+ * Returns false while an export is running. Once it has finished, returns true (once) with the
+ * export's result
+ */
+bool finish_address_export(wallet_error* result);
+
+/**
+ * Stop a running export early. Core1 stops after the address it is on, and the lines already
+ * generated are still written, so the file ends on a whole line. finish_address_export() reports
+ * as usual, and the stats show the export as stopped
+ */
+void cancel_address_export();
+
+const AddressExportStats* get_address_export_stats();
+
+/**
+ * The core1 half, run by the crypto worker for CRYPTO_JOB_EXPORT_ADDRESSES. Not to be called directly
+ * 
+ * wallet               in      As passed to start_address_export()
+ * progress             in      Told the share of the range done so far
+ */
+wallet_error generate_address_export(const HDWallet* wallet, WalletProgressFunction progress);
+
+
+#endif      // _ADDRESS_EXPORT_H_
@@ -0,0 +1,191 @@
+#include "crypto_worker.h"
+#include "address_export.h"
+
+#include "utils/platform/task_scheduler.h"
+
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+
+
+// Core1 only ever sees a job through the request queue, and core0 only learns about its progress
+// through the response queue. The queues' spin locks order everything else written to the job table
+typedef struct {
+    uint8_t job;
+    uint8_t percent;
+    bool complete;
+    wallet_error result;
+} CryptoResponse;
+
+typedef struct {
+    bool inUse;
+    CryptoJobType type;
+    HDWallet* wallet;
+    uint8_t* data;
+    CryptoProgressCallback callback;
+    void* context;
+
+    // Only written on core0, from the responses
+    CryptoJobStatus status;
+    uint8_t progress;
+    wallet_error result;
+} CryptoJob;
+
+static CryptoJob jobs[CRYPTO_WORKER_MAX_JOBS];
+static queue_t requestQueue;
+static queue_t responseQueue;
+static uint32_t core1Stack[CRYPTO_WORKER_STACK_SIZE / sizeof(uint32_t)];
+static int pollTaskId = SCHEDULER_INVALID_TASK;
+
+// Job core1 is running, for reporting the hd_wallet progress against
+static uint8_t runningJob;
+
+
+static bool is_valid_job(CryptoJobHandle job) {
+    return (job >= 0) && (job < CRYPTO_WORKER_MAX_JOBS) && jobs[job].inUse;
+}
+
+static void post_progress(uint8_t job, uint8_t percent) {
+    CryptoResponse response = {
+        .job = job,
+        .percent = percent,
+        .complete = false
+    };
+
+    // Progress is only cosmetic, and a later report replaces it anyway, so it is dropped rather
+    // than holding up the job when core0 is behind
+    queue_try_add(&responseQueue, &response);
+}
+
+static void on_wallet_progress(uint8_t percent) {
+    // The hd_wallet functions can still be called directly on core0, those calls aren't jobs
+    if(get_core_num() == 1) {
+        post_progress(runningJob, percent);
+    }
+}
+
+static wallet_error run_job(const CryptoJob* job) {
+    switch(job->type) {
+        case CRYPTO_JOB_INIT_NEW_WALLET:
+            init_new_wallet(job->wallet, 0, 0, 0);
+            return NO_ERROR;
+        case CRYPTO_JOB_DECRYPT_WALLET_DATA:
+            return decrypt_wallet_data(job->data, job->wallet);
+        case CRYPTO_JOB_RESTORE_FROM_MNEMONIC:
+            return restore_wallet_from_mnemonic(job->wallet);
+        case CRYPTO_JOB_ENCRYPT_WALLET_DATA:
+            encrypt_wallet_data(job->wallet, job->data);
+            return NO_ERROR;
+        case CRYPTO_JOB_EXPORT_ADDRESSES:
+            return generate_address_export(job->wallet, on_wallet_progress);
+    }
+
+    return WALLET_ERROR(WF_FAIL, 0);
+}
+
+static void crypto_worker_main() {
+    // Lets core0 hold this core (in RAM) while it erases or programs flash, see flash_store.h
+    multicore_lockout_victim_init();
+    set_wallet_progress_function(on_wallet_progress);
+
+    while(true) {
+        queue_remove_blocking(&requestQueue, &runningJob);
+        post_progress(runningJob, 0);
+
+        CryptoResponse response = {
+            .job = runningJob,
+            .percent = 100,
+            .complete = true,
+            .result = run_job(&jobs[runningJob])
+        };
+
+        // Completion must get through, or core0 would wait on the job forever
+        queue_add_blocking(&responseQueue, &response);
+    }
+}
+
+static bool has_outstanding_jobs() {
+    for(int i = 0; i < CRYPTO_WORKER_MAX_JOBS; ++i) {
+        if(jobs[i].inUse && (jobs[i].status != CRYPTO_JOB_COMPLETE)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Core1 can't wake a core0 task directly, so this polls for responses while there are jobs in flight
+static TaskResult poll_task(int taskId, void* context) {
+    CryptoResponse response;
+
+    while(queue_try_remove(&responseQueue, &response)) {
+        CryptoJob* job = &jobs[response.job];
+
+        job->status = response.complete ? CRYPTO_JOB_COMPLETE : CRYPTO_JOB_RUNNING;
+        job->progress = response.percent;
+        if(response.complete) {
+            job->result = response.result;
+        }
+
+        if(job->callback) {
+            job->callback(response.job, response.percent, job->context);
+        }
+    }
+
+    if(has_outstanding_jobs()) {
+        scheduler_set_timer(taskId, CRYPTO_WORKER_POLL_INTERVAL_MS);
+    }
+
+    return TASK_WAIT;
+}
+
+
+void crypto_worker_init() {
+    queue_init(&requestQueue, sizeof(uint8_t), CRYPTO_WORKER_MAX_JOBS);
+    queue_init(&responseQueue, sizeof(CryptoResponse), (CRYPTO_WORKER_MAX_JOBS * 4));
+
+    pollTaskId = scheduler_add_task("crypto", poll_task, NULL);
+    multicore_launch_core1_with_stack(crypto_worker_main, core1Stack, sizeof(core1Stack));
+}
+
+CryptoJobHandle crypto_worker_submit(CryptoJobType type, HDWallet* wallet, uint8_t* data, CryptoProgressCallback callback, void* context) {
+    for(int i = 0; i < CRYPTO_WORKER_MAX_JOBS; ++i) {
+        if(!jobs[i].inUse) {
+            jobs[i] = (CryptoJob) {
+                .inUse = true,
+                .type = type,
+                .wallet = wallet,
+                .data = data,
+                .callback = callback,
+                .context = context,
+                .status = CRYPTO_JOB_QUEUED
+            };
+
+            // Never blocks, there are never more jobs queued than the queue holds
+            uint8_t job = i;
+            queue_add_blocking(&requestQueue, &job);
+            scheduler_wake_task(pollTaskId);
+
+            return i;
+        }
+    }
+
+    return CRYPTO_INVALID_JOB;
+}
+
+CryptoJobStatus crypto_job_status(CryptoJobHandle job) {
+    return is_valid_job(job) ? jobs[job].status : CRYPTO_JOB_COMPLETE;
+}
+
+uint8_t crypto_job_progress(CryptoJobHandle job) {
+    return is_valid_job(job) ? jobs[job].progress : 0;
+}
+
+wallet_error crypto_job_result(CryptoJobHandle job) {
+    return is_valid_job(job) ? jobs[job].result : WALLET_ERROR(WF_FAIL, 0);
+}
+
+void crypto_job_release(CryptoJobHandle job) {
+    if(is_valid_job(job) && (jobs[job].status == CRYPTO_JOB_COMPLETE)) {
+        jobs[job].inUse = false;
+    }
+}
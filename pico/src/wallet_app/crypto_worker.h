@@ -0,0 +1,74 @@
+#ifndef _CRYPTO_WORKER_H_
+#define _CRYPTO_WORKER_H_
+
+#include "wallet_app/hd_wallet.h"
+#include "pico/stdlib.h"
+
+
+#define CRYPTO_WORKER_MAX_JOBS          (4)
+#define CRYPTO_WORKER_STACK_SIZE        (8 * 1024)      // Core1 stack, in bytes. Key derivation is stack hungry
+#define CRYPTO_WORKER_POLL_INTERVAL_MS  (10)
+#define CRYPTO_INVALID_JOB              (-1)
+
+typedef int CryptoJobHandle;
+
+// Each job runs the hd_wallet function of the same name on core1. None of them touch the disk, the
+// address export only hands its output to core0 to be written
+typedef enum {
+    CRYPTO_JOB_INIT_NEW_WALLET,         // wallet
+    CRYPTO_JOB_DECRYPT_WALLET_DATA,     // data (encrypted wallet bytes) -> wallet and its cacheKey, wallet->password set
+    CRYPTO_JOB_RESTORE_FROM_MNEMONIC,   // wallet, wallet->mnemonicSentence set
+    CRYPTO_JOB_ENCRYPT_WALLET_DATA,     // wallet -> data, and the wallet's cacheKey
+    CRYPTO_JOB_EXPORT_ADDRESSES         // wallet, the generating half of start_address_export()
+} CryptoJobType;
+
+typedef enum {
+    CRYPTO_JOB_QUEUED,
+    CRYPTO_JOB_RUNNING,
+    CRYPTO_JOB_COMPLETE
+} CryptoJobStatus;
+
+/**
+ * Called on core0 as a job progresses, and once more with 100 percent when it completes
+ *
+ * job                  in      The job
+ * percent              in      Rough share of the job done so far
+ * context              in/out  As passed to crypto_worker_submit()
+ */
+typedef void (*CryptoProgressCallback)(CryptoJobHandle job, uint8_t percent, void* context);
+
+
+/**
+ * Start the worker on core1, and the scheduler task on core0 that delivers its progress
+ */
+void crypto_worker_init();
+
+/**
+ * Queue a job for core1. The wallet and data belong to core1 until the job is complete, so must not
+ * be touched (or go out of scope) before then
+ *
+ * type                 in      What to run
+ * wallet               in/out  Wallet the job works on
+ * data                 in/out  SERIALIZED_WALLET_SIZE bytes for the jobs that use them, otherwise NULL
+ * callback             in      Progress callback, may be NULL
+ * context              in      Passed to the callback
+ *
+ * Returns the job's handle, or CRYPTO_INVALID_JOB if there are already CRYPTO_WORKER_MAX_JOBS jobs
+ */
+CryptoJobHandle crypto_worker_submit(CryptoJobType type, HDWallet* wallet, uint8_t* data, CryptoProgressCallback callback, void* context);
+
+CryptoJobStatus crypto_job_status(CryptoJobHandle job);
+
+// Last progress reported by the job, 0-100
+uint8_t crypto_job_progress(CryptoJobHandle job);
+
+// Result of a complete job. Jobs that can't fail return NO_ERROR
+wallet_error crypto_job_result(CryptoJobHandle job);
+
+/**
+ * Free a complete job's handle for reuse
+ */
+void crypto_job_release(CryptoJobHandle job);
+
+
+#endif      // _CRYPTO_WORKER_H_
@@ -1,6 +1,5 @@
 #include "hd_wallet.h"
 
-#include "cryptography/cifra/pbkdf2.h"
 #include "cryptography/cifra/sha2.h"
 #include "cryptography/cifra/aes.h"
 #include "cryptography/uECC/uECC.h"
@@ -43,13 +42,60 @@ const uint16_t WALLET_VERSION  = ((WALLET_VERSION_MAJOR << 8) | WALLET_VERSION_M
 
 
 #define PASSWORD_BLOCK_LENGTH   (16)
+#define PASSWORD_HASH_ITERATIONS    (2048)
+#define PASSWORD_HASH_STEP          (128)       // Iterations between progress reports
 #define VALIDATION_BYTES_LENGTH (PBKDF2_HMAC_SHA256_SIZE - PASSWORD_BLOCK_LENGTH)
-#define BASE_KEY_INDEX          (44)
+#define CACHE_KEY_LABEL         "pubkey cache"
 
 
 // Work variables
 static cf_aes_context aesContext;
 static uint8_t walletSerializationBuffer[SERIALIZED_WALLET_SIZE];
+static WalletProgressFunction progressFunction;
+static uint8_t seedProgressEnd;
+
+
+static void report_progress(uint8_t percent) {
+    if(progressFunction) {
+        progressFunction(percent);
+    }
+}
+
+// Hash the password in steps, moving the reported progress from 0 up to progressEnd as it goes
+static void hash_wallet_password(const uint8_t* password, uint8_t* passwordHash, uint8_t progressEnd) {
+    Pbkdf2State state;
+
+    begin_wallet_password_hash(&state, password, passwordHash);
+    while(!pbkdf2_step(&state, PASSWORD_HASH_STEP)) {
+        report_progress((pbkdf2_percent(&state) * progressEnd) / 100);
+    }
+    report_progress(progressEnd);
+}
+
+// The seed derivation reports 0-100, moved into the share of the job it takes up (0 to seedProgressEnd)
+static void on_seed_progress(uint8_t percent) {
+    report_progress((percent * seedProgressEnd) / 100);
+}
+
+static void begin_seed_progress(uint8_t progressEnd) {
+    seedProgressEnd = progressEnd;
+    set_seed_progress_function(on_seed_progress);
+}
+
+static void end_seed_progress() {
+    set_seed_progress_function(NULL);
+    report_progress(seedProgressEnd);
+}
+
+// The chain code goes in too, so another wallet with the same password can't read this one's cache
+static void derive_cache_key(const uint8_t* passwordHash, HDWallet* wallet) {
+    cf_hmac_ctx hmacContext;
+
+    cf_hmac_init(&hmacContext, &cf_sha256, passwordHash, PBKDF2_HMAC_SHA256_SIZE);
+    cf_hmac_update(&hmacContext, (const uint8_t*) CACHE_KEY_LABEL, strlen(CACHE_KEY_LABEL));
+    cf_hmac_update(&hmacContext, wallet->masterKey.chainCode, CHAIN_CODE_LENGTH);
+    cf_hmac_finish(&hmacContext, wallet->cacheKey);
+}
 
 
 int serialize_wallet(const HDWallet* wallet, uint8_t* dest, uint8_t* validationBytes) {
@@ -107,6 +153,11 @@ wallet_error deserialize_wallet(const uint8_t* src, HDWallet* wallet, uint8_t* v
         return WALLET_ERROR(WF_FILE_VERSION_MISMATCH, 0);
     }
 
+    // Master key base variables
+    wallet->masterKey.depth = 0;
+    wallet->masterKey.index = 0;
+    memset(wallet->masterKey.parentFingerprint, 0, FINGERPRINT_LENGTH);
+
     // Read private key
     memcpy(wallet->masterKey.privateKey, privateKeyPtr, PRIVATE_KEY_LENGTH);
 
@@ -120,6 +171,10 @@ wallet_error deserialize_wallet(const uint8_t* src, HDWallet* wallet, uint8_t* v
         memcpy(&(wallet->masterKey.publicKey[1]), workBuffer, (PUBLIC_KEY_LENGTH - 1));
     }
 
+    // Get fingerprint
+    hash_160(wallet->masterKey.publicKey, PUBLIC_KEY_LENGTH, workBuffer);
+    memcpy(wallet->masterKey.fingerprint, workBuffer, FINGERPRINT_LENGTH);
+
     // Read mnemonic
     for(int i = 0; i < MNEMONIC_LENGTH; ++i) {
         strncpy(wallet->mnemonicSentence[i], mnemonicPtr, MAX_MNEMONIC_WORD_LENGTH + 1);
@@ -131,7 +186,10 @@ wallet_error deserialize_wallet(const uint8_t* src, HDWallet* wallet, uint8_t* v
 
 
 int init_new_wallet(HDWallet* wallet, const uint8_t* password, const uint8_t* mnemonic, int mnemonicLen) {
+    begin_seed_progress(50);
     generate_master_key(mnemonic, mnemonicLen, &wallet->masterKey, wallet->mnemonicSentence);
+    end_seed_progress();
+
     set_wallet_password(wallet, password);
     derive_child_key(&wallet->masterKey, BASE_KEY_INDEX, true, &wallet->baseKey44);
     return 1;
@@ -145,13 +203,7 @@ wallet_error decrypt_wallet_data(uint8_t* data, HDWallet* dest) {
     int decryptCount = 0;
 
     // Get password hash
-    cf_pbkdf2_hmac(
-        dest->password, USER_PASSWORD_LENGTH, 
-        PASSCODE_SALT, strlen(PASSCODE_SALT), 
-        2048, 
-        passwordHash, PBKDF2_HMAC_SHA256_SIZE,
-        &cf_sha256
-    );
+    hash_wallet_password(dest->password, passwordHash, 30);
 
     // Decrypt the wallet bytes
     cf_aes_init(&aesContext, passwordHash, PBKDF2_HMAC_SHA256_SIZE);
@@ -168,6 +220,8 @@ wallet_error decrypt_wallet_data(uint8_t* data, HDWallet* dest) {
     if(deserializeResult != NO_ERROR) {
         return deserializeResult;
     }
+    derive_cache_key(passwordHash, dest);
+    report_progress(60);
 
     // Get the BIP44 m/44' base key
     derive_child_key(&dest->masterKey, BASE_KEY_INDEX, true, &dest->baseKey44);
@@ -177,43 +231,50 @@ wallet_error decrypt_wallet_data(uint8_t* data, HDWallet* dest) {
 
 wallet_error recover_wallet(HDWallet* wallet) {
     wallet_error readMnemonicResult;
-    char mnemonics[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1];
 
     readMnemonicResult = read_mnemonics_from_disk(wallet->mnemonicSentence);
     if(readMnemonicResult != NO_ERROR) {
         return readMnemonicResult;
     }
 
+    return restore_wallet_from_mnemonic(wallet);
+}
+
+wallet_error restore_wallet_from_mnemonic(HDWallet* wallet) {
     // Make sure the mnemonic is valid
     if(!validate_mnemonic(wallet->mnemonicSentence)) {
         return WALLET_ERROR(WF_MNEMONIC_CHECKSUM_INVALID, 0);
     }
 
     // Build keys
+    begin_seed_progress(60);
     generate_master_key_from_mnemonic(wallet->mnemonicSentence, &wallet->masterKey);
+    end_seed_progress();
+
     derive_child_key(&wallet->masterKey, BASE_KEY_INDEX, true, &wallet->baseKey44);
 
     return NO_ERROR;
 }
 
-wallet_error save_wallet(const HDWallet* wallet) {
+wallet_error save_wallet(HDWallet* wallet) {
+    encrypt_wallet_data(wallet, walletSerializationBuffer);
+
+    // Save to disk
+    return save_wallet_data_to_disk(DEFAULT_WALLET_SLOT, NULL, walletSerializationBuffer);
+}
+
+void encrypt_wallet_data(HDWallet* wallet, uint8_t* dest) {
     uint8_t passwordHash[PBKDF2_HMAC_SHA256_SIZE];
     uint8_t aesBlock[AES_BLOCKSZ];
-    uint8_t paddedPassword[PASSWORD_BLOCK_LENGTH];
-    uint8_t* encryptPtr = walletSerializationBuffer;
+    uint8_t* encryptPtr = dest;
     int encryptCount = 0;
 
     // Get password hash
-    cf_pbkdf2_hmac(
-        wallet->password, USER_PASSWORD_LENGTH, 
-        PASSCODE_SALT, strlen(PASSCODE_SALT), 
-        2048, 
-        passwordHash, PBKDF2_HMAC_SHA256_SIZE,
-        &cf_sha256
-    );
+    hash_wallet_password(wallet->password, passwordHash, 80);
+    derive_cache_key(passwordHash, wallet);
 
     // Serialize wallet to raw bytes
-    serialize_wallet(wallet, walletSerializationBuffer, (passwordHash + PASSWORD_BLOCK_LENGTH));
+    serialize_wallet(wallet, dest, (passwordHash + PASSWORD_BLOCK_LENGTH));
 
     // Encrypt
     cf_aes_init(&aesContext, passwordHash, PBKDF2_HMAC_SHA256_SIZE);
@@ -224,9 +285,16 @@ wallet_error save_wallet(const HDWallet* wallet) {
         encryptPtr += AES_BLOCKSZ;
     }
     cf_aes_finish(&aesContext);
+}
 
-    // Save to disk
-    return save_wallet_data_to_disk(walletSerializationBuffer);
+void begin_wallet_password_hash(Pbkdf2State* state, const uint8_t* password, uint8_t* passwordHash) {
+    pbkdf2_init(
+        state, &cf_sha256,
+        password, USER_PASSWORD_LENGTH, 
+        PASSCODE_SALT, strlen(PASSCODE_SALT), 
+        PASSWORD_HASH_ITERATIONS, 
+        passwordHash, PBKDF2_HMAC_SHA256_SIZE
+    );
 }
 
 void set_wallet_password(HDWallet* wallet, const uint8_t* password) {
@@ -234,3 +302,7 @@ void set_wallet_password(HDWallet* wallet, const uint8_t* password) {
         memcpy(wallet->password, password, USER_PASSWORD_LENGTH);
     }
 }
+
+void set_wallet_progress_function(WalletProgressFunction function) {
+    progressFunction = function;
+}
@@ -3,11 +3,13 @@
 
 #include "wallet_defs.h"
 #include "utils/key_utils.h"
+#include "utils/hash_utils.h"
 
 #include <stdint.h>
 
 
 #define SERIALIZED_WALLET_SIZE            (304)
+#define BASE_KEY_INDEX                    (44)              // BIP44 "purpose" index (hardened) of baseKey44
 
 extern const uint16_t WALLET_VERSION;
 
@@ -15,9 +17,13 @@ typedef struct {
     ExtendedKey masterKey;                              // The root, master key
     ExtendedKey baseKey44;                              // BIP44 Base key from which all keys derive ("purpose" = 44)
     uint8_t password[USER_PASSWORD_LENGTH];             // Encryption password/key
+    uint8_t cacheKey[PBKDF2_HMAC_SHA256_SIZE];          // Public key cache key, set alongside the password hash
     char mnemonicSentence[MNEMONIC_LENGTH][MAX_MNEMONIC_WORD_LENGTH + 1];
 } HDWallet;
 
+// Rough share (0-100) of a long running operation that has been done so far
+typedef void (*WalletProgressFunction)(uint8_t percent);
+
 
 /**
  * Create a new wallet with a brand new master key
@@ -30,7 +36,8 @@ typedef struct {
 int init_new_wallet(HDWallet* wallet, const uint8_t* password, const uint8_t* mnemonic, int mnemonicLen);
 
 /**
- * Decrypt the proided wallet bytes (i.e. bytes loaded from disk) into a usable wallet instance
+ * Decrypt the proided wallet bytes (i.e. bytes loaded from disk) into a usable wallet instance. Also
+ * sets the wallet's cacheKey
  *
  * data             in      Pointer to the encrypted serialied wallet bytes     
  * wallet           out     The wallet to be configured
@@ -44,14 +51,40 @@ wallet_error decrypt_wallet_data(uint8_t* data, HDWallet* dest);
  */
 wallet_error recover_wallet(HDWallet* wallet);
 
+/**
+ * Rebuild a wallet's keys from its mnemonic sentence. The crypto half of recover_wallet(), without
+ * the disk access
+ * 
+ * wallet           in/out  The wallet to be recovered, with mnemonicSentence already filled in
+ */
+wallet_error restore_wallet_from_mnemonic(HDWallet* wallet);
+
 /**
  * Encrypt and save the supplied wallet to disk
  * 
  * wallet           in      The wallet to be saved
  */
-wallet_error save_wallet(const HDWallet* wallet);
+wallet_error save_wallet(HDWallet* wallet);
+
+/**
+ * Encrypt the supplied wallet into the bytes save_wallet() would write to disk
+ * 
+ * wallet           in/out  The wallet to be encrypted. Its cacheKey is set from the new password hash
+ * dest             out     SERIALIZED_WALLET_SIZE bytes of encrypted wallet data
+ */
+void encrypt_wallet_data(HDWallet* wallet, uint8_t* dest);
 
 
+/**
+ * Start hashing a wallet password into its encryption key, to be run to completion with
+ * pbkdf2_step(). decrypt_wallet_data() and encrypt_wallet_data() do this internally
+ * 
+ * state            out     Derivation state
+ * password         in      Pointer to 8-character password
+ * passwordHash     out     PBKDF2_HMAC_SHA256_SIZE bytes, written as the derivation completes
+ */
+void begin_wallet_password_hash(Pbkdf2State* state, const uint8_t* password, uint8_t* passwordHash);
+
 /**
  * Store the encryption password for the supplied wallet
  * 
@@ -60,5 +93,13 @@ wallet_error save_wallet(const HDWallet* wallet);
  */
 void set_wallet_password(HDWallet* wallet, const uint8_t* password);
 
+/**
+ * Set a function to be told how far init_new_wallet(), decrypt_wallet_data(), 
+ * restore_wallet_from_mnemonic() and encrypt_wallet_data() have got. NULL for none
+ * 
+ * function         in      Called from whichever core is running the operation
+ */
+void set_wallet_progress_function(WalletProgressFunction function);
+
 
 #endif      // _HD_WALLET_H_
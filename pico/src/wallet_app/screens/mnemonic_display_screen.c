@@ -55,7 +55,7 @@ void draw_mnemonic_display_screen(WalletScreen* screen) {
             xPos = leftMnemonicX;
         }
 
-        wallet_gfx_draw_string(xPos, yPos, data->mnemonicSentence[i], strlen(data->mnemonicSentence[i]), drawFont, PW_WHITE, PW_BLACK);
+        wallet_gfx_draw_string_uncached(xPos, yPos, data->mnemonicSentence[i], strlen(data->mnemonicSentence[i]), drawFont, PW_WHITE, PW_BLACK);
     }
 }
 
@@ -0,0 +1,110 @@
+#include "progress_screen.h"
+#include "gfx/gfx_utils.h"
+#include "gfx/wallet_fonts.h"
+#include "pico/time.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define BAR_X               (10)
+#define BAR_Y               (70)
+#define BAR_WIDTH           (108)
+#define BAR_HEIGHT          (12)
+#define SPINNER_FRAMES      (4)
+#define SPINNER_FRAME_MS    (150)
+#define SPINNER_SPACING     (12)
+#define SPINNER_Y           (105)
+#define CANCEL_HINT_Y       (115)
+
+static const char* const CANCEL_HINT = "Press to stop";
+
+void draw_progress_screen(WalletScreen* screen);
+void progress_screen_enter(WalletScreen* screen);
+void progress_screen_update(WalletScreen* screen);
+void progress_screen_key_pressed(WalletScreen* screen, DisplayKey key);
+
+
+void init_progress_screen(WalletScreen* screen, ProgressScreenData data) {
+    screen->screenID = PROGRESS_SCREEN;
+    // A press rather than a release, so the release of whichever key started the job doesn't
+    // cancel it straight away
+    screen->keyPressFunction = data.cancellable ? progress_screen_key_pressed : NULL;
+    screen->keyReleaseFunction = NULL;
+    screen->keyHoldFunction = NULL;
+    screen->screenEnterFunction = progress_screen_enter;
+    screen->screenExitFunction = NULL;
+    screen->screenUpdateFunction = progress_screen_update;
+    screen->drawFunction = draw_progress_screen;
+    memcpy(screen->screenData, &data, sizeof(ProgressScreenData));
+}
+
+void set_progress_screen_percent(WalletScreen* screen, uint8_t percent) {
+    ProgressScreenData* data = (ProgressScreenData*) screen->screenData;
+
+    if(percent > 100) {
+        percent = 100;
+    }
+
+    if(percent != data->percent) {
+        data->percent = percent;
+        mark_screen_dirty(screen);
+    }
+}
+
+void draw_progress_screen(WalletScreen* screen) {
+    const WalletDisplayInfo* displayInfo = get_display_info();
+    const WalletFont* drawFont = &PW_FONT_MED;
+    ProgressScreenData* data = (ProgressScreenData*) screen->screenData;
+    int messageLength = strlen(data->message);
+    int messageWidth = (drawFont->charWidth * messageLength);
+    int msgX = (messageWidth >= displayInfo->displayWidth) ? 0 : ((displayInfo->displayWidth - messageWidth) / 2);
+    int msgY = 10;
+
+    wallet_gfx_draw_string(msgX, msgY, data->message, messageLength, drawFont, PW_WHITE, PW_BLACK);
+
+    // Bar outline, then the part that's done
+    wallet_gfx_draw_rectangle(BAR_X, BAR_Y, (BAR_X + BAR_WIDTH), (BAR_Y + BAR_HEIGHT), 1, false, PW_WHITE);
+    int filledWidth = (((BAR_WIDTH - 4) * data->percent) / 100);
+    if(filledWidth > 0) {
+        wallet_gfx_draw_rectangle((BAR_X + 2), (BAR_Y + 2), (BAR_X + 2 + filledWidth), (BAR_Y + BAR_HEIGHT - 2), 1, true, PW_GREEN);
+    }
+
+    char percentText[8];
+    int percentLength = snprintf(percentText, sizeof(percentText), "%d%%", data->percent);
+    int percentX = ((displayInfo->displayWidth - (percentLength * PW_FONT_SMALL.charWidth)) / 2);
+    wallet_gfx_draw_string(percentX, (BAR_Y + BAR_HEIGHT + 4), percentText, percentLength, &PW_FONT_SMALL, PW_WHITE, PW_BLACK);
+
+    // Keeps moving while the percentage doesn't, so a long step doesn't look like a hang
+    int spinnerX = ((displayInfo->displayWidth - ((SPINNER_FRAMES - 1) * SPINNER_SPACING)) / 2);
+    for(int i = 0; i < SPINNER_FRAMES; ++i) {
+        wallet_gfx_draw_circle((spinnerX + (i * SPINNER_SPACING)), SPINNER_Y, 3, 1, (i == data->spinnerFrame), PW_TEAL);
+    }
+
+    if(data->cancellable) {
+        int hintLength = strlen(CANCEL_HINT);
+        int hintX = ((displayInfo->displayWidth - (hintLength * PW_FONT_SMALL.charWidth)) / 2);
+        wallet_gfx_draw_string(hintX, CANCEL_HINT_Y, CANCEL_HINT, hintLength, &PW_FONT_SMALL, PW_TEAL, PW_BLACK);
+    }
+}
+
+void progress_screen_enter(WalletScreen* screen) {
+    ProgressScreenData* data = (ProgressScreenData*) screen->screenData;
+    data->spinnerFrame = 0;
+    data->nextSpinnerTime = make_timeout_time_ms(SPINNER_FRAME_MS);
+    screen->exitCode = 0;
+}
+
+void progress_screen_key_pressed(WalletScreen* screen, DisplayKey key) {
+    screen->exitCode = PROGRESS_SCREEN_CANCEL;
+}
+
+void progress_screen_update(WalletScreen* screen) {
+    ProgressScreenData* data = (ProgressScreenData*) screen->screenData;
+
+    if(absolute_time_diff_us(get_absolute_time(), data->nextSpinnerTime) <= 0) {
+        data->spinnerFrame = ((data->spinnerFrame + 1) % SPINNER_FRAMES);
+        data->nextSpinnerTime = make_timeout_time_ms(SPINNER_FRAME_MS);
+        mark_screen_dirty(screen);
+    }
+}
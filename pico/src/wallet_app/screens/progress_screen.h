@@ -0,0 +1,32 @@
+#ifndef _PROGRESS_SCREEN_H_
+#define _PROGRESS_SCREEN_H_
+
+#include "wallet_screen.h"
+#include "pico/time.h"
+
+
+typedef enum {
+    PROGRESS_SCREEN_CANCEL      = 1         // A key was pressed on a cancellable progress screen
+} ProgressScreenExitCode;
+
+typedef struct {
+    const char *message;
+    bool cancellable;                       // Any key press sets PROGRESS_SCREEN_CANCEL
+    uint8_t percent;
+    uint8_t spinnerFrame;
+    absolute_time_t nextSpinnerTime;
+} ProgressScreenData;
+
+
+void init_progress_screen(WalletScreen* screen, ProgressScreenData data);
+
+/**
+ * Move the progress bar, repainting only if it has changed
+ *
+ * screen               in/out  A screen set up by init_progress_screen()
+ * percent              in      Progress, 0-100
+ */
+void set_progress_screen_percent(WalletScreen* screen, uint8_t percent);
+
+
+#endif      // _PROGRESS_SCREEN_H_
@@ -1,36 +1,133 @@
-#include "wallet_screen.h"
+#include "qr_code_screen.h"
 #include "gfx/gfx_utils.h"
-#include "utils/key_utils.h"
+#include "utils/ur_encoder.h"
+#include "qrcode/qrcode.h"
+#include "pico/time.h"
 #include <string.h>
 
 
+#define ANIMATED_QR_VERSION             (5)
+#define ANIMATED_QR_SIZE                ((ANIMATED_QR_VERSION * 4) + 17)
+#define ANIMATED_QR_BYTES               (((ANIMATED_QR_SIZE * ANIMATED_QR_SIZE) + 7) / 8)
+#define ANIMATED_QR_MAX_CHARS           (154)           // Alphanumeric capacity of a version 5, ECC_LOW QR code
+
+typedef struct {
+    UREncoder encoder;
+    uint32_t frameIntervalMS;
+    absolute_time_t nextFrameTime;
+    uint8_t modules[ANIMATED_QR_BYTES];
+} AnimatedQRCodeScreenData;
+
+
 void wallet_qr_code_screen_enter(WalletScreen* screen);
 void wallet_qr_code_screen_key_released(WalletScreen* screen, DisplayKey key);
+void wallet_qr_code_screen_key_held(WalletScreen* screen, DisplayKey key);
 void draw_qr_code_screen(WalletScreen* screen);
+void animated_qr_code_screen_enter(WalletScreen* screen);
+void animated_qr_code_screen_key_released(WalletScreen* screen, DisplayKey key);
+void animated_qr_code_screen_update(WalletScreen* screen);
+void draw_animated_qr_code_screen(WalletScreen* screen);
 
 
 // Naviagting from a private key requires a key hold. This means there will be a release event waiting
 // for us after we enter the screen. The latch allows us to consume the extra release event 
 bool holdLatch;
 
+// Addresses are only exported from a public key's screen
+static bool showingPublicKey;
+
+// Only ever holds the UR part for the frame currently being generated
+static char urPartBuffer[ANIMATED_QR_MAX_CHARS + 1];
+
+
+static bool generate_next_frame(AnimatedQRCodeScreenData* data) {
+    QRCode qrcode;
+
+    if(ur_encoder_next_part(&data->encoder, urPartBuffer, sizeof(urPartBuffer)) < 0) {
+        return false;
+    }
+
+    qrcode_initText(&qrcode, data->modules, ANIMATED_QR_VERSION, ECC_LOW, urPartBuffer);
+    return true;
+}
+
+static void draw_qr_modules(const uint8_t* modules, uint8_t size) {
+    const WalletDisplayInfo* displayInfo = get_display_info();
+    uint16_t currentBit = 0;
+
+    int qrPixelWidth = (displayInfo->displayWidth / size);
+    int qrPixelHeight = (displayInfo->displayHeight / size);
+
+    int hPad = (displayInfo->displayWidth - (qrPixelWidth * size)) / 2;
+    int vPad = (displayInfo->displayWidth - (qrPixelHeight * size)) / 2;
+    
+    int xPos = hPad;
+    int yPos = vPad;
+
+    wallet_gfx_clear_display(PW_WHITE);
+    for (uint8_t y = 0; y < size; y++, yPos += qrPixelHeight) {
+        for (uint8_t x = 0; x < size; x++, xPos += qrPixelWidth) {
+            uint8_t cByte = currentBit / 8;
+            uint8_t cBit = currentBit % 8;
+
+            uint8_t set = (modules[cByte] & (1 << (7 - cBit)));
+            WalletPaintColor color = (set == 0) ? PW_WHITE : PW_BLACK;
 
-void init_qr_code_screen(WalletScreen* screen, ExtendedKey* key, bool privateKey) {
+            wallet_gfx_draw_rectangle(
+                xPos, yPos, 
+                (xPos + qrPixelWidth), (yPos + qrPixelHeight),
+                1, true, color
+            );
+
+            ++currentBit;
+        }
+        xPos = hPad;
+    }
+}
+
+
+void init_qr_code_screen(WalletScreen* screen, ExtendedKey* key, const QRCacheKey* cacheKey) {
     screen->screenID = QR_CODE_SCREEN,
     screen->keyPressFunction = NULL,
     screen->keyReleaseFunction = wallet_qr_code_screen_key_released,
-    screen->keyHoldFunction = NULL,
+    screen->keyHoldFunction = wallet_qr_code_screen_key_held,
     screen->screenEnterFunction = wallet_qr_code_screen_enter,
     screen->screenExitFunction = NULL,
     screen->screenUpdateFunction = NULL,
     screen->drawFunction = draw_qr_code_screen;
 
-    holdLatch = privateKey;
+    holdLatch = (cacheKey->keyType == QR_KEY_TYPE_WIF);
+    showingPublicKey = (cacheKey->keyType == QR_KEY_TYPE_P2PKH);
 
-    if(privateKey) {
-        get_private_key_wif_qr(key, BTC_MAIN_NET, screen->screenData);
-    } else {
-        get_p2pkh_qr(key, screen->screenData);
+    get_cached_key_qr(cacheKey, key, screen->screenData);
+}
+
+bool init_animated_qr_code_screen(
+    WalletScreen* screen, 
+    const char* urType, const uint8_t* message, uint16_t messageLength,
+    uint16_t maxFragmentLength, uint32_t frameIntervalMS
+) {
+    AnimatedQRCodeScreenData* data = (AnimatedQRCodeScreenData*) screen->screenData;
+
+    screen->screenID = QR_CODE_SCREEN,
+    screen->keyPressFunction = NULL,
+    screen->keyReleaseFunction = animated_qr_code_screen_key_released,
+    screen->keyHoldFunction = NULL,
+    screen->screenEnterFunction = animated_qr_code_screen_enter,
+    screen->screenExitFunction = NULL,
+    screen->screenUpdateFunction = animated_qr_code_screen_update,
+    screen->drawFunction = draw_animated_qr_code_screen;
+
+    holdLatch = false;
+
+    memset(data, 0, sizeof(AnimatedQRCodeScreenData));
+    data->frameIntervalMS = frameIntervalMS;
+    if(!ur_encoder_init(&data->encoder, urType, message, messageLength, maxFragmentLength)) {
+        return false;
     }
+
+    // Parts only differ in length by their sequence number, so if the first one fits they all will
+    return generate_next_frame(data);
 }
 
 void wallet_qr_code_screen_enter(WalletScreen* screen) {
@@ -40,41 +137,50 @@ void wallet_qr_code_screen_enter(WalletScreen* screen) {
 void wallet_qr_code_screen_key_released(WalletScreen* screen, DisplayKey key) {
     if(holdLatch) {
         holdLatch = false;
+    } else if(key == KEY_A) {
+        screen->exitCode = QR_SCREEN_SHOW_ANIMATED;
     } else {
-        screen->exitCode = 1;
+        screen->exitCode = QR_SCREEN_EXIT;
+    }
+}
+
+void wallet_qr_code_screen_key_held(WalletScreen* screen, DisplayKey key) {
+    if(showingPublicKey && (key == KEY_C) && !screen->exitCode) {
+        screen->exitCode = QR_SCREEN_EXPORT_ADDRESSES;
     }
 }
 
 void draw_qr_code_screen(WalletScreen* screen) {
-    const WalletDisplayInfo* displayInfo = get_display_info();
-    uint16_t currentBit = 0;
+    draw_qr_modules(screen->screenData, QR_CODE_SIZE);
+}
 
-    int qrPixelWidth = (displayInfo->displayWidth / QR_CODE_SIZE);
-    int qrPixelHeight = (displayInfo->displayHeight / QR_CODE_SIZE);
+void animated_qr_code_screen_enter(WalletScreen* screen) {
+    AnimatedQRCodeScreenData* data = (AnimatedQRCodeScreenData*) screen->screenData;
 
-    int hPad = (displayInfo->displayWidth - (qrPixelWidth * QR_CODE_SIZE)) / 2;
-    int vPad = (displayInfo->displayWidth - (qrPixelHeight * QR_CODE_SIZE)) / 2;
-    
-    int xPos = hPad;
-    int yPos = vPad;
+    data->nextFrameTime = make_timeout_time_ms(data->frameIntervalMS);
+    screen->exitCode = 0;
+}
 
-    wallet_gfx_clear_display(PW_WHITE);
-    for (uint8_t y = 0; y < QR_CODE_SIZE; y++, yPos += qrPixelHeight) {
-        for (uint8_t x = 0; x < QR_CODE_SIZE; x++, xPos += qrPixelWidth) {
-            uint8_t cByte = currentBit / 8;
-            uint8_t cBit = currentBit % 8;
+void animated_qr_code_screen_key_released(WalletScreen* screen, DisplayKey key) {
+    screen->exitCode = QR_SCREEN_EXIT;
+}
 
-            uint8_t set = (screen->screenData[cByte] & (1 << (7 - cBit)));
-            WalletPaintColor color = (set == 0) ? PW_WHITE : PW_BLACK;
+void animated_qr_code_screen_update(WalletScreen* screen) {
+    AnimatedQRCodeScreenData* data = (AnimatedQRCodeScreenData*) screen->screenData;
 
-            wallet_gfx_draw_rectangle(
-                xPos, yPos, 
-                (xPos + qrPixelWidth), (yPos + qrPixelHeight),
-                1, true, color
-            );
+    // A single part UR never changes, so there is nothing to animate
+    if(ur_encoder_is_single_part(&data->encoder)) {
+        return;
+    }
 
-            ++currentBit;
-        }
-        xPos = hPad;
+    if(absolute_time_diff_us(get_absolute_time(), data->nextFrameTime) <= 0) {
+        generate_next_frame(data);
+        mark_screen_dirty(screen);
+        data->nextFrameTime = make_timeout_time_ms(data->frameIntervalMS);
     }
 }
+
+void draw_animated_qr_code_screen(WalletScreen* screen) {
+    AnimatedQRCodeScreenData* data = (AnimatedQRCodeScreenData*) screen->screenData;
+    draw_qr_modules(data->modules, ANIMATED_QR_SIZE);
+}
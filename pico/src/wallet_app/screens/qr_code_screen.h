@@ -3,9 +3,39 @@
 
 #include "wallet_screen.h"
 #include "utils/key_utils.h"
+#include "utils/qr_cache.h"
 
 
-void init_qr_code_screen(WalletScreen* screen, ExtendedKey* key, bool privateKey);
+#define ANIMATED_QR_FRAME_INTERVAL_MS       (250)
+
+
+typedef enum {
+    QR_SCREEN_EXIT              = 1,
+    QR_SCREEN_SHOW_ANIMATED     = 2,        // User asked for the animated (multi-part UR) version of the key
+    QR_SCREEN_EXPORT_ADDRESSES  = 3         // Export a run of addresses from the shown (public) key's index on
+} QRCodeScreenExitCode;
+
+
+void init_qr_code_screen(WalletScreen* screen, ExtendedKey* key, const QRCacheKey* cacheKey);
+
+/**
+ * Display the supplied message as an endless sequence of multi-part UR QR codes. Each frame is 
+ * generated from the message as it is needed, so only the current frame is ever held in memory
+ *
+ * screen               out     The screen to be configured
+ * urType               in      UR type of the message (e.g. "crypto-hdkey"). Must outlive the screen
+ * message              in      CBOR encoded message. Must outlive the screen
+ * messageLength        in      Number of bytes in message
+ * maxFragmentLength    in      Largest number of message bytes carried by a single frame
+ * frameIntervalMS      in      Time each frame is displayed for
+ *
+ * Returns false if the message cannot be split into frames that fit the animated QR code
+ */
+bool init_animated_qr_code_screen(
+    WalletScreen* screen, 
+    const char* urType, const uint8_t* message, uint16_t messageLength,
+    uint16_t maxFragmentLength, uint32_t frameIntervalMS
+);
 
 
 #endif      // _QR_CODE_SCREEN_H_
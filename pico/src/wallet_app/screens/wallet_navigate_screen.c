@@ -1,5 +1,7 @@
 #include "wallet_navigate_screen.h"
 #include "gfx/wallet_fonts.h"
+#include "utils/qr_cache.h"
+#include "utils/pubkey_cache.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -104,6 +106,43 @@ void update_keys(WalletScreen* screen) {
 }
 
 
+// Keys only need deriving if the QR code we are about to display has not already been rendered,
+// and a public key can come from the card's cache instead
+void update_keys_for_display(WalletScreen* screen, QRKeyType keyType) {
+    NavigateScreenData* navScreenData = (NavigateScreenData*) screen->screenData;
+    ExtendedKey* selectedKey = &DERIVATION_PATH_KEYS[navScreenData->selectedDerivationPath];
+    uint32_t path[NUM_DERIVATION_PATHS];
+    QRCacheKey cacheKey;
+
+    uint8_t pathDepth = get_derivation_path(navScreenData->derivationPathIndices, navScreenData->selectedDerivationPath, path);
+    qr_cache_make_key(&cacheKey, path, pathDepth, keyType, BTC_MAIN_NET);
+
+    if(qr_cache_contains(&cacheKey)) {
+        return;
+    }
+
+    if((keyType == QR_KEY_TYPE_P2PKH) && pubkey_cache_get(path, pathDepth, selectedKey)) {
+        return;
+    }
+
+    update_keys(screen);
+    pubkey_cache_put(path, pathDepth, selectedKey);
+}
+
+uint8_t get_derivation_path(const uint16_t derivationPathIndices[NUM_DERIVATION_PATHS], uint8_t selectedDerivationPath, uint32_t* path) {
+    uint8_t pathDepth = (selectedDerivationPath + 1);
+
+    for(int i = 0; i < pathDepth; ++i) {
+        path[i] = derivationPathIndices[i];
+        if(DERIVATION_PATH_HARDENED[i]) {
+            path[i] += HARDENED_CHILD_INDEX_OFFSET;
+        }
+    }
+
+    return pathDepth;
+}
+
+
 void init_wallet_navigate_screen(WalletScreen* screen, ExtendedKey* baseKey, uint8_t selectedDerivationPath, uint16_t derivationPathValues[NUM_DERIVATION_PATHS]) {
     NavigateScreenData* navScreenData = (NavigateScreenData*) screen->screenData;
 
@@ -124,7 +163,7 @@ void init_wallet_navigate_screen(WalletScreen* screen, ExtendedKey* baseKey, uin
 void wallet_navigate_screen_key_released(WalletScreen* screen, DisplayKey key) {
     NavigateScreenData* navScreenData = (NavigateScreenData*) screen->screenData;
     if(key == KEY_D) {
-        update_keys(screen);
+        update_keys_for_display(screen, QR_KEY_TYPE_P2PKH);
         screen->exitCode = DISPLAY_PUBLIC_KEY;
     } else {
         handle_nav_button_interaction(screen, key);
@@ -134,7 +173,7 @@ void wallet_navigate_screen_key_released(WalletScreen* screen, DisplayKey key) {
 void wallet_navigate_screen_key_held(WalletScreen* screen, DisplayKey key) {
     NavigateScreenData* navScreenData = (NavigateScreenData*) screen->screenData;
     if(key == KEY_D) {
-        update_keys(screen);
+        update_keys_for_display(screen, QR_KEY_TYPE_WIF);
         screen->exitCode = DISPLAY_PRIVATE_KEY;
     } else {
         handle_nav_button_interaction(screen, key);
@@ -28,5 +28,13 @@ typedef struct {
 
 void init_wallet_navigate_screen(WalletScreen* screen, ExtendedKey* baseKey, uint8_t selectedDerivationPath, uint16_t derivationPathValues[NUM_DERIVATION_PATHS]);
 
+/**
+ * Convert the navigation indices into raw child indices (hardened offsets applied) running from 
+ * the base key down to the selected derivation path
+ *
+ * Returns the number of entries written to path
+ */
+uint8_t get_derivation_path(const uint16_t derivationPathIndices[NUM_DERIVATION_PATHS], uint8_t selectedDerivationPath, uint32_t* path);
+
 
 #endif      // _WALLET_NAVIGATE_SCREEN_H_
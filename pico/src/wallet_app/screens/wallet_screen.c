@@ -83,3 +83,14 @@ void render_button_bar(const KeyButtonType types[]) {
         }
     }
 }
+
+void mark_screen_dirty(WalletScreen* screen) {
+    ++screen->revision;
+}
+
+void enter_screen(WalletScreen* screen) {
+    if(screen->screenEnterFunction) {
+        screen->screenEnterFunction(screen);
+    }
+    mark_screen_dirty(screen);
+}
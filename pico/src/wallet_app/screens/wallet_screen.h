@@ -41,7 +41,8 @@ typedef enum {
     ICON_MESSAGE_SCREEN,
     MNEMONIC_DISPLAY_SCREEN,
     WALLET_BROWSE_SCREEN,
-    QR_CODE_SCREEN
+    QR_CODE_SCREEN,
+    PROGRESS_SCREEN
 } ScreenID;
 
 
@@ -65,11 +66,23 @@ typedef struct WalletScreen_t {
     ScreenDrawFunction drawFunction;
     uint8_t screenData[SCREEN_DATA_BUFFER_SIZE];
     int exitCode;               // 0 if screen is not exiting
+    uint32_t revision;          // Bumped whenever the screen's appearance changes. Only new revisions are painted
 } WalletScreen;
 
 
 // Utility functions
 void render_button_bar(const KeyButtonType types[]);
 
+/**
+ * Flag the screen as needing to be repainted
+ */
+void mark_screen_dirty(WalletScreen* screen);
+
+/**
+ * Run the screen's enter function (if it has one) and flag it for painting. Should be called 
+ * whenever a screen has just been initialized
+ */
+void enter_screen(WalletScreen* screen);
+
 
 #endif      // _WALLET_SCREEN_H_
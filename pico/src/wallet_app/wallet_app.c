@@ -1,11 +1,18 @@
 #include "wallet_app.h"
 #include "wallet_load.h"
 #include "wallet_browse.h"
+#include "crypto_worker.h"
 #include "screens/splash_screen.h"
 #include "gfx/gfx_utils.h"
+#include "utils/platform/key_input.h"
+#include "utils/platform/task_scheduler.h"
+#include "utils/wallet_file.h"
 
+#ifndef SCHEDULER_STATS_INTERVAL_MS
+#define SCHEDULER_STATS_INTERVAL_MS     (0)     // Print task run times this often, 0 never
+#endif
 
-#define HOLD_REPEAT_TIME_MS                 (250)
+#define SCREEN_UPDATE_INTERVAL_MS       (10)    // Polling rate for screens with an update function (animations, timeouts)
 
 typedef enum {
     APP_SPLASH_SCREEN,
@@ -21,9 +28,6 @@ static const uint8_t KEY_PINS[] = {
     3
 };
 
-static uint8_t keyStates[NUM_KEYS];
-static uint32_t keyHoldTimes[NUM_KEYS];
-
 static HDWallet wallet;
 static WalletScreen currentScreen;
 static ApplicationState currentAppState;
@@ -36,6 +40,10 @@ static WalletBrowserStateController walletBrowserStateController = {
     .wallet = &wallet
 };
 
+static int inputTaskId;
+static int appTaskId;
+static int displayTaskId;
+
 
 WalletScreen* get_current_screen() {
     return &currentScreen;
@@ -61,59 +69,56 @@ void do_wallet_browser_update() {
 }
 
 void init_key_buttons() {
-    for(int i = 0; i < NUM_KEYS; ++i) {
-        gpio_init(KEY_PINS[i]);
-        gpio_pull_up(KEY_PINS[i]);
-        gpio_set_dir(KEY_PINS[i], GPIO_IN);
-        keyStates[i] = 1;
-    }
+    key_input_init(KEY_PINS, NUM_KEYS);
 }
 
-void update_buttons(WalletScreen* currentScreen) {
-    for(int i = 0; i < NUM_KEYS; ++i) {
-        uint8_t currentState = gpio_get(KEY_PINS[i]);
-        bool stateChange = (currentState != keyStates[i]);
+// Key events are debounced and queued by interrupts, this only hands them to the screen
+bool update_buttons(WalletScreen* currentScreen) {
+    KeyEvent event;
+    bool handledEvents = false;
 
-        if(stateChange) {
-            if(currentState) {
-                // Released
-                if(currentScreen->keyReleaseFunction) {
-                    currentScreen->keyReleaseFunction(currentScreen, i);
-                }
-            } else {
-                // Pressed
+    while(key_input_get_event(&event)) {
+        handledEvents = true;
+
+        switch(event.type) {
+            case KEY_EVENT_PRESSED:
                 if(currentScreen->keyPressFunction) {
-                    currentScreen->keyPressFunction(currentScreen, i);
+                    currentScreen->keyPressFunction(currentScreen, event.key);
+                    mark_screen_dirty(currentScreen);
                 }
-                keyHoldTimes[i] = to_ms_since_boot(get_absolute_time());
-            }
-        } else if(!currentState) {
-            // Check for hold
-            uint32_t currentTime = to_ms_since_boot(get_absolute_time());
-            if((currentTime - keyHoldTimes[i]) > HOLD_REPEAT_TIME_MS) {
+                break;
+            case KEY_EVENT_RELEASED:
+                if(currentScreen->keyReleaseFunction) {
+                    currentScreen->keyReleaseFunction(currentScreen, event.key);
+                    mark_screen_dirty(currentScreen);
+                }
+                break;
+            case KEY_EVENT_HELD:
                 if(currentScreen->keyHoldFunction) {
-                    currentScreen->keyHoldFunction(currentScreen, i);
+                    currentScreen->keyHoldFunction(currentScreen, event.key);
+                    mark_screen_dirty(currentScreen);
                 }
-                keyHoldTimes[i] = currentTime;
-            }
+                break;
         }
-
-        keyStates[i] = currentState;
     }
-}
 
-void init_application() {
-    init_key_buttons();
-    init_display();
+    return handledEvents;
+}
 
-    currentAppState = APP_SPLASH_SCREEN;
-    init_splash_screen(&currentScreen);
+static void on_key_event() {
+    scheduler_wake_task(inputTaskId);
 }
 
-void update_application() {
-    update_buttons(get_current_screen());
-    update_display(get_current_screen());
+static TaskResult input_task(int taskId, void* context) {
+    if(update_buttons(get_current_screen())) {
+        scheduler_wake_task(appTaskId);
+        scheduler_wake_task(displayTaskId);
+    }
 
+    return TASK_WAIT;
+}
+
+static TaskResult app_task(int taskId, void* context) {
     switch(currentAppState) {
         case APP_SPLASH_SCREEN:
             do_splash_screen_update();
@@ -125,8 +130,75 @@ void update_application() {
             do_wallet_browser_update();
             break;
     }
+
+    // update_display() skips the paint if the screen hasn't changed
+    scheduler_wake_task(displayTaskId);
+
+    // An exit the controllers have yet to act on, which may take them several steps
+    if(currentScreen.exitCode) {
+        return TASK_YIELD;
+    }
+
+    if(currentScreen.screenUpdateFunction) {
+        scheduler_set_timer(taskId, SCREEN_UPDATE_INTERVAL_MS);
+    } else {
+        scheduler_cancel_timer(taskId);
+    }
+
+    return TASK_WAIT;
+}
+
+static TaskResult display_task(int taskId, void* context) {
+    update_display(get_current_screen());
+    return TASK_WAIT;
+}
+
+#if SCHEDULER_STATS_INTERVAL_MS
+static TaskResult stats_task(int taskId, void* context) {
+    // Skip the first run, at start up
+    if(scheduler_get_task_stats(taskId)->runs) {
+        scheduler_print_stats();
+    }
+
+    scheduler_set_timer(taskId, SCHEDULER_STATS_INTERVAL_MS);
+    return TASK_WAIT;
+}
+#endif
+
+void init_application() {
+    init_key_buttons();
+    init_display();
+
+    currentAppState = APP_SPLASH_SCREEN;
+    init_splash_screen(&currentScreen);
+    enter_screen(&currentScreen);
+
+    // Input first, so a step of the app reacts to keys that arrived before it, and display last, so
+    // it paints whatever the other two have left
+    inputTaskId = scheduler_add_task("input", input_task, NULL);
+    appTaskId = scheduler_add_task("app", app_task, NULL);
+    displayTaskId = scheduler_add_task("display", display_task, NULL);
+#if SCHEDULER_STATS_INTERVAL_MS
+    scheduler_add_task("stats", stats_task, NULL);
+#endif
+
+    key_input_set_event_callback(on_key_event);
+    crypto_worker_init();
+}
+
+void update_application() {
+    scheduler_run_ready_tasks();
+}
+
+void wait_for_application_event() {
+    scheduler_wait_for_work();
 }
 
 void shutdown_application() {
-    // Nothing required, currently
+    if(currentAppState == APP_USING_WALLET) {
+        exit_wallet_browser_state_controller(&walletBrowserStateController);
+    }
+
+    // The card is left mounted between file operations
+    unmount_wallet_storage();
 }
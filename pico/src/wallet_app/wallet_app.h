@@ -6,6 +6,7 @@
 
 void init_application();
 void update_application();
+void wait_for_application_event();             // Sleeps while there is nothing for update_application() to do
 void shutdown_application();
 
 
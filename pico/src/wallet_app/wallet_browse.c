@@ -1,22 +1,64 @@
 #include "wallet_browse.h"
 #include "screens/wallet_navigate_screen.h"
 #include "screens/qr_code_screen.h"
+#include "screens/progress_screen.h"
+#include "screens/timed_info_message_screen.h"
+#include "address_export.h"
+#include "utils/qr_cache.h"
+#include "utils/pubkey_cache.h"
+#include "utils/ur_encoder.h"
+#include "utils/secure_zero.h"
+#include "gfx/text_cache.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#ifndef DEBUG_ADDRESS_BATCH
+#define DEBUG_ADDRESS_BATCH         (0)     // Addresses to print over serial when a wallet is opened
+#endif
+#if DEBUG_ADDRESS_BATCH
+#include "utils/key_print_utils.h"
+#endif
+
+
+#define EXPORT_RESULT_TIMEOUT_MS    (3000)
 
 static NavigateScreenReturnData cachedNavScreenData = {
     .selectedDerivationPath = COIN,
     .derivationPathIndices = {0, 0, 0, 0}
 };
 
+// Backing store for the message being shown by the animated QR screen
+static uint8_t urMessageBuffer[UR_MAX_HDKEY_CBOR_LENGTH];
+
+// Backing store for the export result message
+static char exportMessage[48];
+
 
 void do_browse_wallet_state_update(WalletBrowserStateController* controller);
 void do_qr_code_screen_state_update(WalletBrowserStateController* controller);
+bool show_animated_key_qr(WalletBrowserStateController* controller);
+void start_address_export_state(WalletBrowserStateController* controller);
+void do_address_export_state_update(WalletBrowserStateController* controller);
+void do_export_result_state_update(WalletBrowserStateController* controller);
+void return_to_wallet_navigation(WalletBrowserStateController* controller);
+#if DEBUG_ADDRESS_BATCH
+void print_debug_address_batch(WalletBrowserStateController* controller);
+#endif
 
 
 void init_wallet_browser_state_controller(WalletBrowserStateController* controller) {
     controller->currentState = PW_NAVIGATING_WALLET_STATE;
+
+    // Anything cached belongs to whichever wallet was open before this one. The card's cache checks
+    // itself against this wallet's key, and without it keys are just derived
+    qr_cache_clear();
+    text_cache_clear();
+    pubkey_cache_open(controller->wallet->cacheKey);
+
+#if DEBUG_ADDRESS_BATCH
+    print_debug_address_batch(controller);
+#endif
     
     init_wallet_navigate_screen(
         controller->currentScreen, 
@@ -24,7 +66,13 @@ void init_wallet_browser_state_controller(WalletBrowserStateController* controll
         cachedNavScreenData.selectedDerivationPath,
         cachedNavScreenData.derivationPathIndices
     );
-    controller->currentScreen->screenEnterFunction(controller->currentScreen);
+    enter_screen(controller->currentScreen);
+}
+
+void exit_wallet_browser_state_controller(WalletBrowserStateController* controller) {
+    qr_cache_clear();
+    text_cache_clear();
+    pubkey_cache_close();
 }
 
 void update_wallet_browser_state_controller(WalletBrowserStateController* controller) {
@@ -42,6 +90,15 @@ void update_wallet_browser_state_controller(WalletBrowserStateController* contro
         case PW_DISPLAYING_PUBLIC_KEY_QR:
             do_qr_code_screen_state_update(controller);
             break;
+        case PW_DISPLAYING_ANIMATED_QR:
+            do_qr_code_screen_state_update(controller);
+            break;
+        case PW_EXPORTING_ADDRESSES:
+            do_address_export_state_update(controller);
+            break;
+        case PW_DISPLAYING_EXPORT_RESULT:
+            do_export_result_state_update(controller);
+            break;
     }
 }
 
@@ -50,10 +107,16 @@ void do_browse_wallet_state_update(WalletBrowserStateController* controller) {
 
     if(controller->currentScreen->exitCode) {
         controller->currentScreen->screenExitFunction(controller->currentScreen, &cachedNavScreenData);
+
         bool privateKey = controller->currentScreen->exitCode == DISPLAY_PRIVATE_KEY;
+        uint32_t path[NUM_DERIVATION_PATHS];
+        QRCacheKey cacheKey;
+
+        uint8_t pathDepth = get_derivation_path(cachedNavScreenData.derivationPathIndices, cachedNavScreenData.selectedDerivationPath, path);
+        qr_cache_make_key(&cacheKey, path, pathDepth, (privateKey ? QR_KEY_TYPE_WIF : QR_KEY_TYPE_P2PKH), BTC_MAIN_NET);
 
-        init_qr_code_screen(controller->currentScreen, &cachedNavScreenData.selectedKey, privateKey);
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        init_qr_code_screen(controller->currentScreen, &cachedNavScreenData.selectedKey, &cacheKey);
+        enter_screen(controller->currentScreen);
         controller->currentState = privateKey ? PW_DISPLAYING_PRIVATE_KEY_QR : PW_DISPLAYING_PUBLIC_KEY_QR;
     }
 }
@@ -62,14 +125,180 @@ void do_qr_code_screen_state_update(WalletBrowserStateController* controller) {
     assert(controller->currentScreen->screenID == QR_CODE_SCREEN);
 
     if(controller->currentScreen->exitCode) {
-        controller->currentState = PW_NAVIGATING_WALLET_STATE;
-        
-        init_wallet_navigate_screen(
-            controller->currentScreen, 
-            &controller->wallet->baseKey44,
-            cachedNavScreenData.selectedDerivationPath,
-            cachedNavScreenData.derivationPathIndices
+        if(
+            (controller->currentScreen->exitCode == QR_SCREEN_SHOW_ANIMATED) &&
+            (controller->currentState == PW_DISPLAYING_PUBLIC_KEY_QR) &&
+            show_animated_key_qr(controller)
+        ) {
+            return;
+        }
+
+        if(
+            (controller->currentScreen->exitCode == QR_SCREEN_EXPORT_ADDRESSES) &&
+            (controller->currentState == PW_DISPLAYING_PUBLIC_KEY_QR)
+        ) {
+            start_address_export_state(controller);
+            return;
+        }
+
+        return_to_wallet_navigation(controller);
+    }
+}
+
+void return_to_wallet_navigation(WalletBrowserStateController* controller) {
+    controller->currentState = PW_NAVIGATING_WALLET_STATE;
+    
+    init_wallet_navigate_screen(
+        controller->currentScreen, 
+        &controller->wallet->baseKey44,
+        cachedNavScreenData.selectedDerivationPath,
+        cachedNavScreenData.derivationPathIndices
+    );
+    enter_screen(controller->currentScreen);
+}
+
+void show_export_result(WalletBrowserStateController* controller, wallet_error err) {
+    if((err == NO_ERROR) && get_address_export_stats()->stopped) {
+        snprintf(exportMessage, sizeof(exportMessage), "Stopped after\n%lu addresses", (unsigned long) get_address_export_stats()->addresses);
+    } else if(err == NO_ERROR) {
+        snprintf(exportMessage, sizeof(exportMessage), "Exported %lu\naddresses", (unsigned long) get_address_export_stats()->addresses);
+    } else {
+        snprintf(exportMessage, sizeof(exportMessage), "Export failed\nCode: 0x%04X", err);
+    }
+
+    TimedInfoMessageScreenData data = {
+        .timeoutMS = EXPORT_RESULT_TIMEOUT_MS,
+        .message = exportMessage
+    };
+
+    init_timed_info_message_screen(controller->currentScreen, data);
+    enter_screen(controller->currentScreen);
+    controller->currentState = PW_DISPLAYING_EXPORT_RESULT;
+}
+
+void on_address_export_progress(CryptoJobHandle job, uint8_t percent, void* context) {
+    WalletBrowserStateController* controller = (WalletBrowserStateController*) context;
+
+    if(controller->currentScreen->screenID == PROGRESS_SCREEN) {
+        set_progress_screen_percent(controller->currentScreen, percent);
+    }
+}
+
+// Export the addresses under the selected change key, from the selected address index on
+void start_address_export_state(WalletBrowserStateController* controller) {
+    AddressExportRange range = {
+        .firstIndex = cachedNavScreenData.derivationPathIndices[ADDRESS_INDEX],
+        .count = ADDRESS_EXPORT_DEFAULT_COUNT
+    };
+    range.parentDepth = get_derivation_path(cachedNavScreenData.derivationPathIndices, CHANGE, range.parentPath);
+
+    wallet_error err = start_address_export(controller->wallet, &range, on_address_export_progress, controller);
+    if(err != NO_ERROR) {
+        show_export_result(controller, err);
+        return;
+    }
+
+    ProgressScreenData progressData = {
+        .message = "Exporting\naddresses",
+        .cancellable = true
+    };
+
+    init_progress_screen(controller->currentScreen, progressData);
+    enter_screen(controller->currentScreen);
+    controller->currentState = PW_EXPORTING_ADDRESSES;
+}
+
+void do_address_export_state_update(WalletBrowserStateController* controller) {
+    wallet_error err;
+
+    // The export winds down on its own, what was written so far is kept
+    if(controller->currentScreen->exitCode == PROGRESS_SCREEN_CANCEL) {
+        cancel_address_export();
+        controller->currentScreen->exitCode = 0;
+    }
+
+    if(finish_address_export(&err)) {
+        show_export_result(controller, err);
+    }
+}
+
+void do_export_result_state_update(WalletBrowserStateController* controller) {
+    if(controller->currentScreen->exitCode) {
+        return_to_wallet_navigation(controller);
+    }
+}
+
+#if DEBUG_ADDRESS_BATCH
+// Dump the addresses under the selected change key, from the selected index on, for auditing
+void print_debug_address_batch(WalletBrowserStateController* controller) {
+    uint32_t path[NUM_DERIVATION_PATHS];
+    ExtendedKey keys[2];
+    int currentKey = 0;
+
+    uint8_t pathDepth = get_derivation_path(cachedNavScreenData.derivationPathIndices, CHANGE, path);
+
+    memcpy(&keys[currentKey], &controller->wallet->baseKey44, sizeof(ExtendedKey));
+    for(int i = 0; i < pathDepth; ++i) {
+        derive_child_key(
+            &keys[currentKey],
+            (path[i] & ~HARDENED_CHILD_INDEX_OFFSET),
+            (path[i] & HARDENED_CHILD_INDEX_OFFSET),
+            &keys[currentKey ^ 1]
         );
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        currentKey ^= 1;
     }
+
+    printf("Addresses from index %u:\n", cachedNavScreenData.derivationPathIndices[ADDRESS_INDEX]);
+    print_address_batch(&keys[currentKey], cachedNavScreenData.derivationPathIndices[ADDRESS_INDEX], DEBUG_ADDRESS_BATCH, false);
+    secure_zero(keys, sizeof(keys));
+}
+#endif
+
+// Show the selected key (public only) as an animated crypto-hdkey UR, including its full origin
+bool show_animated_key_qr(WalletBrowserStateController* controller) {
+    uint32_t originPath[NUM_DERIVATION_PATHS + 1];
+    uint8_t originDepth;
+    ExtendedKey keys[2];
+    int currentKey = 0;
+
+    // The navigate screen may not have derived the selected key if its QR code came from the cache
+    originPath[0] = (BASE_KEY_INDEX + HARDENED_CHILD_INDEX_OFFSET);
+    originDepth = 1 + get_derivation_path(
+        cachedNavScreenData.derivationPathIndices, 
+        cachedNavScreenData.selectedDerivationPath, 
+        &originPath[1]
+    );
+
+    // Only the public half is encoded, so the card's cache will do
+    if(!pubkey_cache_get(&originPath[1], (originDepth - 1), &keys[currentKey])) {
+        memcpy(&keys[currentKey], &controller->wallet->baseKey44, sizeof(ExtendedKey));
+        for(int i = 1; i < originDepth; ++i) {
+            derive_child_key(
+                &keys[currentKey], 
+                (originPath[i] & ~HARDENED_CHILD_INDEX_OFFSET), 
+                (originPath[i] & HARDENED_CHILD_INDEX_OFFSET), 
+                &keys[currentKey ^ 1]
+            );
+            currentKey ^= 1;
+        }
+
+        pubkey_cache_put(&originPath[1], (originDepth - 1), &keys[currentKey]);
+    }
+
+    int messageLength = ur_encode_crypto_hdkey(
+        &keys[currentKey], originPath, originDepth, controller->wallet->masterKey.fingerprint, urMessageBuffer
+    );
+    secure_zero(keys, sizeof(keys));
+
+    if(!init_animated_qr_code_screen(
+        controller->currentScreen, 
+        "crypto-hdkey", urMessageBuffer, messageLength,
+        UR_DEFAULT_MAX_FRAGMENT_LENGTH, ANIMATED_QR_FRAME_INTERVAL_MS
+    )) {
+        return false;
+    }
+
+    enter_screen(controller->currentScreen);
+    controller->currentState = PW_DISPLAYING_ANIMATED_QR;
+    return true;
 }
@@ -8,7 +8,10 @@
 typedef enum {
     PW_NAVIGATING_WALLET_STATE,
     PW_DISPLAYING_PRIVATE_KEY_QR,
-    PW_DISPLAYING_PUBLIC_KEY_QR
+    PW_DISPLAYING_PUBLIC_KEY_QR,
+    PW_DISPLAYING_ANIMATED_QR,
+    PW_EXPORTING_ADDRESSES,
+    PW_DISPLAYING_EXPORT_RESULT
 } WalletBrowserState;
 
 
@@ -22,5 +25,11 @@ typedef struct {
 void init_wallet_browser_state_controller(WalletBrowserStateController* controller);
 void update_wallet_browser_state_controller(WalletBrowserStateController* controller);
 
+/**
+ * Done with the wallet. Drops (and zeroises) the QR codes and text rendered for it, and the
+ * public key cache's key
+ */
+void exit_wallet_browser_state_controller(WalletBrowserStateController* controller);
+
 
 #endif      // _WALLET_BROWSE_H_
@@ -7,6 +7,7 @@
 #include "screens/timed_info_message_screen.h"
 #include "screens/icon_message_screen.h"
 #include "screens/mnemonic_display_screen.h"
+#include "screens/progress_screen.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -43,6 +44,11 @@ void display_password_error_for_load_state_update(WalletLoadStateController* con
 void wallet_ready_state_update(WalletLoadStateController* controller);
 void display_mnemonic_state_update(WalletLoadStateController* controller);
 
+void creating_wallet_state_update(WalletLoadStateController* controller);
+void restoring_wallet_state_update(WalletLoadStateController* controller);
+void decrypting_wallet_state_update(WalletLoadStateController* controller);
+void encrypting_wallet_state_update(WalletLoadStateController* controller);
+
 
 void display_icon_message_screen(WalletLoadStateController* controller, IconType iconType, const KeyButtonType buttons[NUM_KEYS], const char* format, ...) {
     va_list args;
@@ -57,7 +63,7 @@ void display_icon_message_screen(WalletLoadStateController* controller, IconType
     memcpy(data.buttonKeys, buttons, NUM_KEYS);
 
     init_icon_message_screen(controller->currentScreen, data);
-    controller->currentScreen->screenEnterFunction(controller->currentScreen);
+    enter_screen(controller->currentScreen);
 }
 
 void display_info_message_screen(WalletLoadStateController* controller, const char* format, ...) {
@@ -71,7 +77,7 @@ void display_info_message_screen(WalletLoadStateController* controller, const ch
     };
 
     init_info_message_screen(controller->currentScreen, data);
-    controller->currentScreen->screenEnterFunction(controller->currentScreen);
+    enter_screen(controller->currentScreen);
 }
 
 void display_timed_info_message_screen(WalletLoadStateController* controller, uint16_t timeoutMS, const char* format, ...) {
@@ -86,13 +92,60 @@ void display_timed_info_message_screen(WalletLoadStateController* controller, ui
     };
 
     init_timed_info_message_screen(controller->currentScreen, data);
-    controller->currentScreen->screenEnterFunction(controller->currentScreen);
+    enter_screen(controller->currentScreen);
+}
+
+void on_crypto_job_progress(CryptoJobHandle job, uint8_t percent, void* context) {
+    WalletLoadStateController* controller = (WalletLoadStateController*) context;
+
+    if(controller->currentScreen->screenID == PROGRESS_SCREEN) {
+        set_progress_screen_percent(controller->currentScreen, percent);
+    }
+}
+
+// Hand the slow part of a state over to core1, showing its progress until the job is complete
+void start_crypto_job(WalletLoadStateController* controller, CryptoJobType type, uint8_t* data, WalletLoadState waitState, const char* message) {
+    controller->cryptoJob = crypto_worker_submit(type, controller->wallet, data, on_crypto_job_progress, controller);
+    if(controller->cryptoJob == CRYPTO_INVALID_JOB) {
+        wallet_error err = WALLET_ERROR(WF_FAIL, 0);
+        display_icon_message_screen(
+            controller, ERROR, NO_KEYS,
+            "Worker busy\nCode: 0x%04X", err
+        );
+
+        controller->walletLoadError = err;
+        controller->currentState = PW_TERMINAL_ERROR_STATE;
+        return;
+    }
+
+    ProgressScreenData progressData = {
+        .message = message
+    };
+
+    init_progress_screen(controller->currentScreen, progressData);
+    enter_screen(controller->currentScreen);
+    controller->currentState = waitState;
+}
+
+// Returns false while the job is still running, otherwise releases it and gives its result
+bool finish_crypto_job(WalletLoadStateController* controller, wallet_error* result) {
+    if(crypto_job_status(controller->cryptoJob) != CRYPTO_JOB_COMPLETE) {
+        return false;
+    }
+
+    *result = crypto_job_result(controller->cryptoJob);
+    crypto_job_release(controller->cryptoJob);
+    controller->cryptoJob = CRYPTO_INVALID_JOB;
+
+    return true;
 }
 
 
 void init_wallet_load_state_controller(WalletLoadStateController* controller) {
     controller->currentState = PW_INITIAL_APP_STATE;
     controller->userExitRequested = false;
+    controller->cryptoJob = CRYPTO_INVALID_JOB;
+    controller->walletSlot = DEFAULT_WALLET_SLOT;
     display_timed_info_message_screen(controller, 100, "Loading wallet");
 }
 
@@ -131,6 +184,18 @@ void update_wallet_load_state_controller(WalletLoadStateController* controller)
         case PW_WALLET_READY_STATE:
             wallet_ready_state_update(controller);
             break;
+        case PW_CREATING_WALLET_STATE:
+            creating_wallet_state_update(controller);
+            break;
+        case PW_RESTORING_WALLET_STATE:
+            restoring_wallet_state_update(controller);
+            break;
+        case PW_DECRYPTING_WALLET_STATE:
+            decrypting_wallet_state_update(controller);
+            break;
+        case PW_ENCRYPTING_WALLET_STATE:
+            encrypting_wallet_state_update(controller);
+            break;
     }
 }
 
@@ -142,14 +207,14 @@ void initial_app_state_update(WalletLoadStateController* controller) {
 }
 
 void load_wallet_state_update(WalletLoadStateController* controller) {
-    wallet_error err = load_wallet_data_from_disk(controller->walletFileBuffer);
+    wallet_error err = load_wallet_data_from_disk(controller->walletSlot, controller->walletFileBuffer);
 
     if(NO_ERROR == err) {
         // Wallet data loaded, need to get password to decrypt
         controller->currentState = PW_GET_PASSWORD_FOR_DECRYPT_STATE;
         
         init_password_entry_screen(controller->currentScreen);
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        enter_screen(controller->currentScreen);
     } else if(GET_WF_RESULT(err) == WF_FILE_NOT_FOUND) {
         // There was no wallet file, attempt recovery
         controller->currentState = PW_RECOVER_WALLET_STATE;
@@ -170,17 +235,37 @@ void recover_wallet_state_update(WalletLoadStateController* controller) {
     assert(controller->currentScreen->screenID == INFO_MESSAGE_SCREEN);
 
     if(controller->currentScreen->exitCode) {
-        wallet_error err = recover_wallet(controller->wallet);
+        // The disk is only used from core0, so read the mnemonic here and leave the keys to core1
+        wallet_error err = read_mnemonics_from_disk(controller->wallet->mnemonicSentence);
         if(NO_ERROR == err) {
-            // Wallet recovered, need to get password to encrypt new wallet
-            controller->currentState = PW_GET_PASSWORD_FOR_ENCRYPT_STATE;
-            
-            init_password_entry_screen(controller->currentScreen);
-            controller->currentScreen->screenEnterFunction(controller->currentScreen);
+            start_crypto_job(controller, CRYPTO_JOB_RESTORE_FROM_MNEMONIC, NULL, PW_RESTORING_WALLET_STATE, "Recovering\nwallet");
         } else if(GET_WF_RESULT(err) == WF_FILE_NOT_FOUND) {
             // There was no wallet file, create brand new wallet
             controller->currentState = PW_CREATE_WALLET_STATE;
             display_info_message_screen(controller, "No recovery file\n\nCreating new\nwallet");
+        } else { 
+            // Loading wallet failed completely, display error state
+            display_icon_message_screen(
+                controller, ERROR, NO_KEYS,
+                "Load failed\nCode: 0x%04X", err
+            );
+
+            controller->walletLoadError = err;
+            controller->currentState = PW_TERMINAL_ERROR_STATE;
+        }
+    }
+}
+
+void restoring_wallet_state_update(WalletLoadStateController* controller) {
+    wallet_error err;
+
+    if(finish_crypto_job(controller, &err)) {
+        if(NO_ERROR == err) {
+            // Wallet recovered, need to get password to encrypt new wallet
+            controller->currentState = PW_GET_PASSWORD_FOR_ENCRYPT_STATE;
+            
+            init_password_entry_screen(controller->currentScreen);
+            enter_screen(controller->currentScreen);
         } else if(GET_WF_RESULT(err) == WF_MNEMONIC_CHECKSUM_INVALID) {
             // There was no wallet file, create brand new wallet
             controller->currentState = PW_CREATE_WALLET_STATE;
@@ -202,17 +287,23 @@ void create_wallet_state_update(WalletLoadStateController* controller) {
     assert(controller->currentScreen->screenID == INFO_MESSAGE_SCREEN);
     
     if(controller->currentScreen->exitCode) {
-        init_new_wallet(controller->wallet, 0, 0, 0);
+        start_crypto_job(controller, CRYPTO_JOB_INIT_NEW_WALLET, NULL, PW_CREATING_WALLET_STATE, "Creating\nwallet");
+    }
+}
+
+void creating_wallet_state_update(WalletLoadStateController* controller) {
+    wallet_error err;
+
+    if(finish_crypto_job(controller, &err)) {
         controller->currentState = PW_GET_PASSWORD_FOR_ENCRYPT_STATE;
         
         init_password_entry_screen(controller->currentScreen);
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        enter_screen(controller->currentScreen);
     }
 }
 
 void get_password_for_create_state_update(WalletLoadStateController* controller) {
     uint8_t userPasswordBytes[USER_PASSWORD_LENGTH];
-    wallet_error saveError;
 
     assert(controller->currentScreen->screenID == PASSWORD_ENTRY_SCREEN);
 
@@ -223,8 +314,17 @@ void get_password_for_create_state_update(WalletLoadStateController* controller)
         // Set wallet password
         set_wallet_password(controller->wallet, userPasswordBytes);
 
+        // Encrypt on core1, the result is saved once it is done
+        start_crypto_job(controller, CRYPTO_JOB_ENCRYPT_WALLET_DATA, controller->walletFileBuffer, PW_ENCRYPTING_WALLET_STATE, "Encrypting\nwallet");
+    }
+}
+
+void encrypting_wallet_state_update(WalletLoadStateController* controller) {
+    wallet_error saveError;
+
+    if(finish_crypto_job(controller, &saveError)) {
         // Save new wallet to disk
-        saveError = save_wallet(controller->wallet);
+        saveError = save_wallet_data_to_disk(controller->walletSlot, NULL, controller->walletFileBuffer);
         if(saveError != NO_ERROR) {
             // Something bad happened. SD card might be corrupted or removed
             display_icon_message_screen(
@@ -246,16 +346,21 @@ void get_password_for_create_state_update(WalletLoadStateController* controller)
 }
 
 void get_password_for_load_state_update(WalletLoadStateController* controller) {
-    wallet_error decryptError;
-
     assert(controller->currentScreen->screenID == PASSWORD_ENTRY_SCREEN);
 
     if(controller->currentScreen->exitCode) {
         // Get password bytes from screen
         controller->currentScreen->screenExitFunction(controller->currentScreen, controller->wallet->password);
 
-        // Check file data can be decrypted
-        decryptError = decrypt_wallet_data(controller->walletFileBuffer, controller->wallet);
+        // Check file data can be decrypted, on core1
+        start_crypto_job(controller, CRYPTO_JOB_DECRYPT_WALLET_DATA, controller->walletFileBuffer, PW_DECRYPTING_WALLET_STATE, "Unlocking\nwallet");
+    }
+}
+
+void decrypting_wallet_state_update(WalletLoadStateController* controller) {
+    wallet_error decryptError;
+
+    if(finish_crypto_job(controller, &decryptError)) {
         if(decryptError != NO_ERROR) {
             // Something bad happened. File might be corrupted or password
             // was incorrect
@@ -294,7 +399,7 @@ void display_password_error_for_load_state_update(WalletLoadStateController* con
         controller->currentState = PW_GET_PASSWORD_FOR_DECRYPT_STATE;
         
         init_password_entry_screen(controller->currentScreen);
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        enter_screen(controller->currentScreen);
     }
 }
 
@@ -307,7 +412,7 @@ void wallet_ready_state_update(WalletLoadStateController* controller) {
         controller->currentState = PW_DISPLAY_CREATED_MNEMONIC_STATE;
         
         init_mnemonic_display_screen(controller->currentScreen, data);
-        controller->currentScreen->screenEnterFunction(controller->currentScreen);
+        enter_screen(controller->currentScreen);
     } else {
         controller->userExitRequested = (controller->currentScreen->exitCode > 0);
     }
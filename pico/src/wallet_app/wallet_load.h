@@ -2,6 +2,7 @@
 #define _WALLET_LOAD_H_
 
 #include "wallet_app/hd_wallet.h"
+#include "wallet_app/crypto_worker.h"
 #include "wallet_app/screens/wallet_screen.h"
 
 
@@ -16,6 +17,10 @@ typedef enum {
     PW_TERMINAL_ERROR_STATE,                        // Unrecoverable error state
     PW_DISPLAY_CREATED_MNEMONIC_STATE,              // Showing user reovery mnemonics
     PW_WALLET_READY_STATE,                          // A wallet is loaded and ready to use
+    PW_CREATING_WALLET_STATE,                       // Core1 is generating the new wallet's keys
+    PW_RESTORING_WALLET_STATE,                      // Core1 is rebuilding keys from the recovery mnemonic
+    PW_DECRYPTING_WALLET_STATE,                     // Core1 is checking the password and decrypting the wallet
+    PW_ENCRYPTING_WALLET_STATE,                     // Core1 is encrypting the new wallet, ready to be saved
 } WalletLoadState;
 
 
@@ -26,6 +31,8 @@ typedef struct {
     uint8_t screenDataBuffer[128];
     HDWallet* wallet;
     wallet_error walletLoadError;
+    CryptoJobHandle cryptoJob;                      // Job the current *_WALLET_STATE is waiting on
+    uint32_t walletSlot;                            // Which wallet in the container is loaded and saved
     bool userExitRequested;
 } WalletLoadStateController;
 